@@ -24,61 +24,113 @@
 #include "qwoptions_io.h"
 #include "qwextra_io.h"
 #include "qwconsts.h"
+#include "qwstatistics.h"
+#include "qwrandom.h"
+#include "qwlinks.h"
+#include "qwcheckpoint.h"
+#include "qwwriter.h"
+
+
+/* This structure keeps everything a 1D simulation needs between two
+ * calls of the library (see qw2d_context): the options, the names of
+ * the files, the coin, the states, the broken links, the probability 
+ * arrays and the averaged statistics. The arrays are allocated by 
+ * initContext1D and freed by freeContext1D. After a call to simulate1D,
+ * A is the final state of the last experiment and AverageProb and 
+ * StatProb contain the results of the simulation. check describes the
+ * simulation in the checkpoint files, and staWriter writes the
+ * statistics file while simulate1D runs.
+ */
+typedef struct{
+  options1D_t options;
+  filenames_t fnames;
+  const inputfile_t *input;
+  double complex **C;
+  double complex **A;
+  double complex **Atemp;
+  blinks_t BLinks;
+  double *AverageProb;
+  double *StatProb;
+  double *SumProb;
+  statistics_t *vStat;
+  checkheader_t check;
+  asyncwriter_t *staWriter;
+}qw1d_context;
 
 /* This subroutine sets the coin for a 1D simulation. It receives the 
  * address of the matrix that will be used to store the coin, an 
- * integer describing the type of the coin and the name of the input 
- * file. It sets the matrix according to the type of the coin (if
+ * integer describing the type of the coin and the input file (see 
+ * qwinput.h). It sets the matrix according to the type of the coin (if
  * it is CUSTOM then the input file is be read to get the complete
- * description of the matrix).
+ * description of the matrix). If *C is not NULL, the previous coin
+ * is freed, so *C must be NULL in the first call.
  */
-void setCoin1D(double complex ***C, int coinType, const char *filename);
+void setCoin1D(double complex ***C, int coinType, const inputfile_t *input);
 
 
 
 /* This subroutine sets the initial state for a 1D simulation. It receives
  * the address of the array that will be used to store the state, a 
  * structure options1D_t with the simulation options and 
- * the name of the input file. It sets the array according to the size of
+ * the input file (see qwinput.h). It sets the array according to the size of
  * lattice and the type of the state (if it is CUSTOM then the input file 
- * is read to get the complete description of the state).
+ * is read to get the complete description of the state). If *A is not 
+ * NULL, the previous state is freed, so *A must be NULL in the first call.
  */
 void setState1D(double complex ***A, options1D_t options, 
-		const char *filename);
+		const inputfile_t *input);
+
+
+/* This function works as setState1D, but it always returns a newly
+ * allocated state, which must be freed by the caller with freeComplex2D.
+ * If the state cannot be created, the function returns NULL.
+ */
+double complex **newState1D(options1D_t options, const inputfile_t *input);
 
 
 
 /* This subroutine breaks random links of a lattice previously initialized.
  * The probability of breaking each link is given by blProb. It receives
- * the address of the matrix used to define the broken link topology,
- * a structure options1D_t with the simulation options. Broken links are 
- * defined according to Physical Review A, 74, 012312 (2006).
+ * the broken links of the lattice (see blinks_t), a structure 
+ * options1D_t with the simulation options and the stream of random 
+ * numbers (see getRandom). Broken links are defined according to
+ * Physical Review A, 74, 012312 (2006).
  */
-void randomBrokenLink1D(int ***B, options1D_t options);
+void randomBrokenLink1D(blinks_t B, options1D_t options, rng_t *rng);
 
 
 /* This subroutine performs one iteration in the quantum walk. It receives
  * the address of the matrix used to store the state, the address of a
- * temporary matrix used in the iteration, the coin matrix, the matrix
- * of broken links, a structure options1D_t with the simulation options
+ * temporary matrix used in the iteration, the coin matrix, the broken
+ * links, a structure options1D_t with the simulation options
  *  and an integer describing the number of the iteration.
+ * The temporary matrix is only cleaned in iterations 0 and 1. In the
+ * following iterations it must be the one returned by the previous call,
+ * which is zero outside the region that will be written.
  */
 void iterate1D(double complex ***A, double complex ***Atemp, double complex **C, 
-	       int **BrokenLinks, options1D_t options, int iteration);
+	       blinks_t BrokenLinks, options1D_t options, int iteration);
 
 
 
 /* This subroutine obtains the statistics for an interation of the walk
  * and saves it into the appropriate file. When many experiments are
  * being carried out the subroutine takes the average of the results.
- * It receives as arguments the array used to store the state, a 
- * structure options1D_t used to store the simulation options, a
- * structure filenames_t used to store the names of files generated by
- * the simulation, an integer describing the number of the iteration,
- * an integer describing the number of experiments carried out.
+ * It receives as arguments the address of the context of the simulation,
+ * whose state ctx->A is used, an integer describing the number of the 
+ * iteration and an integer describing the number of the experiment.
  */
-void doStatistics1D(double complex **A, double *StatProb, options1D_t options, 
-		    filenames_t fnames, int iteration, int experiment);
+void doStatistics1D(qw1d_context *ctx, int iteration, int experiment);
+
+
+
+/* This subroutine receives the statistics of an iteration of an 
+ * experiment, already calculated, accumulates them in ctx->vStat and 
+ * writes the averages in the file after the last experiment (see 
+ * doStatistics1D). The experiments must be passed in order.
+ */
+void saveStatistics1D(qw1d_context *ctx, statistics_t stat, 
+		      int iteration, int experiment);
 
 
 
@@ -94,12 +146,52 @@ void check1D(double complex **A, options1D_t options, int iteration);
 /* This function calculates the approximate stationary distribution with
  * a certain number of steps. It should not be used with unitary decoherence
  * generated by random broken links. The function receives a matrix used
- * to store the state, a matrix used to store the coin, the matrix of broken
+ * to store the state, a matrix used to store the coin, the broken
  * links (only because it will be used internally, to call the function to
  * perform the iterations), and a structure options1D_t used to store the
- * simulation options.
+ * simulation options. With a positive options.mixTol the calculation
+ * stops early, as in getStationary2D; the number of steps used and the
+ * last L1 distance between checkpoints are stored in stepsMix and error.
  */
 double *getStationary1D(double complex **A, double complex **C, 
-			int **BLinks, options1D_t options);
+			blinks_t BLinks, options1D_t options,
+			int *stepsMix, float *error);
+
+
+
+/* This function receives the address of a context, the options of the
+ * simulation, the name of the input file and the input read from it
+ * (see readInputFile), which is kept in the context, as the states of
+ * the experiments are read from it, and must not be freed before the
+ * context. It prepares the context for a simulation: it creates the names of the output files and 
+ * allocates the coin, the broken links, the temporary state and the
+ * averaged statistics. The context must be freed with freeContext1D,
+ * even if this function fails.
+ *
+ * Error numbers:
+ *  0: no error
+ *  1: could not initialize the broken links
+ *  2: could not set the coin
+ *  3: not enough memory
+ *  4: detector outside the lattice
+ *  5: invalid binary state file (see checkStateBinary1D)
+ */
+int initContext1D(qw1d_context *ctx, options1D_t options, 
+		  const char *filename, const inputfile_t *input);
+
+
+
+/* This subroutine frees all the arrays of a context created by 
+ * initContext1D.
+ */
+void freeContext1D(qw1d_context *ctx);
+
+
+
+/* This subroutine runs a complete simulation in a context created by
+ * initContext1D, as simulate2D does for two-dimensional walks, with the
+ * same checkpoints (see keyword CHECKPOINT).
+ */
+void simulate1D(qw1d_context *ctx);
 
 #endif
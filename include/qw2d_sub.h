@@ -23,26 +23,120 @@
 #include<complex.h>
 #include "qwoptions_io.h"
 #include "qwextra_io.h"
+#include "qwmem_complex.h"
+#include "qwstatistics.h"
+#include "qwscreen.h"
+#include "qwrandom.h"
+#include "qwlinks.h"
+#include "qwcheckpoint.h"
+#include "qwwriter.h"
+
+
+/* Observables computed by iterate2D while it updates the state, row by
+ * row, so that the new amplitudes are read again while they are still 
+ * in the cache (see keyword FUSEDSTATS). For each row m of the arrays,
+ * RowSums[m][0] receives the sum of the probabilities of its sites, and
+ * RowSums[m][1] and RowSums[m][2] the sums of these probabilities 
+ * multiplied by the coordinate y and by its square. If SumProb is not 
+ * NULL the probabilities are also added to it, as in 
+ * getStatisticsFromState2D, and if screen is not NULL they are added 
+ * to the screen, as in updateScreen. If StatProb (the approximate 
+ * stationary distribution) is not NULL, RowSums[m][3] and RowSums[m][4]
+ * receive the terms of the sites of the row in the total variation
+ * distances to the stationary and to the uniform distributions (see 
+ * getDistancesFromSumProb2D), and RowSums[m][5] the sum of StatProb 
+ * over these sites. StatTotal is the sum of all the entries of 
+ * StatProb, which gives the terms of the sites never reached by the
+ * walker. The rows updated are mlo to mhi, and steps is the number of
+ * steps of the new state, which are set by iterate2D. These observables
+ * are not available in the CYCLE lattice, where the amplitudes are 
+ * pushed to the rows of the neighbours.
+ */
+typedef struct{
+  double (*RowSums)[6];
+  double **SumProb;
+  double **StatProb;
+  double StatTotal;
+  screen_t *screen;
+  int steps;
+  int mlo;
+  int mhi;
+}observables2D_t;
+
+
+/* This structure keeps everything a 2D simulation needs between two
+ * calls of the library: the options, the names of the files, the coin,
+ * the states, the broken links, the probability arrays, the averaged
+ * statistics and the observation screen. There is no state kept in
+ * static variables, so several simulations may be run by the same
+ * program, one after the other or at the same time. BLinksPerm keeps
+ * the permanent broken links read from the input file (its field bits 
+ * is NULL if there are none), and BLinks keeps the links used in the
+ * current step. The arrays are 
+ * allocated by initContext2D and freed by freeContext2D. After a call
+ * to simulate2D, A is the final state of the last experiment, steps is
+ * the number of steps of this experiment and AverageProb, StatProb and 
+ * screen contain the results of the simulation. check describes the
+ * simulation in the checkpoint files (see keyword CHECKPOINT), and
+ * staWriter writes the statistics file while simulate2D runs (it is 
+ * NULL otherwise, and saveStatistics2D writes the file itself), as
+ * snapWriter writes the snapshot file (see keyword SNAPSHOT). initial
+ * keeps the initial state, which is built only once, by initContext2D,
+ * and copied to A at the beginning of each experiment.
+ */
+typedef struct{
+  options2D_t options;
+  filenames_t fnames;
+  const inputfile_t *input;
+  double complex ****C;
+  complex4D_t A;
+  complex4D_t Atemp;
+  blinks_t BLinks;
+  blinks_t BLinksPerm;
+  double **AverageProb;
+  double **StatProb;
+  double **SumProb;
+  double (*RowSums)[6];
+  statistics_t *vStat;
+  screen_t screen;
+  int steps;
+  checkheader_t check;
+  asyncwriter_t *staWriter;
+  asyncwriter_t *snapWriter;
+  statetemplate2D_t initial;
+}qw2d_context;
 
 /* This subroutine sets the coin for a 2D simulation. It receives the 
  * address of the matrix that will be used to store the coin, an 
- * integer describing the type of the coin and the name of the input 
- * file. It sets the matrix according to the type of the coin (if
+ * integer describing the type of the coin and the input file (see 
+ * qwinput.h). It sets the matrix according to the type of the coin (if
  * it is CUSTOM then the input file is be read to get the complete
- * description of the matrix).
+ * description of the matrix). If *C is not NULL, the previous coin
+ * is freed, so *C must be NULL in the first call.
  */
-void setCoin2D(double complex *****C, int coinType, const char *filename);
+void setCoin2D(double complex *****C, int coinType, const inputfile_t *input);
 
 
 /* This subroutine sets the initial state for a 2D simulation. It receives
  * the address of the array that will be used to store the state, an integer
  * describing the size of the lattice (we consider a lattice ranging from 
  * -max to max in both x and y axes), an integer describing the type of the 
- * initial state and the name of the input file. It sets the array according 
- * to the size of lattice and the type of the state (if it is CUSTOM then the 
- * input file is read to get the complete description of the state).
+ * initial state and the input file (see qwinput.h). It sets the array
+ * according to the size of lattice and the type of the state (if it is
+ * CUSTOM then the input file is read to get the complete description of
+ * the state).
+ * If the field block of *A is not NULL, the previous state is freed, so
+ * it must be NULL in the first call.
  */
-void setState2D(double complex *****A,options2D_t opts,const char *filename);
+void setState2D(complex4D_t *A,options2D_t opts,const inputfile_t *input);
+
+
+/* This function works as setState2D, but it always returns a newly
+ * allocated state, which must be freed by the caller with freeTensor4D.
+ * If the state cannot be created, the field data of the returned 
+ * structure is NULL.
+ */
+complex4D_t newState2D(options2D_t opts, const inputfile_t *input);
 
 
 
@@ -51,57 +145,150 @@ void setState2D(double complex *****A,options2D_t opts,const char *filename);
  * used to store the simulation options and an integer describing the
  * number of the iteration.
  */
-void check2D(double complex ****A, options2D_t options, int iteration);
+void check2D(complex4D_t A, options2D_t options, int iteration);
 
 
 
 /* This subroutine performs one iteration in the quantum walk. It receives
  * the address of the matrix used to store the state, the address of a
- * temporary matrix used in the iteration, the coin matrix, both matrices
- * of broken links, a structure options2D_t with the simulation options and 
- * an integer describing the number of the iteration.
+ * temporary matrix used in the iteration, the coin matrix, the broken
+ * links, a structure options2D_t with the simulation options, 
+ * an integer describing the number of the iteration and the address of
+ * the observables of the new state (see observables2D_t), which may be
+ * NULL and must be NULL in the CYCLE lattice.
+ * The temporary matrix is only cleaned in iterations 0 and 1. In the
+ * following iterations it must be the one returned by the previous call,
+ * which is zero outside the region that will be written. Rows of intact
+ * sites are updated with the vector coin kernels (see getCoinKernel).
+ */
+void iterate2D(complex4D_t *A, complex4D_t *Atemp, double complex ****C, 
+	       blinks_t BLinks, options2D_t opts, int iteration,
+	       observables2D_t *obs);
+
+
+/* This function receives the observables computed by iterate2D, the
+ * simulation options and the number of the iteration. It returns the
+ * statistics of the state, as getStatisticsFromState2D, without reading
+ * the state again. The total variation distances are only computed if
+ * the field StatProb of obs was not NULL. The sums are added row by 
+ * row, so the results may differ from the ones of 
+ * getStatisticsFromState2D in the last digits. The distances may 
+ * differ a little more, since getDistancesFromSumProb2D adds their 
+ * terms directly in the single precision fields of statistics_t.
  */
-void iterate2D(double complex *****A,double complex *****Atemp,double complex ****C, 
-	       int ****BLinks1, int ****BLinks2, options2D_t opts, int iteration);
+statistics_t getStatisticsFromObservables2D(observables2D_t obs, 
+					    options2D_t opts, int iteration);
 
 
 
 /* This subroutine obtains the statistics for an interation of the walk
  * and saves it into the appropriate file. When many experiments are
  * being carried out the subroutine takes the average of the results.
- * It receives as arguments the array used to store the state, a 
- * structure options2D_t used to store the simulation options, a
- * structure filenames_t used to store the names of files generated by
- * the simulation, an integer describing the number of the iteration,
- * an integer describing the number of experiments that will be carried out.
+ * It receives as arguments the address of the context of the simulation,
+ * whose state ctx->A is used, an integer describing the number of the 
+ * iteration and an integer describing the number of the experiment.
+ */
+void doStatistics2D(qw2d_context *ctx, int iteration, int experiment);
+
+
+
+/* This subroutine does the second half of the work of doStatistics2D: 
+ * it receives the statistics of an iteration of an experiment, already
+ * calculated, accumulates them in ctx->vStat and writes the averages in
+ * the file after the last experiment. The experiments must be passed in
+ * order.
  */
-void doStatistics2D(double complex ****A, double **StatProb, options2D_t options, 
-		    filenames_t fnames, int iteration, int experiment);
+void saveStatistics2D(qw2d_context *ctx, statistics_t stat, 
+		      int iteration, int experiment);
 
 
 
 /* This subroutine breaks random links of a lattice previously initialized.
  * The probability of breaking each link is given by options. It receives
- * the addresses of two matrices used to define the broken link topology, 
- * and a structure options2D_t defining the size of the lattice and the 
- * probability of broken links in each direction. Broken links are defined 
- * according to Physical Review A, 74, 012312 (2006).
+ * the broken links of the lattice (see blinks_t), 
+ * a structure options2D_t defining the size of the lattice and the 
+ * probability of broken links in each direction, and the stream of random
+ * numbers (see getRandom). Broken links are defined according to 
+ * Physical Review A, 74, 012312 (2006).
  */
-void randomBrokenLink2D(int *****BLinks1, int *****BLinks2, options2D_t options);
+void randomBrokenLink2D(blinks_t BLinks, options2D_t options, rng_t *rng);
 
 
 
 /* This function calculates the approximate stationary distribution with a 
  * certain number of steps, assuming that the lattice is finite, with 
- * boundaries correctly described by BLinks1 and BLinsk2. It receives a 
- * matrix containing the initial state, another containing the coin, two 
- * matrices describing broken links, and a structure options2D_t defining 
+ * boundaries correctly described by BLinks. It receives a matrix 
+ * containing the initial state, another containing the coin, the broken
+ * links, and a structure options2D_t defining 
  * the size of the lattice and the probabilities of broken links. 
  * This function should not be used with unitary decoherence
  * generated by random broken links.
+ * If options.mixTol is positive the average distribution is compared at
+ * checkpoints whose distance doubles each time (the first one after as
+ * many steps as there are sites in a row), and the calculation stops 
+ * when the L1 distance between two consecutive checkpoints is smaller 
+ * than options.mixTol. The number of steps actually used is stored in
+ * stepsMix, and the last distance in error (-1 if it was not computed).
+ */
+double **getStationary2D(complex4D_t A, double complex ****C, 
+			 blinks_t BLinks, options2D_t options,
+			 int *stepsMix, float *error);
+
+
+
+/* This function receives the address of a context, the options of the
+ * simulation, the name of the input file and the input read from it
+ * (see readInputFile), which is kept in the context, as the states of
+ * the experiments are read from it, and must not be freed before the
+ * context. It prepares the context for a simulation: it creates the names of the output files and 
+ * allocates the coin, the broken links (reading the permanent ones from
+ * the input file), the temporary state, the averaged statistics and the
+ * observation screen. The context must be freed with freeContext2D,
+ * even if this function fails.
+ *
+ * Error numbers:
+ *  0: no error
+ *  1: could not initialize the broken links
+ *  2: could not read broken links from file
+ *  3: could not set the coin
+ *  4: could not initialize the observation screen
+ *  5: not enough memory
+ *  6: detector outside the lattice
+ *  7: invalid binary state file (see checkStateBinary2D)
+ *  8: could not create the initial state
+ */
+int initContext2D(qw2d_context *ctx, options2D_t options, 
+		  const char *filename, const inputfile_t *input);
+
+
+
+/* This subroutine frees all the arrays of a context created by 
+ * initContext2D.
+ */
+void freeContext2D(qw2d_context *ctx);
+
+
+
+/* This subroutine runs a complete simulation in a context created by
+ * initContext2D: the approximate stationary distribution, if the mixing
+ * time was requested, and then all the experiments. The experiments are
+ * run one after the other or, if options.expThreads is set (see keyword
+ * EXPTHREADS), at the same time in this number of threads. Each 
+ * experiment has its own stream of random numbers, obtained from the
+ * seed and from the number of the experiment, so the results do not
+ * depend on the number of threads. The statistics, and the snapshots
+ * of the last experiment (see keyword SNAPSHOT), are written during
+ * the simulation; the other results are left in the context.
+ *
+ * If options.checkEvery is set (see keyword CHECKPOINT), everything 
+ * needed to continue the simulation is saved in the checkpoint file
+ * every checkEvery steps: while the stationary distribution is 
+ * calculated, and during the experiments. With EXPTHREADS the 
+ * checkpoints are written between experiments, after checkEvery steps
+ * at least. If options.resume is set, the simulation continues from 
+ * the checkpoint file, and the results are the same as the ones of an
+ * uninterrupted simulation.
  */
-double **getStationary2D(double complex ****A, double complex ****C, 
-			 int ****BLinks1, int ****BLinks2, 
-			 options2D_t options);
+void simulate2D(qw2d_context *ctx);
 
 #endif
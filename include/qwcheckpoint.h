@@ -0,0 +1,124 @@
+/* QWalk (qwcheckpoint.h)
+ * Copyright (C) 2008  Franklin Marquezino
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#ifndef _QWCHECKPOINT
+#define _QWCHECKPOINT
+
+#include<stdio.h>
+#include<stddef.h>
+
+/* A checkpoint file keeps everything a simulation needs to continue
+ * from the point where it was written (see keyword CHECKPOINT): this
+ * header, followed by the arrays of the simulation as blocks of raw
+ * data, in the byte order and with the structures of the machine that
+ * wrote them. The blocks depend on the phase of the simulation (see
+ * simulate2D). The fields from max on describe the simulation, and are
+ * compared with the input file when the simulation is resumed.
+ */
+#define CHECK_MAGIC "QWCHECK"
+#define CHECK_VERSION 1
+
+/* Phases of a simulation */
+#define CHECK_STATIONARY   1  /* calculating the stationary distribution */
+#define CHECK_EXPERIMENTS  2  /* running the experiments */
+
+typedef struct{
+  char magic[8];
+  int version;
+  int dimension;        /* 1 or 2 */
+  int phase;
+  int experiment;       /* experiment in progress */
+  int step;             /* steps already simulated in this phase or experiment */
+  int steps;            /* steps of the experiment (see stepsAfterMeasure) */
+  int seed;
+  int stepsMix;         /* steps used in the stationary distribution */
+  int mixCheck;         /* next and last checkpoints of MIXTOL */
+  int mixLastCheck;
+  float mixError;
+  int hasAverage;       /* whether the average probabilities were saved */
+  int max;
+  int lattType;
+  int layout;
+  int coinType;
+  int stateType;
+  int numOfExperiments;
+  int optSteps;
+  int optStepsMix;
+  int statEvery;
+  int calcMix;
+  float blProb[2];
+  float dtProb;
+  float mixTol;
+}checkheader_t;
+
+
+
+/* This function receives the name of a checkpoint file and opens a
+ * temporary file (with the same name followed by .tmp) where the new
+ * checkpoint is written. The checkpoint replaces the old one only when
+ * it is closed by closeCheckpoint, so a simulation interrupted while
+ * writing it still has the previous one. Returns NULL if the file
+ * cannot be created.
+ */
+FILE *createCheckpoint(const char *filename);
+
+
+/* This function closes a checkpoint opened by createCheckpoint and
+ * moves it to filename. If error is not zero (some block could not be
+ * written), the temporary file is removed and the old checkpoint is
+ * kept.
+ *
+ * Error numbers:
+ *   0: success
+ *   1: could not write file
+ *   2: could not replace the old checkpoint
+ */
+int closeCheckpoint(FILE *out, const char *filename, int error);
+
+
+/* This function opens a checkpoint file and reads its header, which
+ * must be of the given dimension. The blocks are read afterwards with
+ * readBlock and readReal2DBlock, and the file is closed with fclose.
+ * Returns NULL if the file cannot be opened or is not a checkpoint.
+ */
+FILE *openCheckpoint(const char *filename, checkheader_t *header,
+		     int dimension);
+
+
+/* This function returns 1 if two headers describe the same simulation
+ * (all the fields from max on are equal), and 0 otherwise. 
+ */
+int sameSimulation(const checkheader_t *a, const checkheader_t *b);
+
+
+/* These functions write and read a block of the given number of bytes.
+ * They return 1 if the block could not be written or read, and 0
+ * otherwise.
+ */
+int writeBlock(FILE *out, const void *data, size_t bytes);
+int readBlock(FILE *in, void *data, size_t bytes);
+
+
+/* These functions write and read a matrix allocated by allocReal2D,
+ * one row after the other. They return 1 on failure, and 0 otherwise.
+ */
+int writeReal2DBlock(FILE *out, double **data, int rows, int cols);
+int readReal2DBlock(FILE *in, double **data, int rows, int cols);
+
+#endif
@@ -20,24 +20,38 @@
 #ifndef _QWCOIN_IO
 #define _QWCOIN_IO
 
+#include "qwinput.h"
 
-/* This function receives as input the name of the file that
+
+/* This function receives the input file (see qwinput.h) which
  * contains the definition of the coin. If the input file
  * is correct, the function returns a 2D complex matrix
  * corresponding to the coin. Otherwise, the function returns
  * NULL. In this version the function doesn't check if the
  * matrix entered by the user is unitary.
  */
+double complex **readCoin1D(const inputfile_t *input);
+
+
+/* This function works as readCoin1D, but it receives the name of the
+ * input file.
+ */
 double complex **readCoinFile1D(const char *filename);
 
 
-/* This function receives as input the name of the file that
+/* This function receives the input file (see qwinput.h) which
  * contains the definition of the coin. If the input file
  * is correct, the function returns a 4D complex matrix
  * corresponding to the coin. Otherwise, the function returns
  * NULL. In this version the function doesn't check if the
  * matrix entered by the user is unitary.
  */
+double complex ****readCoin2D(const inputfile_t *input);
+
+
+/* This function works as readCoin2D, but it receives the name of the
+ * input file.
+ */
 double complex ****readCoinFile2D(const char *filename);
 
 #endif
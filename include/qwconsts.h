@@ -23,6 +23,20 @@
 #define WALK_TOL 10e-5 /* it was 10e-8 until version 1.0 */
 /* Tolerance to approximation errors */
 
+#define COIN_LAYOUT 50
+#define SITE_LAYOUT 51
+
+#define MEM_ALIGN 64
+/* Alignment (in bytes) of contiguous arrays. It matches the size of a 
+ * cache line in most processors.
+ */
+
+#define MIXMERGE_MAXMEM 536870912
+/* Maximum memory (in bytes) used to keep the sums of the probabilities of
+ * the steps written, when the stationary distribution and the experiment
+ * are obtained from the same evolution.
+ */
+
 #define MAXIMUM(A,B) ((A>B) ? (A):(B))
 #define MINIMUM(A,B) ((A<B) ? (A):(B))
 
@@ -44,6 +58,7 @@
 #define FOURIER_STATE  21
 #define GROVER_STATE   22 
 #define HADAMARD_STATE 23
+#define FILE_STATE     24
 
 #define NO_BROKENLINKS 30
 #define PERMANENT_BROKENLINKS 31
@@ -54,4 +69,7 @@
 #define CYCLE_LATT 43
 #define SEGMENT_LATT 44
 
+#define PROB_SNAPSHOT 60
+#define WAVE_SNAPSHOT 61
+
 #endif
@@ -22,6 +22,7 @@
 
 #include "qwoptions_io.h"
 #include "qwscreen.h"
+#include "qwlinks.h"
 
 typedef struct{
   char *dat_file;
@@ -30,6 +31,8 @@ typedef struct{
   char *datscr_file;
   char *datdag_file;
   char *sta_file; 
+  char *chk_file;
+  char *snap_file;
   char *epsscr_file;
   char *epspb_file;
   char *eps3d_file;
@@ -70,25 +73,30 @@ int changeFileEnding(char **newname, const char *oldname, const char *end);
 int printFilenames(FILE *out, char *input_filename, filenames_t fnames);
 
 
-/* This function receives as input the name of the file which describes
+/* This function receives the input file (see qwinput.h) which describes
  * the broken links of the simulation. It also receives an integer max 
  * describing the size of the lattice (meaning that the lattice goes from
- * -max to max). And it receives two pointers for 4D-matrices. These
- * matrices will be modified, opening the links according to Eqs. (18)
- * and (19) of Physical Review A 74, (2006). The keywords accepted in
- * the file are POINT and LINE.
+ * -max to max). And it receives the broken links of the lattice (see
+ * blinks_t), which will be modified, opening the links according to 
+ * Eqs. (18) and (19) of Physical Review A 74, (2006). The keywords 
+ * accepted in the file are POINT and LINE.
  *
  * Error numbers:
  *   0: operation successful (no error)
  *   1: invalid lattice size
- *   2: NULL pointer to L1 or L2
- *   3: could not open input file
+ *   2: broken links not allocated
+ *   3: could not open input file (the input is NULL)
  *   4: invalid coordinate (point does not exist in lattice)
  *   5: invalid slope
  *   6: error in the BEGINBL-ENDBL structure
  */
-int readBrokenLinkFile2D(const char *filename, int max, 
-			 int *****L1, int *****L2, int type);
+int readBrokenLink2D(const inputfile_t *input, int max, blinks_t L, int type);
+
+
+/* This function works as readBrokenLink2D, but it receives the name of
+ * the input file.
+ */
+int readBrokenLinkFile2D(const char *filename, int max, blinks_t L, int type);
 
 
 /* This function receives as input a string containing the name of
@@ -0,0 +1,78 @@
+/* QWalk (qwinput.h)
+ * Copyright (C) 2008  Franklin Marquezino
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#ifndef _QWINPUT
+#define _QWINPUT
+
+#include<stddef.h>
+
+/* An input file read into memory and split in tokens (the words
+ * separated by blanks), so that its sections (options, coin, state,
+ * broken links) are read from memory, as many times as needed, without
+ * opening the file again. The tokens are read in order from a cursor,
+ * next, which each section places after its opening keyword with
+ * findKeyword. The functions that read a section receive the input as
+ * const and move a copy of it, so an input may be read by several
+ * threads at once.
+ */
+typedef struct{
+  char *text;         /* the contents of the file, one token after the other */
+  char **tokens;
+  long numTokens;
+  long next;          /* the next token to be read */
+}inputfile_t;
+
+
+/* This function reads the whole file filename and splits it in tokens.
+ * Returns NULL if the file cannot be read or there is not enough
+ * memory. The input is freed with freeInputFile.
+ */
+inputfile_t *readInputFile(const char *filename);
+
+
+/* This function frees an input returned by readInputFile. */
+void freeInputFile(inputfile_t *in);
+
+
+/* This function searches the first occurrence of keyword in the input
+ * and places the cursor right after it. Returns 1 if the keyword is
+ * found, and 0 otherwise (and then the cursor is at the end).
+ */
+int findKeyword(inputfile_t *in, const char *keyword);
+
+
+/* This function returns the next token of the input, or NULL if there
+ * are no more tokens.
+ */
+const char *nextToken(inputfile_t *in);
+
+
+/* These functions read the next token of the input as a string (which
+ * is truncated to size characters, including the terminating null
+ * character), an int, a float or a double, as fscanf does with the
+ * formats %s, %d, %f and %lf. They return 1 on success and 0 if there
+ * are no more tokens or the token does not start with a number (in
+ * which case it is not consumed).
+ */
+int scanString(inputfile_t *in, char *s, size_t size);
+int scanInt(inputfile_t *in, int *value);
+int scanFloat(inputfile_t *in, float *value);
+int scanReal(inputfile_t *in, double *value);
+
+#endif
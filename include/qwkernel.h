@@ -0,0 +1,66 @@
+/* QWalk (qwkernel.h)
+ * Copyright (C) 2008  Franklin Marquezino
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#ifndef _QWKERNEL
+#define _QWKERNEL
+
+#include<complex.h>
+
+/* A coin kernel applies one row of a 4x4 coin operator to a row of
+ * sites. It receives the destination array dst, four source arrays
+ * src[0..3] (one for each coin state), the four entries coin[0..3] of
+ * the row of the coin operator, the distance stride between two
+ * consecutive sites (in complex numbers) and the number of sites len.
+ * For each site i it computes
+ *
+ *   dst[i*stride] = coin[0]*src[0][i*stride] + ... + coin[3]*src[3][i*stride]
+ *
+ * adding the terms in this order, exactly as the scalar code does.
+ * The results of all kernels are therefore identical.
+ */
+typedef void (*coinkernel_t)(double complex *dst,
+			     const double complex *const src[4],
+			     const double complex coin[4], long stride, int len);
+
+
+/* Portable coin kernel, written in plain C. */
+void coinKernelScalar(double complex *dst, const double complex *const src[4],
+		      const double complex coin[4], long stride, int len);
+
+
+/* Coin kernel for coins whose entries are all 1/2, -1/2, i/2 or -i/2,
+ * such as the Hadamard, Grover and Fourier coins. The products are
+ * replaced by exchanges and changes of sign of the real and imaginary
+ * parts, and the sum is multiplied by 1/2 in the end. The result is 
+ * the same as the one of coinKernelScalar.
+ */
+void coinKernelSignScalar(double complex *dst, const double complex *const src[4],
+			  const double complex coin[4], long stride, int len);
+
+
+/* This function receives the type of coin and returns the fastest coin
+ * kernel for it supported by the processor in which the program is 
+ * running: AVX-512, AVX2 or the portable one. The Hadamard, Grover and
+ * Fourier coins use the sign kernels, and the CUSTOM coin uses the
+ * generic ones. The vector kernels are only compiled with GCC (or a
+ * compatible compiler) on x86 processors.
+ */
+coinkernel_t getCoinKernel(int coinType);
+
+#endif
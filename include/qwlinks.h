@@ -21,35 +21,90 @@
 #define _QWLINKS
 
 
-/* This function receives the addresses of one integer matrix, a 
- * positive integer and the type of lattice. The matrix indicates 
- * the broken links, according to Phys. Rev. A, 74, 012312 (2006). 
- * The positive integer describes the size of the lattice, 
- * which ranges from -max to max in the LINE lattice, and 
- * from 0 to max-1 in the CYCLE and SEGMENT lattices. 
- * The function initializes all the links closed.
+/* Broken links of a lattice, according to Phys. Rev. A, 74, 012312 
+ * (2006), packed with one bit for each directed link of each site. 
+ * The bit is set if the link is broken. There is one plane of bits for
+ * each coin state: 2 planes (coin state j) in one-dimensional lattices 
+ * and 4 planes (coin state (j,k), plane 2*j+k) in two-dimensional ones.
+ * Each plane has rows rows of sites, and each row takes words words of
+ * 64 bits. A row of 64 intact sites is a single word equal to zero.
+ *
+ * In the matrices of integers used before, a closed link of coin state
+ * (j,k) had the values L1 = (-1)^j and L2 = (-1)^k (L = (-1)^j in one 
+ * dimension), and a broken link had the values L1 = L2 = 0.
+ */
+typedef struct{
+  unsigned long long *bits;
+  int planes;
+  int rows;
+  int words;
+}blinks_t;
+
+#define BLROW(L,p,m) ((L).bits + ((long)(p)*(L).rows + (m))*(L).words)
+#define BLGET(row,n) (((row)[(n)>>6] >> ((n)&63)) & 1ULL)
+#define BLSET(row,n) ((row)[(n)>>6] |= 1ULL << ((n)&63))
+
+#define ISBROKEN1D(L,j,m) BLGET(BLROW(L,j,0),m)
+#define BREAKLINK1D(L,j,m) BLSET(BLROW(L,j,0),m)
+#define ISBROKEN2D(L,j,k,m,n) BLGET(BLROW(L,2*(j)+(k),m),n)
+#define BREAKLINK2D(L,j,k,m,n) BLSET(BLROW(L,2*(j)+(k),m),n)
+
+
+/* This function receives the address of a structure blinks_t, a 
+ * positive integer and the type of lattice. The positive integer 
+ * describes the size of the lattice, which ranges from -max to max in
+ * the LINE lattice, and from 0 to max-1 in the CYCLE and SEGMENT 
+ * lattices. The function initializes all the links closed. If the 
+ * field bits is NULL the links are allocated (they must be freed with
+ * freeBrokenLink); otherwise the links given are reused.
  *
  * Error numbers
  *   0: success
  *   1: invalid lattice size
- *   2: invalid broken link matrix
+ *   2: invalid broken links (or not enough memory)
  */
-int initBrokenLink1D(int ***L1, int max, unsigned char type);
+int initBrokenLink1D(blinks_t *L, int max, unsigned char type);
 
 
-/* This function receives the addresses of two integer matrices, a 
- * positive integer and the type of lattice. The matrices indicate 
- * the broken links, according to Phys. Rev. A, 74, 012312 (2006). 
- * The positive integer describes the size of the lattice, 
- * which ranges from -max to max in both axes.
- * The function initializes all the links closed.
+/* This function works as initBrokenLink1D for a two-dimensional 
+ * lattice, which ranges from -max to max in both axes (or from 0 to
+ * max-1 in the CYCLE lattice).
+ */
+int initBrokenLink2D(blinks_t *L, int max, unsigned char type);
+
+
+/* This function receives broken links previously initialized and
+ * closes all of them.
  *
  * Error numbers
  *   0: success
- *   1: invalid lattice size
- *   2: invalid broken link matrix
+ *   2: invalid broken links
  */
-int initBrokenLink2D(int *****L1, int *****L2, int max, unsigned char type);
+int closeBrokenLink(blinks_t L);
 
-#endif
 
+/* This function receives two sets of broken links L and P, of the same
+ * size, and copies P into L. It is used to restore a permanent topology
+ * of broken links without reading the input file again.
+ *
+ * Error numbers
+ *   0: success
+ *   2: invalid broken links
+ */
+int copyBrokenLink(blinks_t L, blinks_t P);
+
+
+/* This function receives the broken links of a two-dimensional lattice,
+ * a row m and two columns n and end, and returns the first column from
+ * n to end-1 where the site (m,column) has at least one broken link, or
+ * end if there is none.
+ */
+int nextBrokenSite2D(blinks_t L, int m, int n, int end);
+
+
+/* This function frees broken links allocated by initBrokenLink1D or 
+ * initBrokenLink2D, and sets the field bits to NULL.
+ */
+void freeBrokenLink(blinks_t *L);
+
+#endif
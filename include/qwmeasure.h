@@ -21,13 +21,21 @@
 #define _QWMEASURE
 
 #include "qwoptions_io.h"
+#include "qwmem_complex.h"
+#include "qwrandom.h"
+#include "qwstatistics.h"
 
 /* This function receives the address of a complex matrix with the quantum
- * state, the address of a temporary complex matrix and a structure with
- * the simulation options. The first dimension of the array
- * gives the number of the detector, while the second dimension gives the
- * x and y coordinates. For example, detectors_pts[3][0] is the x coordinate
- * of the third detector, while detectors_pts[3][1] is the y coordinate.
+ * state, a structure with the simulation options, the number of the 
+ * iteration, which gives the support of the state (see getSupport2D), 
+ * and the stream of random numbers used in the measurement (see 
+ * getRandom). The detectors are given by opts.detector_pts: the first 
+ * dimension of the array gives the number of the detector, while the 
+ * second dimension gives the x and y coordinates. For example, 
+ * detectors_pts[3][0] is the x coordinate of the third detector, while 
+ * detectors_pts[3][1] is the y coordinate. The state collapses in place,
+ * and only the sites of the detectors and the support of the state are
+ * visited.
  * If the operation is successful it returns the result of the measurement 
  * (i.e., the number of the detector where the particle was found). 
  * Otherwise, the function returns a negative error number.
@@ -38,29 +46,50 @@
  *   -2: invalid lattice size
  *   -3: invalid number of detectors
  *   -4: invalid array of detector coordinates
- *   -5: not enough memory
- *   -6: could not clean array
+ *   -5: invalid iteration number
  */
-int measureState2D(double complex *****A, double complex *****Atemp, 
-		   options2D_t opts);
+int measureState2D(complex4D_t *A, options2D_t opts, int iteration, 
+		   rng_t *rng);
 
 
-/* Performs random measurements over a 2D lattice.
+/* Performs random measurements over a 2D lattice: each site is measured
+ * with probability opts.dtProb, using the stream of random numbers rng
+ * (see getRandom and getSkip). It receives the address of the quantum 
+ * state, the simulation options and the number of the iteration, which
+ * gives the support of the state (see getSupport2D). If stat is not 
+ * NULL, the statistics of the measured state are stored there, exactly
+ * as getStatisticsFromState2D would give them, without another pass 
+ * over the lattice. This is not possible when the mixing time is being
+ * calculated.
  *
+ * Error numbers
+ *    0: success
+ *   -1: invalid matrix passed
+ *   -2: invalid lattice size
+ *   -3: invalid iteration number
+ *   -4: statistics requested together with the mixing time
  */
-int randMeasure2D(double complex *****A, options2D_t opts);
+int randMeasure2D(complex4D_t *A, options2D_t opts, int iteration, 
+		  rng_t *rng, statistics_t *stat);
 
 
 
-/* Performs random measurements over a 1D lattice.
+/* Performs random measurements over a 1D lattice: each site is measured
+ * with probability opts.dtProb, using the stream of random numbers rng 
+ * (see getRandom and getSkip).
  *
+ * Error numbers
+ *    0: success
+ *   -1: invalid matrix passed
+ *   -2: invalid lattice size
  */
-int randMeasure1D(double complex ***A, options1D_t opts);
+int randMeasure1D(double complex ***A, options1D_t opts, rng_t *rng);
 
 
 /* This function receives the address of a complex matrix with the quantum
- * state, the address of a temporary complex matrix and a structure with
- * the simulation options. 
+ * state, a structure with the simulation options and the stream of 
+ * random numbers used in the measurement (see getRandom). The state
+ * collapses in place (see measureState2D).
  * If the operation is successful it returns the result of the measurement 
  * (i.e., the number of the detector where the particle was found). 
  * Otherwise, the function returns a negative error number.
@@ -71,11 +100,8 @@ int randMeasure1D(double complex ***A, options1D_t opts);
  *   -2: invalid lattice size
  *   -3: invalid number of detectors
  *   -4: invalid array of detector coordinates
- *   -5: not enough memory
- *   -6: could not clean array
  */
-int measureState1D(double complex ***A, double complex ***Atemp, 
-		   options1D_t opts);
+int measureState1D(double complex ***A, options1D_t opts, rng_t *rng);
 
 
 #endif
@@ -20,6 +20,28 @@
 #ifndef _QWMEM_COMPLEX
 #define _QWMEM_COMPLEX
 
+#include<complex.h>
+
+/* Contiguous 4D complex matrix. All the entries are stored in a single
+ * block of memory, aligned to MEM_ALIGN bytes, and entry (i,j,k,m) is
+ * found at data[i*stride[0] + j*stride[1] + k*stride[2] + m*stride[3]].
+ * The field block keeps the address returned by malloc, so that the
+ * memory can be released later by freeTensor4D.
+ */
+typedef struct{
+  double complex *data;
+  void *block;
+  int dim[4];
+  long stride[4];
+}complex4D_t;
+
+/* Entry (i,j,k,m) of a complex4D_t structure. */
+#define ENTRY4D(T,i,j,k,m) ((T).data[(i)*(T).stride[0] + (j)*(T).stride[1] + \
+				     (k)*(T).stride[2] + (m)*(T).stride[3]])
+
+/* Number of entries of a complex4D_t structure. */
+#define SIZE4D(T) ((size_t)(T).dim[0]*(T).dim[1]*(T).dim[2]*(T).dim[3])
+
 
 /* This function receives four integers as arguments, and returns a pointer
  * to a 4D complex matrix, with dimensions according to those integers 
@@ -156,5 +178,55 @@ int copyComplex3D(double complex ***dest, double complex ***src, int dim1, int d
  */
 int copyComplex2D(double complex **dest, double complex **src, int dim1, int dim2);
 
+
+/* This function receives four integers as arguments, and returns a 
+ * complex4D_t structure with dimensions according to those integers
+ * passed. The entries are stored contiguously, with the last index
+ * varying fastest. If the dimensions passed are not valid, or if for 
+ * any other reason the matrix cannot be allocated, then the field data
+ * of the structure returned is NULL.
+ */
+complex4D_t allocTensor4D(int dim1, int dim2, int dim3, int dim4);
+
+
+/* This function is similar to allocTensor4D, but the two last indexes
+ * vary slowest, i.e., the dim1*dim2 entries (.,.,k,m) are stored next to 
+ * each other. For a quantum state it means that the amplitudes of all 
+ * coin states of one site are contiguous in memory.
+ */
+complex4D_t allocSiteTensor4D(int dim1, int dim2, int dim3, int dim4);
+
+
+/* This function receives the address of a complex4D_t structure and
+ * frees the memory occupied by its entries.
+ *
+ * Error numbers
+ *   0: success
+ *   2: invalid matrix
+ */
+int freeTensor4D(complex4D_t *tensor);
+
+
+/* This function receives a complex4D_t structure and assigns zero to
+ * each of its entries.
+ *
+ * Error numbers
+ *   0: success
+ *   2: invalid matrix
+ */
+int cleanTensor4D(complex4D_t tensor);
+
+
+/* This function receives two complex4D_t structures and copies the 
+ * second one into the first one. Both structures must have the same
+ * dimensions and the same strides.
+ *
+ * Error numbers
+ *   0: success
+ *   1: invalid dimensions
+ *   2: invalid matrix
+ */
+int copyTensor4D(complex4D_t dest, complex4D_t src);
+
 #endif
 
@@ -20,6 +20,24 @@
 #ifndef _QWOPTIONS_IO
 #define _QWOPTIONS_IO
 
+#include "qwinput.h"
+
+/* Region of the lattice where the wave function may be non-zero (its
+ * support). In each axis the region starts at site lo and has len 
+ * sites, in the computational coordinates. In the cyclic lattices the 
+ * region may wrap around the end of the lattice. If len is zero the
+ * region is the whole lattice.
+ */
+typedef struct{
+  int lo;
+  int len;
+}support1D_t;
+
+typedef struct{
+  int lo[2];
+  int len[2];
+}support2D_t;
+
 typedef struct{
   unsigned char error;
   unsigned char coinType;
@@ -27,18 +45,27 @@ typedef struct{
   unsigned char lattType;
   float blProb;
   float dtProb;
+  float mixTol;
+  float mixError;
   int steps;
   int max;
   int lattextra;
   int numOfExperiments;
   int stepsAfterMeasure;
   int stepsMix;
+  int expThreads;
+  int statEvery;
+  int checkEvery;
+  unsigned char resume;
   unsigned char calcMix;
   unsigned char checkState;
   unsigned char checkSymmetry;
+  unsigned char waveBinary;
+  char *stateFile;
   int detectors;
   int *detector_pts;
   int seed;
+  support1D_t support;
 }options1D_t;
 
 typedef struct{
@@ -47,37 +74,52 @@ typedef struct{
   unsigned char stateType;
   unsigned char blType;
   unsigned char lattType;
+  unsigned char layout;
   float blProbA;
   float blProbB;
   float dtProb;
+  float mixTol;
+  float mixError;
   int steps;
   int max;
   int lattextra;
   int numOfExperiments;
   int stepsAfterMeasure;
   int stepsMix;
+  int threads;
+  int expThreads;
+  int statEvery;
+  int checkEvery;
+  int snapEvery;
+  int snapType;
+  int snapStride;
+  unsigned char resume;
+  unsigned char fusedStats;
   unsigned char calcMix;
   unsigned char checkState;
   unsigned char checkXSymmetry;
   unsigned char checkYSymmetry;
+  unsigned char waveBinary;
+  char *stateFile;
   unsigned char screen;
   int screen_pta[2];
   int screen_ptb[2];
   int detectors;
   int **detector_pts;
   int seed;
+  support2D_t support;
 }options2D_t;
 
 
-/* This function receives a string containing the name of the input file.
- * It reads the input, identifying keywords and storing the simulation
- * options in a structure options1D_t. The function returns a structure 
+/* This function receives an input file read by readInputFile (see
+ * qwinput.h). It reads the input, identifying keywords and storing the
+ * simulation options in a structure options1D_t. The function returns a structure 
  * options1D_t containing all important options for simulation, such as 
  * coin type, inicial state, number of steps, size of lattice, etc.
  *
  * Error numbers:
  *   0: operation successful (no error)
- *   1: could not open input file
+ *   1: could not open input file (the input is NULL)
  *   2: invalid coin in input file.
  *   3: invalid state in input file.
  *   4: invalid number of steps in input file.
@@ -90,19 +132,31 @@ typedef struct{
  *  11: invalid lattice type
  *  12: invalid number of steps in mixing time calculation
  *  13: invalid probability (measuments or broken links)
+ *  14: invalid number of detectors
+ *  15: invalid number of threads for experiments
+ *  16: invalid interval between statistics
+ *  17: invalid tolerance for the stationary distribution
+ *  18: invalid format of the wave-function file
+ *  19: invalid interval between checkpoints
+ */
+options1D_t readOptions1D(const inputfile_t *input);
+
+
+/* This function works as readOptions1D, but it receives the name of the
+ * input file, which is read only to get the options.
  */
 options1D_t readOptionsFile1D(const char *filename);
 
 
-/* This function receives a string containing the name of the input file.
- * It reads the input, identifying keywords and storing the simulation
- * options in a structure options2D_t. The function returns the structure 
+/* This function receives an input file read by readInputFile (see
+ * qwinput.h). It reads the input, identifying keywords and storing the
+ * simulation options in a structure options2D_t. The function returns the structure 
  * options2D_t containing all important options for simulation, such as 
  * coin type, inicial state, number of steps, lattice size, etc.
  *
  * Error numbers:
  *   0: success
- *   1: could not open input file
+ *   1: could not open input file (the input is NULL)
  *   2: invalid coin
  *   3: invalid state
  *   4: invalid number of steps
@@ -115,6 +169,20 @@ options1D_t readOptionsFile1D(const char *filename);
  *  11: invalid probability (measuments or broken links)
  *  12: invalid number of steps in mixing time calculation
  *  13: invalid lattice type
+ *  14: invalid memory layout
+ *  15: invalid number of threads
+ *  16: invalid number of threads for experiments
+ *  17: invalid interval between statistics
+ *  18: invalid tolerance for the stationary distribution
+ *  19: invalid format of the wave-function file
+ *  20: invalid interval between checkpoints
+ *  21: invalid snapshot option
+ */
+options2D_t readOptions2D(const inputfile_t *input);
+
+
+/* This function works as readOptions2D, but it receives the name of the
+ * input file, which is read only to get the options.
  */
 options2D_t readOptionsFile2D(const char *filename);
 
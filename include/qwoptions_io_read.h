@@ -21,37 +21,53 @@
 #define _QWOPTIONS_IO_READ
 
 #include "qwoptions_io.h"
+#include "qwinput.h"
 
-int readOptions_coin2D(FILE *in, options2D_t *options);
-int readOptions_state2D(FILE *in, options2D_t *options);
-int readOptions_steps2D(FILE *in, options2D_t *options);
-int readOptions_afterm2D(FILE *in, options2D_t *options);
-int readOptions_cmix2D(FILE *in, options2D_t *options);
-int readOptions_check2D(FILE *in, options2D_t *options);
-int readOptions_blprob2D(FILE *in, options2D_t *options);
-int readOptions_dtprob2D(FILE *in, options2D_t *options);
-int readOptions_exp2D(FILE *in, options2D_t *options);
-int readOptions_lsize2D(FILE *in, options2D_t *options);
-int readOptions_lextra2D(FILE *in, options2D_t *options);
-int readOptions_ltype2D(FILE *in, options2D_t *options);
-int readOptions_detec2D(FILE *in, options2D_t *options);
-int readOptions_seed2D(FILE *in, options2D_t *options);
-int readOptions_screen2D(FILE *in, options2D_t *options);
-int readOptions_blperm2D(FILE *in, options2D_t *options);
+int readOptions_coin2D(inputfile_t *in, options2D_t *options);
+int readOptions_state2D(inputfile_t *in, options2D_t *options);
+int readOptions_steps2D(inputfile_t *in, options2D_t *options);
+int readOptions_afterm2D(inputfile_t *in, options2D_t *options);
+int readOptions_cmix2D(inputfile_t *in, options2D_t *options);
+int readOptions_mixtol2D(inputfile_t *in, options2D_t *options);
+int readOptions_check2D(inputfile_t *in, options2D_t *options);
+int readOptions_blprob2D(inputfile_t *in, options2D_t *options);
+int readOptions_dtprob2D(inputfile_t *in, options2D_t *options);
+int readOptions_exp2D(inputfile_t *in, options2D_t *options);
+int readOptions_lsize2D(inputfile_t *in, options2D_t *options);
+int readOptions_lextra2D(inputfile_t *in, options2D_t *options);
+int readOptions_ltype2D(inputfile_t *in, options2D_t *options);
+int readOptions_detec2D(inputfile_t *in, options2D_t *options);
+int readOptions_seed2D(inputfile_t *in, options2D_t *options);
+int readOptions_screen2D(inputfile_t *in, options2D_t *options);
+int readOptions_blperm2D(inputfile_t *in, options2D_t *options);
+int readOptions_layout2D(inputfile_t *in, options2D_t *options);
+int readOptions_threads2D(inputfile_t *in, options2D_t *options);
+int readOptions_fused2D(options2D_t *options);
+int readOptions_statevery2D(inputfile_t *in, options2D_t *options);
+int readOptions_wformat2D(inputfile_t *in, options2D_t *options);
+int readOptions_checkpoint2D(inputfile_t *in, options2D_t *options);
+int readOptions_snapshot2D(inputfile_t *in, options2D_t *options);
+int readOptions_snapstride2D(inputfile_t *in, options2D_t *options);
+int readOptions_expthreads2D(inputfile_t *in, options2D_t *options);
 
-int readOptions_coin1D(FILE *in, options1D_t *options);
-int readOptions_state1D(FILE *in, options1D_t *options);
-int readOptions_steps1D(FILE *in, options1D_t *options);
-int readOptions_check1D(FILE *in, options1D_t *options);
-int readOptions_blprob1D(FILE *in, options1D_t *options);
-int readOptions_dtprob1D(FILE *in, options1D_t *options);
-int readOptions_exp1D(FILE *in, options1D_t *options);
-int readOptions_seed1D(FILE *in, options1D_t *options);
-int readOptions_lsize1D(FILE *in, options1D_t *options);
-int readOptions_lextra1D(FILE *in, options1D_t *options);
-int readOptions_ltype1D(FILE *in, options1D_t *options);
-int readOptions_cmix1D(FILE *in, options1D_t *options);
-int readOptions_detec1D(FILE *in, options1D_t *options);
-int readOptions_afterm1D(FILE *in, options1D_t *options);
+int readOptions_coin1D(inputfile_t *in, options1D_t *options);
+int readOptions_state1D(inputfile_t *in, options1D_t *options);
+int readOptions_steps1D(inputfile_t *in, options1D_t *options);
+int readOptions_check1D(inputfile_t *in, options1D_t *options);
+int readOptions_blprob1D(inputfile_t *in, options1D_t *options);
+int readOptions_dtprob1D(inputfile_t *in, options1D_t *options);
+int readOptions_exp1D(inputfile_t *in, options1D_t *options);
+int readOptions_seed1D(inputfile_t *in, options1D_t *options);
+int readOptions_lsize1D(inputfile_t *in, options1D_t *options);
+int readOptions_lextra1D(inputfile_t *in, options1D_t *options);
+int readOptions_ltype1D(inputfile_t *in, options1D_t *options);
+int readOptions_cmix1D(inputfile_t *in, options1D_t *options);
+int readOptions_mixtol1D(inputfile_t *in, options1D_t *options);
+int readOptions_detec1D(inputfile_t *in, options1D_t *options);
+int readOptions_afterm1D(inputfile_t *in, options1D_t *options);
+int readOptions_expthreads1D(inputfile_t *in, options1D_t *options);
+int readOptions_statevery1D(inputfile_t *in, options1D_t *options);
+int readOptions_wformat1D(inputfile_t *in, options1D_t *options);
+int readOptions_checkpoint1D(inputfile_t *in, options1D_t *options);
 
 #endif
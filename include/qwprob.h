@@ -20,6 +20,9 @@
 #ifndef _QWPROB
 #define _QWPROB
 
+#include "qwoptions_io.h"
+#include "qwmem_complex.h"
+
 
 /* This function receives a complex matrix and an integer as arguments. 
  * The complex matrix must be a valid quantum state. It is a 4D-matrix 
@@ -34,8 +37,11 @@
  * the particle in the corresponding position of the lattice.
  * If the function cannot allocate enough memory for the matrix, or
  * if an invalid array is passed then it returns NULL.
+ * The integer steps is the number of steps already simulated. Only the
+ * region of the lattice reached by the walker (see getSupport2D) is 
+ * visited, and the other probabilities are set to zero.
  */
-double **getProbArray2D(double complex ****matrix, options2D_t opts);
+double **getProbArray2D(complex4D_t matrix, options2D_t opts, int steps);
 
 
 /* This function receives a complex matrix and a structure options1D_t. 
@@ -87,8 +93,9 @@ int checkProb1D(double *matrix, int max, unsigned int lattType);
 /* This function receives the address of a real (double precision) vector, 
  * a complex matrix and a structure options1D_t. The real vector stores the
  * average probabilities of the experiments. This function must be called
- * always with the same address for the real vector. The complex matrix 
- * contains the quantum state. The options1D_t strucuture contains 
+ * always with the same address for the real vector, and *aveMatrix must
+ * be NULL in the first call, when the vector is allocated. The complex 
+ * matrix contains the quantum state. The options1D_t strucuture contains 
  * simulation options. In each call the probability of finding 
  * the particle in each site is calculated, divided by the number 
  * of experiments and the vector pointed by *aveMatrix is updated. In 
@@ -97,21 +104,21 @@ int checkProb1D(double *matrix, int max, unsigned int lattType);
  *
  * Error numbers
  *   0: success
- *   1: invalid number of experiments; or function called more times than 
- *      the number of experiments expected.
+ *   1: invalid number of experiments
  *   2: invalid address passed
  *   3: could not allocate memory for the vector of probabilities
- *   4: invalid matrix passed in subsequent calls
  */
 int averageProbFromState1D(double **aveMatrix, double complex **state, 
 			   options1D_t options);
 
 
 /* This function receives the address of a real (double precision) matrix, 
- * a complex matrix and a structure options2D_t. The real matrix stores the
+ * a complex matrix, a structure options2D_t and the number of steps
+ * simulated (see getProbArray2D). The real matrix stores the
  * average probabilities of the experiments. This function must be called
- * always with the same address for the real matrix. The complex matrix 
- * contains the quantum state. The options2D_t strucuture contains 
+ * always with the same address for the real matrix, and *aveMatrix must
+ * be NULL in the first call, when the matrix is allocated. The complex 
+ * matrix contains the quantum state. The options2D_t strucuture contains 
  * simulation options. In each call the probability of 
  * finding the particle in each site is calculated, divided 
  * by the number of experiments and the matrix pointed by *aveMatrix 
@@ -120,14 +127,12 @@ int averageProbFromState1D(double **aveMatrix, double complex **state,
  *
  * Error numbers
  *   0: success
- *   1: invalid number of experiments; or function called more times than 
- *      the number of experiments expected.
+ *   1: invalid number of experiments
  *   2: invalid address passed
  *   3: could not allocate memory for the vector of probabilities
- *   4: invalid matrix passed in subsequent calls
  */
-int averageProbFromState2D(double ***aveMatrix, double complex ****state, 
-			   options2D_t options);
+int averageProbFromState2D(double ***aveMatrix, complex4D_t state, 
+			   options2D_t options, int steps);
 
 #endif
 
@@ -0,0 +1,71 @@
+/* QWalk (qwrandom.h)
+ * Copyright (C) 2008  Franklin Marquezino
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#ifndef _QWRANDOM
+#define _QWRANDOM
+
+/* State of an independent stream of pseudorandom numbers. Each 
+ * experiment of a simulation has its own stream, so that many
+ * experiments can run at the same time and the results do not depend
+ * on the number of threads. The stream is counter-based: its numbers
+ * are a function of the seed, of the number of the stream and of the
+ * position in the stream only.
+ */
+typedef struct{
+  unsigned int key[2];
+  unsigned long long counter;
+  unsigned int block[4];
+  int used;
+}rng_t;
+
+
+/* This function receives the address of a structure rng_t, the seed of 
+ * the simulation and the number of a stream (usually the number of the
+ * experiment). It initializes the structure at the beginning of the
+ * stream. Different streams obtained from the same seed do not overlap.
+ */
+void initRandom(rng_t *rng, int seed, int stream);
+
+
+/* This function receives the address of a structure rng_t and a 
+ * position, and moves the stream to this position, so that the next
+ * call to getRandom returns the number with this index (starting from
+ * zero) in the stream. It takes the same time for any position.
+ */
+void seekRandom(rng_t *rng, unsigned long long position);
+
+
+/* This function receives the address of a structure rng_t and returns
+ * the next pseudorandom number of that stream, uniformly distributed 
+ * in [0,1), with 53 random bits.
+ */
+double getRandom(rng_t *rng);
+
+
+/* This function receives the address of a structure rng_t, a 
+ * probability p and a positive integer max. It returns the number of 
+ * failures before the next success in a sequence of independent trials
+ * with probability of success p (a geometric distribution), or max if
+ * this number is greater than max. Skipping this number of trials at
+ * once gives the same distribution as testing each one of them with
+ * getRandom, using a single random number for each success.
+ */
+long long getSkip(rng_t *rng, double p, long long max);
+
+#endif
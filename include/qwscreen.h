@@ -20,6 +20,8 @@
 #ifndef _QWSCREEN
 #define _QWSCREEN
 
+#include "qwmem_complex.h"
+
 typedef struct{
   int xa;
   int xb;
@@ -61,7 +63,7 @@ int initScreen(screen_t *screen, int xa, int ya, int xb, int yb);
  *   2: invalid state matrix
  *   3: invalid lattice size
  */
-int updateScreen(screen_t *screen, double complex ****state, int max);
+int updateScreen(screen_t *screen, complex4D_t state, int max);
 
 
 #endif
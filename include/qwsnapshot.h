@@ -0,0 +1,83 @@
+/* QWalk (qwsnapshot.h)
+ * Copyright (C) 2008  Franklin Marquezino
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#ifndef _QWSNAPSHOT
+#define _QWSNAPSHOT
+
+#include "qwoptions_io.h"
+#include "qwmem_complex.h"
+#include "qwwriter.h"
+
+/* A snapshot file (see keyword SNAPSHOT) starts with this header,
+ * followed by frames of frameBytes bytes, in the byte order of the
+ * machine that wrote them. Each frame starts with its step, as a long
+ * long, followed by rows x cols values, row after row: the
+ * probabilities of the sites, as doubles (PROB_SNAPSHOT), or the four
+ * amplitudes of each site, as double complex numbers in the order
+ * (0,0), (0,1), (1,0), (1,1) of the coin (WAVE_SNAPSHOT). Row M and
+ * column N of a frame correspond to the block of stride x stride sites
+ * of the array of the simulation that starts at row M*stride and column
+ * N*stride: the probabilities are summed over the block, and the
+ * amplitudes are the ones of its first site. Frame k holds step
+ * k*every, so it starts at byte sizeof(snapheader_t) + k*frameBytes.
+ */
+#define SNAP_MAGIC "QWSNAP"
+#define SNAP_VERSION 1
+
+typedef struct{
+  char magic[8];
+  long long frameBytes;
+  int version;
+  int dimension;    /* 2 */
+  int type;         /* PROB_SNAPSHOT or WAVE_SNAPSHOT */
+  int every;        /* steps between two frames */
+  int stride;
+  int rows;
+  int cols;
+  int lattType;
+  int max;
+  int steps;        /* steps of the simulation */
+  int seed;
+  int reserved;
+}snapheader_t;
+
+
+
+/* This function opens the snapshot file filename of a 2D simulation and
+ * returns an asynchronous writer (see qwwriter.h) to which the frames
+ * are sent by sendSnapshot2D. If resumeStep is negative, the file is
+ * created with its header. Otherwise, the frames up to step resumeStep
+ * must already be in the file (written by the same simulation, which
+ * was interrupted), and the following frames are written after them.
+ * The file is closed by closeWriter. Returns NULL if the file cannot be
+ * created, or if it does not have the frames expected.
+ */
+asyncwriter_t *openSnapshots2D(const char *filename, options2D_t options,
+			       int resumeStep);
+
+
+/* This function sends the frame of the given step of state to a writer
+ * opened by openSnapshots2D. Only the region reached by the walker is
+ * read (see getSupport2D). It returns 1 if the frame cannot be written,
+ * and 0 otherwise.
+ */
+int sendSnapshot2D(asyncwriter_t *writer, complex4D_t state,
+		   options2D_t options, int step);
+
+#endif
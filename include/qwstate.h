@@ -21,6 +21,18 @@
 #define _QWSTATE
 
 #include "qwoptions_io.h"
+#include "qwmem_complex.h"
+
+/* This function receives an integer max describing the size of the
+ * lattice, the type of lattice and the memory layout (COIN_LAYOUT or
+ * SITE_LAYOUT). It returns an empty 4D matrix with the appropriate
+ * dimensions to store a quantum state, with all entries equal to zero.
+ * If max is lower or equal zero, or if for any reason the operating
+ * system cannot allocate enough memory, then the field data of the
+ * result is NULL. The functions below that create quantum states also
+ * receive the layout, which they pass to this function.
+ */
+complex4D_t allocState2D(int max, unsigned int lattType, unsigned int layout);
 
 /* This function receives an integer max as argument, where max describes the
  * size of the lattice used in the simulation. We consider that the lattice
@@ -28,13 +40,15 @@
  * The function returns a matrix with a quantum state that can be used as 
  * initial condition for a simulation, giving maximum dispersion for Grover 
  * coin. If max is lower or equal zero, of if for any reason the operating 
- * system cannot allocate enough memory, then we return NULL. Note that the 
- * resulting matrix is 4D. The first two indexes indicate the coin and the 
- * two last indexes indicate the position of the particle in a 2D lattice.
+ * system cannot allocate enough memory, then the field data of the result
+ * is NULL. Note that the resulting matrix is 4D. The first two indexes 
+ * indicate the coin and the two last indexes indicate the position of the
+ * particle in a 2D lattice.
  * The value in each entry of this matrix is a complex amplitude of the 
  * quantum state.
  */
-double complex ****createGroverState2D(int max, unsigned int lattType);
+complex4D_t createGroverState2D(int max, unsigned int lattType, 
+				  unsigned int layout);
 
 
 /* This function receives an integer max as argument, where max describes 
@@ -43,13 +57,14 @@ double complex ****createGroverState2D(int max, unsigned int lattType);
  * in the Y axis. The function returns a matrix with a quantum state that 
  * can be used as initial condition for a simulation, giving maximum 
  * dispersion for Hadamard coin. If max is lower or equal zero, of if for 
- * any reason the operating system cannot allocate enough memory, then we 
- * return NULL. Note that the resulting matrix is 4D. The first two indexes 
- * indicate the coin and the two last indexes indicate the position of 
- * the particle in a 2D lattice. The value in each entry of this matrix 
- * is a complex amplitude of the quantum state.
+ * any reason the operating system cannot allocate enough memory, then the
+ * field data of the result is NULL. Note that the resulting matrix is 4D. 
+ * The first two indexes indicate the coin and the two last indexes 
+ * indicate the position of the particle in a 2D lattice. The value in 
+ * each entry of this matrix is a complex amplitude of the quantum state.
  */
-double complex ****createHadamardState2D(int max, unsigned int lattType);
+complex4D_t createHadamardState2D(int max, unsigned int lattType, 
+				  unsigned int layout);
 
 
 /* This function receives an integer max as argument, where max describes 
@@ -59,12 +74,13 @@ double complex ****createHadamardState2D(int max, unsigned int lattType);
  * can be used as initial condition for a simulation, giving maximum 
  * dispersion for Fourier coin. If max is lower or equal zero, of if for 
  * any reason the operating system cannot allocate enough memory, then 
- * we return NULL. Note that the resulting matrix is 4D. The first two 
- * indexes indicate the coin and the two last indexes indicate the position 
- * of the particle in a 2D lattice. The value in each entry of this matrix 
- * is a complex amplitude of the quantum state.
+ * the field data of the result is NULL. Note that the resulting matrix 
+ * is 4D. The first two indexes indicate the coin and the two last indexes
+ * indicate the position of the particle in a 2D lattice. The value in 
+ * each entry of this matrix is a complex amplitude of the quantum state.
  */
-double complex ****createFourierState2D(int max, unsigned int lattType);
+complex4D_t createFourierState2D(int max, unsigned int lattType, 
+				  unsigned int layout);
 
 
 /* This function receives an integer max as argument, where max describes 
@@ -95,7 +111,7 @@ double complex **createHadamardState1D(int max,  unsigned int lattType);
  *   0: not unitary
  *   1: unitary
  */
-int checkState2D(double complex ****matrix, options2D_t options);
+int checkState2D(complex4D_t matrix, options2D_t options);
 
 
 /* This function receives a complex matrix and a structure options1D_t. The
@@ -139,7 +155,7 @@ int checkSymmetry1D(double complex **matrix, int max);
  *   0: not symmetrical
  *   1: symmetrical
  */
-int checkXSymmetry2D(double complex ****matrix, int max);
+int checkXSymmetry2D(complex4D_t matrix, int max);
 
 
 /* This function receives a complex matrix representing a quantum state
@@ -155,7 +171,83 @@ int checkXSymmetry2D(double complex ****matrix, int max);
  *   0: not symmetrical
  *   1: symmetrical
  */
-int checkYSymmetry2D(double complex ****matrix, int max);
+int checkYSymmetry2D(complex4D_t matrix, int max);
+
+
+/* This function receives the region of one axis of the lattice where 
+ * the wave function may be non-zero (see support1D_t and support2D_t),
+ * described by its first site lo and its length len, and the size of 
+ * the axis. It splits the region in at most two intervals of sites
+ * range[i][0] <= m < range[i][1], given in increasing order, and 
+ * returns the number of intervals. A region wraps around the end of
+ * the lattice only in the cyclic lattices.
+ */
+int getSupportRanges(int lo, int len, int size, int range[2][2]);
+
+
+/* This function receives a quantum state and the simulation options.
+ * It returns the smallest rectangle (which may wrap around the lattice
+ * in the CYCLE lattice) containing all the non-zero amplitudes of 
+ * the state. The result is usually stored in options.support, right
+ * after the initial state is created.
+ */
+support2D_t getStateSupport2D(complex4D_t state, options2D_t opts);
+
+
+/* This function receives the simulation options and a number of steps.
+ * It returns the region of the lattice where the wave function may be 
+ * non-zero after that number of steps. In the CYCLE lattice the region
+ * grows from options.support, one site in each direction per step, 
+ * until it covers the whole lattice. In the other lattices it is the
+ * square used by iterate2D, which depends on LATTEXTRA.
+ */
+support2D_t getSupport2D(options2D_t opts, int steps);
+
+
+/* A state template keeps only the non-zero amplitudes of a quantum state
+ * (usually the initial state of the experiments), with their positions
+ * in the field data of the state, and its support (see
+ * getStateSupport2D). The state may then be set again in an array of
+ * the same size and layout, without building it from the input file.
+ */
+typedef struct{
+  size_t numEntries;
+  size_t *offset;
+  double complex *value;
+  support2D_t support;
+}statetemplate2D_t;
+
+
+/* This function receives the address of a template, a quantum state and
+ * the simulation options, and stores the state in the template, which
+ * must be freed with freeStateTemplate2D. Returns 1 if there is not
+ * enough memory (and then the template is empty), and 0 otherwise.
+ */
+int newStateTemplate2D(statetemplate2D_t *tmpl, complex4D_t state,
+		       options2D_t opts);
+
+
+/* This function sets state to the state kept in tmpl. The array state
+ * must have the size and layout of the state stored in the template and
+ * be zero outside the region where a walker that started from the
+ * template may be after the given number of steps (see getSupport2D):
+ * only this region is cleaned. If steps is negative, the whole array
+ * is cleaned.
+ */
+void copyStateTemplate2D(complex4D_t state, const statetemplate2D_t *tmpl,
+			 options2D_t opts, int steps);
+
+
+/* This function frees the arrays of a template. */
+void freeStateTemplate2D(statetemplate2D_t *tmpl);
+
+
+/* These functions are the one-dimensional versions of getStateSupport2D
+ * and getSupport2D. The SEGMENT lattice has no wrap around, so its region 
+ * just stops growing at the ends of the lattice.
+ */
+support1D_t getStateSupport1D(double complex **state, options1D_t opts);
+support1D_t getSupport1D(options1D_t opts, int steps);
 
 #endif
 
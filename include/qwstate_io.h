@@ -21,8 +21,38 @@
 #define _QWSTATE_IO
 
 #include "qwoptions_io.h"
-
-/* This function receives as input the name of the file that contains
+#include "qwmem_complex.h"
+
+/* Binary state files (see writeStateBinary2D) start with this header,
+ * followed by the amplitudes, as a raw array of complex numbers in the
+ * byte order of the machine that wrote them. magic is STATE_MAGIC and
+ * version is STATE_VERSION. The walker of a state of the NATURAL,
+ * DIAGONAL or LINE lattices is inside the square (or interval) of 
+ * half-width lattextra+steps around the origin.
+ */
+#define STATE_MAGIC "QWSTATE"
+#define STATE_VERSION 1
+
+typedef struct{
+  char magic[8];
+  long long size;   /* number of amplitudes after the header */
+  int version;
+  int dimension;    /* 1 or 2 */
+  int lattType;
+  int layout;       /* memory layout of the amplitudes (2D only) */
+  int max;
+  int lattextra;
+  int steps;        /* steps simulated to obtain the state */
+  int seed;
+  int coinType;
+  int stateType;
+  float blProb[2];
+  float dtProb;
+  int reserved;
+}stateheader_t;
+
+
+/* This function receives the input file (see qwinput.h) which contains
  * the definition of the state. It also receives a positive integer
  * describing the size of the lattice and an unsigned int
  * describing the type of lattice. We consider that the LINE lattice
@@ -31,19 +61,34 @@
  * this function returns a complex 2D-matrix corresponding to the
  * state. Otherwise, the function returns NULL.
  */
+double complex **readState1D(const inputfile_t *input, int max,
+			     unsigned int lattType);
+
+
+/* This function works as readState1D, but it receives the name of the
+ * input file.
+ */
 double complex **readStateFile1D(const char *filename, int max,
 				 unsigned int lattType);
 
 
-/* This function receives as input the name of the file that contains
+/* This function receives the input file (see qwinput.h) which contains
  * the definition of the state. It also receives a positive integer
- * describing the size of the lattice. We consider that the lattice
+ * describing the size of the lattice, the type of lattice and the
+ * memory layout of the matrix. We consider that the lattice
  * coordinates range from -max to max. If the input file is correct,
  * this function returns a complex 4D-matrix corresponding to the
- * state. Otherwise, the function returns NULL.
+ * state. Otherwise, the field data of the structure returned is NULL.
+ */
+complex4D_t readState2D(const inputfile_t *input, int max,
+			unsigned int lattType, unsigned int layout);
+
+
+/* This function works as readState2D, but it receives the name of the
+ * input file.
  */
-double complex ****readStateFile2D(const char *filename, int max,
-				   unsigned int lattType);
+complex4D_t readStateFile2D(const char *filename, int max,
+			    unsigned int lattType, unsigned int layout);
 
 
 
@@ -64,10 +109,11 @@ int writeState1D(const char *filename, double complex **wave, options1D_t option
 
 
 /* This function receives as input a string containing the name of the file
- * that will be written. It also receives an array with the amplitudes and a
- * structure containing the simulation options. The function writes the
- * amplitudes in the file, making the appropriate conversions of 
- * coordinates whenever necessary.
+ * that will be written. It also receives an array with the amplitudes, a
+ * structure containing the simulation options and the number of steps
+ * simulated. The function writes the non-zero amplitudes in the file,
+ * looking only at the region reached by the walker (see getSupport2D)
+ * and making the appropriate conversions of coordinates whenever necessary.
  * The function also writes a header in the file, describing the options
  * used in the simulation.
  *
@@ -75,7 +121,57 @@ int writeState1D(const char *filename, double complex **wave, options1D_t option
  *   0: success
  *   1: could not open file
  */
-int writeState2D(const char *filename, double complex ****wave, options2D_t options);
+int writeState2D(const char *filename, complex4D_t wave, options2D_t options,
+		 int steps);
+
+
+
+/* These functions write the state in a binary state file: the header
+ * (see stateheader_t) followed by the whole array of amplitudes, as it
+ * is in memory. They receive the name of the file, the state, the 
+ * simulation options and the number of steps simulated.
+ *
+ * Error numbers:
+ *   0: success
+ *   1: could not open file
+ *   2: could not write file
+ */
+int writeStateBinary1D(const char *filename, double complex **wave, 
+		       options1D_t options, int steps);
+int writeStateBinary2D(const char *filename, complex4D_t wave, 
+		       options2D_t options, int steps);
+
+
+
+/* These functions receive the name of a binary state file and the
+ * simulation options, and check whether the state of the file may be
+ * used as the initial state of the simulation. The lattice type must 
+ * be the same. In the CYCLE and SEGMENT lattices the size of the 
+ * lattice must be the same, and in the other ones the walker must be
+ * inside the region of half-width LATTEXTRA around the origin (see 
+ * iterate2D), whatever the size of the lattices.
+ *
+ * Error numbers:
+ *   0: success
+ *   1: could not open file
+ *   2: not a binary state file, or unknown version
+ *   3: the file is truncated
+ *   4: different dimension or lattice type
+ *   5: different lattice size, or walker outside LATTEXTRA
+ */
+int checkStateBinary1D(const char *filename, options1D_t options);
+int checkStateBinary2D(const char *filename, options2D_t options);
+
+
+
+/* These functions read a binary state file, mapping it in memory when
+ * the system allows it, and return the state in the lattice (and the
+ * memory layout) of the simulation. If the file cannot be used (see 
+ * checkStateBinary2D) they return NULL, or a structure whose field 
+ * data is NULL.
+ */
+double complex **readStateBinary1D(const char *filename, options1D_t options);
+complex4D_t readStateBinary2D(const char *filename, options2D_t options);
 
 
 
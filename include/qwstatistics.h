@@ -21,6 +21,7 @@
 #define _QWSTATISTICS
 
 #include "qwoptions_io.h"
+#include "qwmem_complex.h"
 
 typedef struct{
   int iteration;
@@ -31,11 +32,22 @@ typedef struct{
   float meanY;
 }statistics_t;
 
+/* Nonzero if the statistics of the given iteration are computed and
+ * written (see keyword STATEVERY): the multiples of every and the last
+ * step of the simulation.
+ */
+#define STATSTEP(iteration, every, steps) \
+  ((iteration)%(every) == 0 || (iteration) == (steps))
+
 
 /* This function receives a complex matrix representing a quantum state, a
  * real (double precision) matrix representing the approximate stationary
- * distribution, a structure options1D_t with simulation 
- * options, and an integer describing the number of the iteration. 
+ * distribution, a real array SumProb, a structure options1D_t with 
+ * simulation options, and an integer describing the number of the 
+ * iteration. If the mixing time is being calculated, the probabilities
+ * of the state are added to SumProb, which must be cleaned by the caller
+ * before the first iteration of each experiment; otherwise SumProb is
+ * not used and may be NULL. 
  * The function returns a structure statistics_t with 
  * the statistics for that iteration (variance, mean, etc). If something goes 
  * wrong, a negative error number is returned in the iteration field.
@@ -47,13 +59,61 @@ typedef struct{
  *   -3: invalid iteration number
  */
 statistics_t getStatisticsFromState1D(double complex **matrix, double *StatProb,
-				      options1D_t opts, int iteration);
+				      double *SumProb, options1D_t opts, 
+				      int iteration);
+
+
+/* This function receives the simulation options of a 2D walk and 
+ * returns the probability of each site in the uniform distribution,
+ * used in the total variation distance tvdu.
+ */
+double getUniformProb2D(options2D_t opts);
+
+
+/* This function receives the address of a structure statistics_t, the
+ * approximate stationary distribution StatProb, the array SumProb with
+ * the probabilities of the state added up to the given iteration, the
+ * simulation options and the number of the iteration. It stores in the
+ * fields tvd and tvdu the total variation distances of the average 
+ * distribution to the stationary and to the uniform distributions, as
+ * getStatisticsFromState1D does.
+ */
+void getDistancesFromSumProb1D(statistics_t *stat, double *StatProb,
+			       double *SumProb, options1D_t opts, 
+			       int iteration);
+
+
+/* These functions add the probabilities of the state matrix to SumProb,
+ * as getStatisticsFromState1D and getStatisticsFromState2D do when the
+ * mixing time is being calculated. They are used in the steps whose 
+ * statistics are not computed (see keyword STATEVERY), so that SumProb
+ * still receives every step. The 2D version also receives the number of
+ * steps after which the state was obtained, and visits only the region
+ * where the wave function may be non-zero (see getSupport2D).
+ */
+void addProbFromState1D(double *SumProb, double complex **matrix, 
+			options1D_t opts);
+void addProbFromState2D(double **SumProb, complex4D_t matrix, 
+			options2D_t opts, int steps);
+
+
+/* This function receives the first and second moments of the X and Y
+ * coordinates of a 2D walk, and the number of the iteration. It returns
+ * a structure statistics_t with the means and the variance, computed as
+ * in getStatisticsFromState2D. The fields tvd and tvdu are set to zero.
+ * It lets other functions which already visit every site of the state
+ * (see randMeasure2D) produce the statistics without another pass.
+ */
+statistics_t getStatisticsFromMoments2D(double fstMomentX, double secMomentX,
+					double fstMomentY, double secMomentY,
+					int iteration);
 
 
 /* This function receives a complex matrix representing a quantum state, a
  * real (double precision) matrix representing the approximate stationary
- * distribution, a structure options2D_t representing the simulation
- * options, and an integer describing the number of the iteration. 
+ * distribution, a real matrix SumProb (see getStatisticsFromState1D), a 
+ * structure options2D_t representing the simulation options, and an 
+ * integer describing the number of the iteration. 
  * We consider that the lattice ranges from 
  * -max to max. The function returns a structure statistics_t with the
  * statistics for that iteration (variance, mean, etc). If something goes 
@@ -65,8 +125,22 @@ statistics_t getStatisticsFromState1D(double complex **matrix, double *StatProb,
  *   -2: invalid matrix
  *   -3: invalid iteration number
  */
-statistics_t getStatisticsFromState2D(double complex ****matrix, double **StatProb,
-				      options2D_t opts, int iteration);
+statistics_t getStatisticsFromState2D(complex4D_t matrix, double **StatProb,
+				      double **SumProb, options2D_t opts, 
+				      int iteration);
+
+
+/* This function receives the address of a structure statistics_t, the
+ * approximate stationary distribution StatProb, the matrix SumProb with
+ * the probabilities of the state added up to the given iteration (see 
+ * getStatisticsFromState2D), the simulation options and the number of 
+ * the iteration. It stores in the fields tvd and tvdu the total 
+ * variation distances of the average distribution to the stationary and
+ * to the uniform distributions.
+ */
+void getDistancesFromSumProb2D(statistics_t *stat, double **StatProb,
+			       double **SumProb, options2D_t opts, 
+			       int iteration);
 
 
 /* This function receives a real (double precision) matrix containing the
@@ -21,24 +21,39 @@
 #define _QWSTATISTICS_IO
 
 #include "qwstatistics.h"
+#include "qwwriter.h"
 
 
 /* This function receives as input a string containing the name of the 
  * statistics file that will be written. It also receives a strucuture
- * containing the statistics concerning a certain step of the simulation.
- * In the first call of this function the file is created and the 
- * statistics are written. In subsequent calls of the function, the 
- * statistics are appended in the file. The filename must be the same in 
- * all the calls of the function or inexpected behaviour may occur. If 
- * the user wants to start writting statistics in a different file then 
- * this function must be called once with a blank string in the filename 
- * ("", open and close quotes without space).
+ * containing the statistics concerning a certain step of the simulation,
+ * and an integer create. The statistics of the first step written (with
+ * create different from zero) create the file, and the statistics of 
+ * the following steps are appended to it. So the steps must be written
+ * in order. A blank string in the filename ("", open and close quotes 
+ * without space) is ignored.
  *
  * Error numbers:
  *   0: success (no error)
  *   1: could not open file
  */
-int writeStatistics(const char *filename, statistics_t stat);
+int writeStatistics(const char *filename, statistics_t stat, int create);
+
+
+/* This function creates the statistics file filename, with its header,
+ * and returns an asynchronous writer (see qwwriter.h) to which the
+ * statistics of the following steps are sent, in order, by
+ * sendStatistics. The file is closed by closeWriter. Returns NULL if
+ * the file cannot be created.
+ */
+asyncwriter_t *openStatistics(const char *filename);
+
+
+/* This function sends the statistics of a step to a writer created by
+ * openStatistics, which writes them as writeStatistics does. It returns
+ * 1 if they cannot be written, and 0 otherwise.
+ */
+int sendStatistics(asyncwriter_t *writer, statistics_t stat);
 
 
 #endif
@@ -0,0 +1,96 @@
+/* QWalk (qwwriter.h)
+ * Copyright (C) 2008  Franklin Marquezino
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#ifndef _QWWRITER
+#define _QWWRITER
+
+#include<stdio.h>
+#include<stddef.h>
+
+/* An asynchronous writer owns an output file and a thread which writes
+ * in it the records sent by the simulation, so the simulation does not
+ * wait for the disk. The records are copied to a queue and written in
+ * the order they were sent, each one by the function sent with it,
+ * which receives the file, the copy of the record and its size in
+ * bytes, and returns 0 on success. The queue keeps at most the given
+ * capacity, in bytes: if it is full (the disk is slower than the
+ * simulation), sendRecord waits until some records are written. Where
+ * POSIX threads are not available, the records are written by
+ * sendRecord itself.
+ */
+typedef struct asyncwriter_s asyncwriter_t;
+
+typedef int (*recordwriter_t)(FILE *out, const void *record, size_t bytes);
+
+
+/* This function creates (or truncates) the file filename, in binary
+ * mode if binary is not zero and in text mode otherwise, and starts the
+ * thread that writes in it. Returns NULL if the file cannot be created
+ * or there is not enough memory.
+ */
+asyncwriter_t *openWriter(const char *filename, int binary, size_t capacity);
+
+
+/* This function works as openWriter, but it receives a file already
+ * opened (and positioned) by the caller, which is closed by closeWriter
+ * even if the writer cannot be started.
+ */
+asyncwriter_t *startWriter(FILE *out, size_t capacity);
+
+
+/* This function sends a record to the writer. The record is copied, so
+ * it may be changed as soon as the function returns. It returns 1 if
+ * the record cannot be queued or if some previous record could not be
+ * written, and 0 otherwise.
+ */
+int sendRecord(asyncwriter_t *writer, recordwriter_t write,
+	       const void *record, size_t bytes);
+
+
+/* Large records may be built directly in the queue, without the copy
+ * made by sendRecord: newRecord returns the memory of a new record of
+ * the given size (or NULL if there is not enough memory), and 
+ * queueRecord sends it to the writer, which frees it after writing it.
+ * queueRecord returns as sendRecord does.
+ */
+void *newRecord(size_t bytes);
+int queueRecord(asyncwriter_t *writer, recordwriter_t write, void *record);
+
+
+/* This function waits until all the records sent are written and
+ * flushes the file, so that they are kept if the program is killed
+ * afterwards. It returns as sendRecord does.
+ */
+int flushWriter(asyncwriter_t *writer);
+
+
+/* Record writer that writes the record as it is, for binary files */
+int writeRawRecord(FILE *out, const void *record, size_t bytes);
+
+
+/* This function waits until all the records are written, closes the
+ * file and frees the writer.
+ *
+ * Error numbers:
+ *   0: success (no error)
+ *   1: some record could not be written, or the file could not be closed
+ */
+int closeWriter(asyncwriter_t *writer);
+
+#endif
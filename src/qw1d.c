@@ -19,6 +19,7 @@
 
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
 #include<complex.h>
 #include<math.h>
 #include "qwmem_int.h"
@@ -41,13 +42,10 @@
 #include "qw1d_sub.h"
 
 int main(int argc, char **argv){
-  int experiment, MAX;
-  int **BrokenLinks, error;
-  double complex **A, **Atemp;
-  double complex **C;
-  double *AverageProb, *StatProb=NULL;
+  int error, arg = 1;
   options1D_t options;
-  filenames_t fnames;
+  qw1d_context ctx;
+  inputfile_t *input;
 
   printf("QWalk 1D, version 1.4 (qw1d).\n");
   printf("Copyright (C) 2008 Franklin Marquezino.\n");
@@ -57,16 +55,23 @@ int main(int argc, char **argv){
 
   printf("Email bug reports to <franklin@lncc.br>\n\n");
 
-  if(argc<2){
-    printf("Missing arguments.\nCorrect usage:\n  qw1d inputfile\n\n");
+  /* With --resume the simulation continues from its checkpoint file */
+  if(argc>1 && STREQ(argv[1],"--resume"))
+    arg = 2;
+
+  if(argc<arg+1){
+    printf("Missing arguments.\nCorrect usage:\n  qw1d [--resume] inputfile\n\n");
     exit(EXIT_FAILURE);
   }
 
   /**************************************************
    * Reading options and performing initializations *
    **************************************************/
-
-  options = readOptionsFile1D(argv[1]);
+  /* The input file is read only once: the coin and the state are read
+   * from the same input, kept in memory.
+   */
+  input = readInputFile(argv[arg]);
+  options = readOptions1D(input);
   switch(options.error){
   case 0:
     break;
@@ -112,144 +117,75 @@ int main(int argc, char **argv){
   case 14:
     printf("Error: invalid number of detectors.\n");
     exit(EXIT_FAILURE);
+  case 15:
+    printf("Error: invalid number of threads for experiments.\n");
+    exit(EXIT_FAILURE);
+  case 16:
+    printf("Error: invalid interval between statistics.\n");
+    exit(EXIT_FAILURE);
+  case 17:
+    printf("Error: invalid tolerance for the stationary distribution.\n");
+    exit(EXIT_FAILURE);
+  case 18:
+    printf("Error: invalid format of the wave-function file.\n");
+    exit(EXIT_FAILURE);
+  case 19:
+    printf("Error: invalid interval between checkpoints.\n");
+    exit(EXIT_FAILURE);
+  }
+  options.resume = (arg == 2);
+  if(options.resume && !options.checkEvery){
+    printf("Error: --resume requires the keyword CHECKPOINT in the input file.\n");
+    exit(EXIT_FAILURE);
   }
 
-  /* We define MAX as a short for options.max. It means that 
-   * the lattice ranges from -MAX to MAX.
-   */
-  MAX = options.max;
-
-  /* Here we set the seed for the pseudorandom number generator */
-  srand(options.seed);
-
-  /* Here we define the names of output files based on the 
-   * name of input file 
+  /* Here we create the context of the simulation: the names of the
+   * output files, the coin, the broken links, etc.
    */
-  fnames = createFilenames1D(argv[1], options);
-  printFilenames(stdout, argv[1], fnames);
-
-  /* Here we initialize all the links closed */
-  error = initBrokenLink1D(&BrokenLinks, MAX, options.lattType);
-  if(error){
+  error = initContext1D(&ctx, options, argv[arg], input);
+  switch(error){
+  case 0:
+    break;
+  case 1:
     printf("Error: could not initialize all links closed.\n");
     exit(EXIT_FAILURE);
-  }
-
-  setCoin1D(&C, options.coinType, argv[1]);
-  if(!C){
+  case 2:
     printf("Error: could not allocate matrix for coin");
     exit(EXIT_FAILURE);
-  }
-
-
-  /* If the user requested the calculation of mixing time, we need to
-   * calculate the approximate stationary distribution here.
-   */
-  if(options.calcMix){
-    printf("Calculating (approximate) stationary distribution with %d steps.\n",
-	   options.stepsMix);
-    if(options.blProb > 0.0 || options.dtProb > 0.0){
-      printf("Warning: this version of qwalk should not be used to calculate or to plot\n");
-      printf("  the approximate stationary distribution for decoherent one-dimensional\n");
-      printf("  quantum walks (it is the uniform distribution, always).\n");
-    }
-    printf("This calculation may take a really long time...\n");
-    setState1D(&A, options, argv[1]);
-    if(!A){
-      printf("Error: could not allocate initial state.\n");
-      exit(EXIT_FAILURE);
-    } 
-    StatProb = getStationary1D(A, C, BrokenLinks, options);
-    if(!StatProb){
-      printf("Error: could not obtain (approximate) stationary distribution.\n");
-      exit(EXIT_FAILURE);
-    }
-  }
-
-  Atemp = (options.lattType == LINE_LATT) ?
-    allocComplex2D(2, 2*MAX+1) : allocComplex2D(2, MAX);
-  if(!Atemp){
-    printf("Error: could not allocate memory for temporary matrix.\n");
+  case 4:
+    printf("Error: detector outside the lattice.\n");
+    exit(EXIT_FAILURE);
+  case 5:
+    printf("Error: invalid binary state file %s.\n", options.stateFile);
+    exit(EXIT_FAILURE);
+  default:
+    printf("Error: could not allocate memory for the simulation.\n");
     exit(EXIT_FAILURE);
   }
+  printFilenames(stdout, argv[arg], ctx.fnames);
 
   /***************************
    * Running the experiments *
    ***************************/
-  for(experiment=1; experiment <= options.numOfExperiments; experiment++){
-    int steps,t;
-
-    printf("Starting experiment %d of %d...\n", 
-	   experiment, options.numOfExperiments);
-
-    setState1D(&A, options, argv[1]);
-    if(!A){
-      printf("Error: could not allocate initial state.\n");
-      exit(EXIT_FAILURE);
-    }
-
-    /********************************
-     * Performing a full simulation *
-     ********************************/
-    steps = options.steps;
-    for(t=0; t<steps; t++){
-      initBrokenLink1D(&BrokenLinks, MAX, options.lattType);
-      randomBrokenLink1D(&BrokenLinks, options);
-
-      check1D(A, options, t); 
-      iterate1D(&A, &Atemp, C, BrokenLinks, options, t);
-
-      if(options.detectors){
-	/* If the user requested the simulation of a detector, we enter here
-	 */
-	int result;
-
-	result = measureState1D(&A, &Atemp, options);
-
-	if(result < 0){
-	  printf("Error: could not measure state.");
-	  exit(EXIT_FAILURE);
-	}
-	else if(result>0) /* non-trivial result */
-	  steps = t+options.stepsAfterMeasure; /* we run some additional steps */
-      }
-
-      if(options.dtProb>0)
-	randMeasure1D(&A, options);
-
-      doStatistics1D(A, StatProb, options, fnames, t+1, experiment);
-    }/* End-for t */
-
-    error=averageProbFromState1D(&AverageProb,A,options);
-    if(error){
-      printf("Error: could not update average probability matrix.\n");
-      exit(EXIT_FAILURE);
-    }
-
-  } /* End-for experiment */
-
-
-
-  /**********************
-   * Freeing memory (I) *
-   **********************/
-  freeComplex2D(Atemp, 2);
-  freeComplex2D(C, 2);
-  freeInt2D(BrokenLinks, 2);
+  simulate1D(&ctx);
 
   /******************* 
    * Writing results *
    *******************/
 
   printf("Writing probabilities file...\n");
-  error = writeData1D(fnames.dat_file, AverageProb, options);
+  error = writeData1D(ctx.fnames.dat_file, ctx.AverageProb, ctx.options);
   if(error){
     printf("Error: could not write output data file.\n");
     exit(EXIT_FAILURE);
   }
 
   printf("Writing wave-function file...\n");
-  error = writeState1D(fnames.datwav_file, A, options);
+  if(options.waveBinary)
+    error = writeStateBinary1D(ctx.fnames.datwav_file, ctx.A, ctx.options, 
+			       options.steps);
+  else
+    error = writeState1D(ctx.fnames.datwav_file, ctx.A, ctx.options);
   if(error){
     printf("Error: could not write wave-function file.\n");
     exit(EXIT_FAILURE);
@@ -257,7 +193,7 @@ int main(int argc, char **argv){
 
   if(options.calcMix){
     printf("Writing approximate stationary distribution...\n");
-    error = writeData1D(fnames.datpb_file, StatProb, options);
+    error = writeData1D(ctx.fnames.datpb_file, ctx.StatProb, ctx.options);
     if(error){
       printf("Error: could not write stationary data.\n");
       exit(EXIT_FAILURE);
@@ -265,18 +201,20 @@ int main(int argc, char **argv){
   }
 
   printf("Writing gnuplot script...\n");
-  error = writeScript1D(fnames, options);
+  error = writeScript1D(ctx.fnames, ctx.options);
   if(error)
     printf("Warning: could not write script file for gnuplot.\n");
 
 
-  /***********************
-   * Freeing memory (II) *
-   ***********************/
-  freeComplex2D(A, 2);
-  if(options.calcMix)
-    free(StatProb);
-  free(AverageProb);
+  /* The simulation is complete, so its checkpoint is no longer needed */
+  if(options.checkEvery)
+    remove(ctx.fnames.chk_file);
+
+  /******************
+   * Freeing memory *
+   ******************/
+  freeContext1D(&ctx);
+  freeInputFile(input);
 
   printf("\nSimulation finished.\n");
   printf("Please, report bug reports to franklin@lncc.br.\n\n");
@@ -19,10 +19,12 @@
 
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
 #include<complex.h>
 #include<math.h>
 #include "qwmem_real.h"
 #include "qwmem_complex.h"
+#include "qwmem_int.h"
 #include "qwcoin.h"
 #include "qwstate.h"
 #include "qwstatistics.h"
@@ -32,12 +34,15 @@
 #include "qwconsts.h"
 #include "qw1d_sub.h"
 #include "qwprob.h"
+#include "qwlinks.h"
+#include "qwmeasure.h"
+#include "qwrandom.h"
+#include "qwcheckpoint.h"
 
 
-void setCoin1D(double complex ***C, int coinType, const char *filename){
-  static char previousAlloc = 0;
+void setCoin1D(double complex ***C, int coinType, const inputfile_t *input){
 
-  if(previousAlloc)
+  if(*C)
     freeComplex2D(*C, 2);
 
   *C = NULL;
@@ -47,52 +52,52 @@ void setCoin1D(double complex ***C, int coinType, const char *filename){
     *C = createHadamardCoin1D();
     break;
   case CUSTOM_COIN:
-    *C = readCoinFile1D(filename);
+    *C = readCoin1D(input);
     break;
   }
 
-  if(*C)
-    previousAlloc = 1;
-  else
-    previousAlloc = 0;
-
   return;
 }
 
 
 
-void setState1D(double complex ***A, options1D_t options, 
-		const char *filename){
-  static char previousAlloc = 0;
-
-  if(previousAlloc)
-    freeComplex2D(*A, 2);
-
-  *A = NULL;
+double complex **newState1D(options1D_t options, const inputfile_t *input){
+  double complex **A = NULL;
 
   switch(options.stateType){
   case HADAMARD_STATE:
-    *A = createHadamardState1D(options.max, options.lattType);
+    A = createHadamardState1D(options.max, options.lattType);
     break;
   case CUSTOM_STATE:
-    *A = readStateFile1D(filename, options.max, options.lattType);
+    A = readState1D(input, options.max, options.lattType);
+    break;
+  case FILE_STATE:
+    A = readStateBinary1D(options.stateFile, options);
     break;
   }
 
+  return A;
+}
+
+
+
+void setState1D(double complex ***A, options1D_t options, 
+		const inputfile_t *input){
+
   if(*A)
-    previousAlloc = 1;
-  else
-    previousAlloc = 0;
+    freeComplex2D(*A, 2);
+
+  *A = newState1D(options, input);
 
   return;
 }
 
 
 
-void randomBrokenLink1D(int ***B, options1D_t options){
-  int m;
+void randomBrokenLink1D(blinks_t B, options1D_t options, rng_t *rng){
+  long long m, count;
 
-  if(!*B)
+  if(!B.bits)
     return;
 
   if(options.max<1)
@@ -101,31 +106,34 @@ void randomBrokenLink1D(int ***B, options1D_t options){
   if(options.blProb < 0.0)
     return;
 
+  /* The links are visited from one broken link to the next one (see 
+   * randomBrokenLink2D).
+   */
   switch(options.lattType){
   case LINE_LATT:
-    for(m=0; m<2*options.max; m++){
-      if(rand() < options.blProb*RAND_MAX){
-	(*B)[0][m]=0;
-	(*B)[1][m+1]=0;
-      }
+    count = 2*options.max;
+    for(m = getSkip(rng, options.blProb, count); m < count; 
+	m += 1 + getSkip(rng, options.blProb, count)){
+      BREAKLINK1D(B,0,m);
+      BREAKLINK1D(B,1,m+1);
     }
     break;
 
   case SEGMENT_LATT:
-    for(m=0; m<options.max-1; m++){
-      if(rand() < options.blProb*RAND_MAX){
-	(*B)[0][m]=0;
-	(*B)[1][m+1]=0;
-      }
+    count = options.max-1;
+    for(m = getSkip(rng, options.blProb, count); m < count; 
+	m += 1 + getSkip(rng, options.blProb, count)){
+      BREAKLINK1D(B,0,m);
+      BREAKLINK1D(B,1,m+1);
     }
     break;
 
   case CYCLE_LATT:
-    for(m=0; m<options.max; m++){
-      if(rand() < options.blProb*RAND_MAX){
-	(*B)[0][m]=0;
-	(*B)[1][(m+1)%(options.max)]=0;
-      }
+    count = options.max;
+    for(m = getSkip(rng, options.blProb, count); m < count; 
+	m += 1 + getSkip(rng, options.blProb, count)){
+      BREAKLINK1D(B,0,m);
+      BREAKLINK1D(B,1,(m+1)%(options.max));
     }
     break;
 
@@ -142,8 +150,9 @@ void randomBrokenLink1D(int ***B, options1D_t options){
 
 
 void iterate1D(double complex ***A, double complex ***Atemp, double complex **C, 
-	       int **BrokenLinks, options1D_t options, int iteration){
-  int m,j,error;
+	       blinks_t BrokenLinks, options1D_t options, int iteration){
+  int m,j,error,r,nranges;
+  int ranges[2][2];
   double complex **aux;
   
   /* We define constants MAX and LATTEXTRA as shorts for options.max and
@@ -163,14 +172,27 @@ void iterate1D(double complex ***A, double complex ***Atemp, double complex **C,
   const int rbound = (options.lattType == LINE_LATT) ? 
     MINIMUM(MAX+LATTEXTRA+iteration, 2*MAX-1) : MAX-1;
 
-  if(options.lattType == LINE_LATT)
-    error = cleanComplex2D(*Atemp, 2, 2*MAX+1);
-  else
-    error = cleanComplex2D(*Atemp, 2, MAX);
-  if(error){
-    printf("Error: could not clean temporary matrix in iteration %d.\n", 
-	   iteration);
-    exit(EXIT_FAILURE);
+  /* In the CYCLE and SEGMENT lattices we update only the sites that the
+   * walker may reach after this iteration (see getSupport1D). In the 
+   * CYCLE lattice they may wrap around, so we get at most two intervals.
+   */
+  const support1D_t supp = getSupport1D(options, iteration+1);
+
+  /* Each entry of Atemp in the interval (lbound,rbound), or in the 
+   * support, is written below. Outside of it Atemp is zero, since it 
+   * holds the state of the iteration before the previous one, whose 
+   * region was smaller. So we only clean Atemp in the first two 
+   * iterations, when we do not know where it came from.
+   */
+  nranges = getSupportRanges(supp.lo, supp.len, MAX, ranges);
+  if(iteration < 2){
+    error = (options.lattType == LINE_LATT) ? 
+      cleanComplex2D(*Atemp, 2, 2*MAX+1) : cleanComplex2D(*Atemp, 2, MAX);
+    if(error){
+      printf("Error: could not clean temporary matrix in iteration %d.\n", 
+	     iteration);
+      exit(EXIT_FAILURE);
+    }
   }
 
   switch(options.lattType){
@@ -182,41 +204,50 @@ void iterate1D(double complex ***A, double complex ***Atemp, double complex **C,
     for(m=lbound; m<=rbound; m++){
       for(j=0; j<2; j++){
 	int L, k;
+	double complex newValue = 0.0;
 
 	/* Further information on the matrix of broken links
 	 * can be found in Physical Review A, 74, 012312 (2006) 
 	 */      
-	L = BrokenLinks[j][m];
+	L = ISBROKEN1D(BrokenLinks,j,m) ? 0 : 1-2*j;
 	for(k=0; k<2; k++){
-	  (*Atemp)[1-j][m] += C[j+L][k]* (*A)[k][m+L];
+	  newValue += C[j+L][k]* (*A)[k][m+L];
 	}/* End-for k */
+	(*Atemp)[1-j][m] = newValue;
       }/* End-for j */
     }/* End-for m*/
     break;
   
   case CYCLE_LATT:
-    for(m=0; m<MAX; m++){
-      for(j=0; j<2; j++){
-	int L, k;
-
-	L = BrokenLinks[j][m];
-	for(k=0; k<2; k++){
-	  (*Atemp)[1-j][m] += C[j+L][k]* (*A)[k][(MAX+m+L)%MAX];
-	}/* End-for k */
-      }/* End-for j */
-    }/* End-for m*/
+    for(r=0; r<nranges; r++){
+      for(m=ranges[r][0]; m<ranges[r][1]; m++){
+	for(j=0; j<2; j++){
+	  int L, k;
+	  double complex newValue = 0.0;
+
+	  L = ISBROKEN1D(BrokenLinks,j,m) ? 0 : 1-2*j;
+	  for(k=0; k<2; k++){
+	    newValue += C[j+L][k]* (*A)[k][(MAX+m+L)%MAX];
+	  }/* End-for k */
+	  (*Atemp)[1-j][m] = newValue;
+	}/* End-for j */
+      }/* End-for m*/
+    }/* End-for r */
     break;
 
   case SEGMENT_LATT:
-    BrokenLinks[0][MAX-1] = 0;
-    BrokenLinks[1][0]     = 0;
-    for(m=0; m<MAX; m++){
+    BREAKLINK1D(BrokenLinks,0,MAX-1);
+    BREAKLINK1D(BrokenLinks,1,0);
+    for(m=ranges[0][0]; m<ranges[0][1]; m++){
       for(j=0; j<2; j++){
 	int L, k;
-	L = BrokenLinks[j][m];
+	double complex newValue = 0.0;
+
+	L = ISBROKEN1D(BrokenLinks,j,m) ? 0 : 1-2*j;
 	for(k=0; k<2; k++){
-	  (*Atemp)[1-j][m] += C[j+L][k]* (*A)[k][m+L];
+	  newValue += C[j+L][k]* (*A)[k][m+L];
 	}/* End-for k */
+	(*Atemp)[1-j][m] = newValue;
       }/* End-for j */
     }/* End-for m*/
     break;
@@ -237,11 +268,53 @@ void iterate1D(double complex ***A, double complex ***Atemp, double complex **C,
 
 
 
-void doStatistics1D(double complex **A, double *StatProb, options1D_t options, 
-		    filenames_t fnames, int iteration, int experiment){
-  int error;
+void doStatistics1D(qw1d_context *ctx, int iteration, int experiment){
   statistics_t stat;
-  static statistics_t *vStat = NULL;
+  const options1D_t options = ctx->options;
+
+  /* In the steps without statistics only the sums of the mixing time
+   * are updated.
+   */
+  if(!STATSTEP(iteration, options.statEvery, options.steps)){
+    if(options.calcMix)
+      addProbFromState1D(ctx->SumProb, ctx->A, options);
+    return;
+  }
+
+  /* Here we get the statistics for this step */
+  stat = getStatisticsFromState1D(ctx->A, ctx->StatProb, ctx->SumProb, 
+				  ctx->options, iteration);
+  if(stat.iteration<0){
+    printf("Error: could not generate statistics.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  saveStatistics1D(ctx, stat, iteration, experiment);
+
+  return;
+}
+
+
+
+/* Writes the averaged statistics of a step in the statistics file,
+ * through the writer of the context when simulate1D has opened it. 
+ */
+static int writeStep1D(qw1d_context *ctx, int iteration){
+
+  if(ctx->staWriter)
+    return sendStatistics(ctx->staWriter, ctx->vStat[iteration]);
+
+  return writeStatistics(ctx->fnames.sta_file, ctx->vStat[iteration], 
+			 iteration <= ctx->options.statEvery);
+}
+
+
+
+void saveStatistics1D(qw1d_context *ctx, statistics_t stat, 
+		      int iteration, int experiment){
+  int error;
+  statistics_t *vStat = ctx->vStat;
+  const options1D_t options = ctx->options;
 
   if(iteration<1 || iteration>options.steps){
     printf("Error: unexpected number of steps when calculating statistics.\n");
@@ -252,35 +325,10 @@ void doStatistics1D(double complex **A, double *StatProb, options1D_t options,
     exit(EXIT_FAILURE);
   }
 
-  if((experiment == 1) && (iteration == 1)){
-    /* The first call of this subroutine, i.e., first iteration of
-     * first experiment
-     */
-    register int t;
-
-    vStat = (statistics_t *)malloc((options.steps+1)*sizeof(statistics_t));
-    for(t=1; t<=options.steps; t++){
-      /* Initializing the array of structures */
-      vStat[t].iteration = t;
-      vStat[t].variance = 0.0;
-      vStat[t].meanX = 0.0;
-      vStat[t].meanY = 0.0;
-      vStat[t].tvd = 0.0;
-      vStat[t].tvdu = 0.0;
-    }
-  }
-
   if(!vStat){
     printf("Error: invalid statistics vector\n");
     exit(EXIT_FAILURE);
   }
-  
-  /* Here we get the statistics for this step */
-  stat = getStatisticsFromState1D(A, StatProb, options, iteration);
-  if(stat.iteration<0){
-    printf("Error: could not generate statistics.\n");
-    exit(EXIT_FAILURE);
-  }
 
   /* Here we accumulate the results of this iteration in 
    * the structure 
@@ -303,20 +351,12 @@ void doStatistics1D(double complex **A, double *StatProb, options1D_t options,
     vStat[iteration].tvdu /= options.numOfExperiments;
 
     /* Here we write the statistics in the appropriate file */
-    error = writeStatistics(fnames.sta_file, vStat[iteration]);
+    error = writeStep1D(ctx, iteration);
     if(error){
       printf("Error: could not write statistics.\n");
       exit(EXIT_FAILURE);
     }
   }
-
-  if((experiment == options.numOfExperiments) && (iteration == options.steps)){
-    /* The last call of this subroutine, i.e., last iteration 
-     * of last experiment 
-     */
-    free(vStat);
-    vStat = NULL;
-  }
   
   return;
 }
@@ -338,11 +378,78 @@ void check1D(double complex **A, options1D_t options, int iteration){
 }
 
 
+/* Checkpoint of the tolerance of the stationary distribution after step
+ * t, as in the two-dimensional walk (see mixCheckpoint2D).
+ */
+static int mixCheckpoint1D(double *sum, double *previous, int rbound, int t,
+			   int *check, int *lastCheck, float *error, float tol){
+  int m;
+
+  if(*lastCheck){
+    double dist = 0.0;
+
+    for(m=0; m<rbound; m++)
+      dist += fabs(sum[m]/t - previous[m]/(*lastCheck));
+    *error = dist;
+  }
+
+  for(m=0; m<rbound; m++)
+    previous[m] = sum[m];
+  *check = 2*t;
+
+  if(*lastCheck && *error < tol)
+    return 1;
+  *lastCheck = t;
+
+  return 0;
+}
+
+
+
+/* Evolves the state from step *t to step tEnd of the calculation of the
+ * stationary distribution, as stationarySteps2D.
+ */
+static int stationarySteps1D(double complex ***A, double complex ***Atemp,
+			     double complex **C, blinks_t BLinks, 
+			     options1D_t options, double *sum, 
+			     double *previous, int *t, int tEnd, int *check,
+			     int *lastCheck, float *error){
+  const int rbound = (options.lattType == LINE_LATT) ? 
+    2*options.max+1 : options.max;
+  int m;
+
+  while(*t < tEnd){
+    iterate1D(A, Atemp, C, BLinks, options, *t);
+    for(m=0; m<rbound; m++){
+      int j;
+      double prob = 0.0;
+
+      for(j=0; j<2; j++)
+	prob += (*A)[j][m]*conj((*A)[j][m]);
+
+      sum[m] += prob;
+    }
+    (*t)++;
+
+    if(previous && *t == *check &&
+       mixCheckpoint1D(sum, previous, rbound, *t, check, lastCheck,
+		       error, options.mixTol))
+      return 1;
+  }
+
+  return 0;
+}
+
+
+
 double *getStationary1D(double complex **A, double complex **C, 
-			int **BLinks, options1D_t options){
+			blinks_t BLinks, options1D_t options,
+			int *stepsMix, float *error){
   int m,t;
+  int check, lastCheck;
   double complex **Atemp;
-  double *stationary;
+  double complex **const Ainit = A;
+  double *stationary, *previous = NULL;
   const int MAX = options.max;
   const int rbound = (options.lattType == LINE_LATT) ? 2*MAX+1 : MAX;
 
@@ -357,32 +464,907 @@ double *getStationary1D(double complex **A, double complex **C,
   else
     cleanReal1D(stationary, MAX);
 
+  /* The checkpoints of the tolerance are the same of getStationary2D */
+  if(options.mixTol > 0.0){
+    previous = allocReal1D(rbound);
+    if(!previous)
+      return NULL;
+  }
+  check = rbound;
+  lastCheck = 0;
+  *error = -1.0;
+
   Atemp = (options.lattType == LINE_LATT) ?
     allocComplex2D(2, 2*MAX+1) : allocComplex2D(2, MAX);
 
   if(!Atemp)
     return NULL;
 
-  for(t=0; t<options.stepsMix; t++){
-    iterate1D(&A, &Atemp, C, BLinks, options, t);
-    for(m=0; m<rbound; m++){
-      int j;
-      double prob = 0.0;
+  t = 0;
+  stationarySteps1D(&A, &Atemp, C, BLinks, options, stationary, previous,
+		    &t, options.stepsMix, &check, &lastCheck, error);
+  *stepsMix = t;
 
-      for(j=0; j<2; j++)
-	prob += A[j][m]*conj(A[j][m]);
+  /* Since iterate1D exchanges the arrays at every step, we must free 
+   * the one that was not passed by the caller.
+   */
+  if(Atemp == Ainit)
+    freeComplex2D(A, 2);
+  else
+    freeComplex2D(Atemp, 2);
+  free(previous);
+
+  for(m=0; m<rbound; m++)
+    stationary[m] /= t;
+
+  if(!checkProb1D(stationary,MAX, options.lattType))
+    return NULL;
+
+  return stationary;
+}
+
+
+
+int initContext1D(qw1d_context *ctx, options1D_t options, 
+		  const char *filename, const inputfile_t *input){
+  int t;
+  const int MAX = options.max;
+  const int rbound = (options.lattType == LINE_LATT) ? 2*MAX+1 : MAX;
+
+  /* Every pointer is set first, so that freeContext1D may be called 
+   * even if the initialization fails.
+   */
+  ctx->options = options;
+  ctx->input = input;
+  ctx->C = NULL;
+  ctx->staWriter = NULL;
+  ctx->A = ctx->Atemp = NULL;
+  ctx->BLinks.bits = NULL;
+  ctx->AverageProb = ctx->StatProb = ctx->SumProb = NULL;
+  ctx->vStat = NULL;
+
+  /* Description of the simulation in the checkpoint files */
+  memset(&ctx->check, 0, sizeof(checkheader_t));
+  memcpy(ctx->check.magic, CHECK_MAGIC, sizeof(CHECK_MAGIC));
+  ctx->check.version = CHECK_VERSION;
+  ctx->check.dimension = 1;
+  ctx->check.seed = options.seed;
+  ctx->check.max = MAX;
+  ctx->check.lattType = options.lattType;
+  ctx->check.coinType = options.coinType;
+  ctx->check.stateType = options.stateType;
+  ctx->check.numOfExperiments = options.numOfExperiments;
+  ctx->check.optSteps = options.steps;
+  ctx->check.optStepsMix = options.stepsMix;
+  ctx->check.statEvery = options.statEvery;
+  ctx->check.calcMix = options.calcMix;
+  ctx->check.blProb[0] = options.blProb;
+  ctx->check.dtProb = options.dtProb;
+  ctx->check.mixTol = options.mixTol;
+
+  /* Here we define the names of output files based on the 
+   * name of input file 
+   */
+  ctx->fnames = createFilenames1D(filename, options);
+
+  /* Here we initialize all the links closed */
+  if(initBrokenLink1D(&ctx->BLinks, MAX, options.lattType))
+    return 1;
+
+  setCoin1D(&ctx->C, options.coinType, input);
+  if(!ctx->C)
+    return 2;
+
+  /* The binary state file is checked only once (see initContext2D) */
+  if(options.stateType == FILE_STATE && 
+     checkStateBinary1D(options.stateFile, options))
+    return 5;
+
+  /* The coordinates of the detectors are checked only once, here (see
+   * measureState1D).
+   */
+  for(t=1; t<=options.detectors; t++){
+    const int lbound = (options.lattType == LINE_LATT) ? -MAX : 0;
+    const int ubound = (options.lattType == LINE_LATT) ? MAX : MAX-1;
+
+    if(options.detector_pts[t] < lbound || options.detector_pts[t] > ubound)
+      return 4;
+  }
+
+  ctx->Atemp = allocComplex2D(2, rbound);
+  if(!ctx->Atemp)
+    return 3;
+
+  ctx->vStat = (statistics_t *)malloc((options.steps+1)*sizeof(statistics_t));
+  if(!ctx->vStat)
+    return 3;
+  for(t=1; t<=options.steps; t++){
+    /* Initializing the array of structures */
+    ctx->vStat[t].iteration = t;
+    ctx->vStat[t].variance = 0.0;
+    ctx->vStat[t].meanX = 0.0;
+    ctx->vStat[t].meanY = 0.0;
+    ctx->vStat[t].tvd = 0.0;
+    ctx->vStat[t].tvdu = 0.0;
+  }
+
+  if(options.calcMix){
+    ctx->SumProb = allocReal1D(rbound);
+    if(!ctx->SumProb)
+      return 3;
+  }
+
+  return 0;
+}
+
+
+
+void freeContext1D(qw1d_context *ctx){
+
+  if(ctx->A)
+    freeComplex2D(ctx->A, 2);
+  if(ctx->Atemp)
+    freeComplex2D(ctx->Atemp, 2);
+  if(ctx->C)
+    freeComplex2D(ctx->C, 2);
+  freeBrokenLink(&ctx->BLinks);
+  free(ctx->AverageProb);
+  free(ctx->StatProb);
+  free(ctx->SumProb);
+  free(ctx->vStat);
+
+  ctx->A = ctx->Atemp = ctx->C = NULL;
+  ctx->AverageProb = ctx->StatProb = ctx->SumProb = NULL;
+  ctx->vStat = NULL;
+
+  return;
+}
+
+
+
+/* Writes a checkpoint of the calculation of the stationary distribution
+ * after step t (see saveStationaryCheckpoint2D).
+ */
+static void saveStationaryCheckpoint1D(qw1d_context *ctx, double *sum,
+				       double *previous, int t, int check,
+				       int lastCheck, float error){
+  const int rbound = (ctx->options.lattType == LINE_LATT) ? 
+    2*ctx->options.max+1 : ctx->options.max;
+  checkheader_t header = ctx->check;
+  FILE *out;
+  int fail;
+
+  header.phase = CHECK_STATIONARY;
+  header.step = t;
+  header.mixCheck = check;
+  header.mixLastCheck = lastCheck;
+  header.mixError = error;
+
+  out = createCheckpoint(ctx->fnames.chk_file);
+  if(!out){
+    printf("Warning: could not write checkpoint file.\n");
+    return;
+  }
+
+  fail = writeBlock(out, &header, sizeof(checkheader_t)) ||
+    writeBlock(out, ctx->A[0], rbound*sizeof(double complex)) ||
+    writeBlock(out, ctx->A[1], rbound*sizeof(double complex)) ||
+    writeBlock(out, sum, rbound*sizeof(double)) ||
+    (previous && writeBlock(out, previous, rbound*sizeof(double)));
+
+  if(closeCheckpoint(out, ctx->fnames.chk_file, fail))
+    printf("Warning: could not write checkpoint file.\n");
+
+  return;
+}
+
+
+
+/* Writes a checkpoint of the experiments (see saveExperimentCheckpoint2D).
+ */
+static void saveExperimentCheckpoint1D(qw1d_context *ctx, int experiment,
+				       int step, int steps, const rng_t *rng){
+  const options1D_t options = ctx->options;
+  const int rbound = (options.lattType == LINE_LATT) ? 
+    2*options.max+1 : options.max;
+  checkheader_t header = ctx->check;
+  FILE *out;
+  int fail;
+
+  header.phase = CHECK_EXPERIMENTS;
+  header.experiment = experiment;
+  header.step = step;
+  header.steps = steps;
+  header.stepsMix = options.stepsMix;
+  header.mixError = options.mixError;
+  header.hasAverage = (ctx->AverageProb != NULL);
+
+  out = createCheckpoint(ctx->fnames.chk_file);
+  if(!out){
+    printf("Warning: could not write checkpoint file.\n");
+    return;
+  }
+
+  fail = writeBlock(out, &header, sizeof(checkheader_t)) ||
+    (options.calcMix && writeBlock(out, ctx->StatProb, rbound*sizeof(double))) ||
+    writeBlock(out, ctx->vStat+1, options.steps*sizeof(statistics_t)) ||
+    (header.hasAverage && writeBlock(out, ctx->AverageProb, rbound*sizeof(double)));
+
+  if(!fail && step > 0)
+    fail = writeBlock(out, rng, sizeof(rng_t)) ||
+      writeBlock(out, &options.support, sizeof(support1D_t)) ||
+      writeBlock(out, ctx->A[0], rbound*sizeof(double complex)) ||
+      writeBlock(out, ctx->A[1], rbound*sizeof(double complex)) ||
+      (options.calcMix && writeBlock(out, ctx->SumProb, rbound*sizeof(double)));
+
+  if(closeCheckpoint(out, ctx->fnames.chk_file, fail))
+    printf("Warning: could not write checkpoint file.\n");
 
-      stationary[m] += prob;
+  return;
+}
+
+
+
+/* Reads a checkpoint of the experiments into the context (see 
+ * readExperimentCheckpoint2D). Returns 1 if the checkpoint cannot be
+ * read, and 0 otherwise.
+ */
+static int readExperimentCheckpoint1D(qw1d_context *ctx, FILE *in, 
+				      const checkheader_t *header, rng_t *rng){
+  const options1D_t options = ctx->options;
+  const int rbound = (options.lattType == LINE_LATT) ? 
+    2*options.max+1 : options.max;
+  int k;
+
+  if(options.calcMix){
+    if(!ctx->StatProb)
+      ctx->StatProb = allocReal1D(rbound);
+    if(!ctx->StatProb || readBlock(in, ctx->StatProb, rbound*sizeof(double)))
+      return 1;
+    ctx->options.stepsMix = header->stepsMix;
+    ctx->options.mixError = header->mixError;
+  }
+
+  if(readBlock(in, ctx->vStat+1, options.steps*sizeof(statistics_t)))
+    return 1;
+
+  if(header->hasAverage){
+    ctx->AverageProb = allocReal1D(rbound);
+    if(!ctx->AverageProb || 
+       readBlock(in, ctx->AverageProb, rbound*sizeof(double)))
+      return 1;
+  }
+
+  if(header->step > 0){
+    if(!ctx->A)
+      ctx->A = allocComplex2D(2, rbound);
+    if(!ctx->A ||
+       readBlock(in, rng, sizeof(rng_t)) ||
+       readBlock(in, &ctx->options.support, sizeof(support1D_t)) ||
+       readBlock(in, ctx->A[0], rbound*sizeof(double complex)) ||
+       readBlock(in, ctx->A[1], rbound*sizeof(double complex)) ||
+       (options.calcMix && readBlock(in, ctx->SumProb, rbound*sizeof(double))))
+      return 1;
+  }
+
+  /* The statistics are written during the last experiment */
+  if(header->experiment == options.numOfExperiments)
+    for(k=1; k<=header->step; k++)
+      if(STATSTEP(k, options.statEvery, options.steps) &&
+	 writeStep1D(ctx, k))
+	return 1;
+
+  return 0;
+}
+
+
+
+/* Runs the experiments one after the other, using the arrays of the
+ * context. Each experiment has its own stream of random numbers, as in
+ * the parallel version, so both give the same results. The simulation 
+ * is resumed as in runSerialExperiments2D.
+ */
+static void runSerialExperiments1D(qw1d_context *ctx, 
+				   const checkheader_t *resume, 
+				   const rng_t *resumeRng){
+  int experiment, error, sinceCheck = 0;
+  const int MAX = ctx->options.max;
+  const int rbound = (ctx->options.lattType == LINE_LATT) ? 2*MAX+1 : MAX;
+  options1D_t options = ctx->options;
+
+  for(experiment = resume ? resume->experiment : 1; 
+      experiment <= options.numOfExperiments; experiment++){
+    int steps,t;
+    rng_t rng;
+
+    if(resume && experiment == resume->experiment && resume->step > 0){
+      /* The state was read from the checkpoint */
+      printf("Resuming experiment %d of %d at step %d...\n", 
+	     experiment, options.numOfExperiments, resume->step);
+      rng = *resumeRng;
+      options.support = ctx->options.support;
+      steps = resume->steps;
+      t = resume->step;
+    }
+    else{
+      printf("Starting experiment %d of %d...\n", 
+	     experiment, options.numOfExperiments);
+
+      initRandom(&rng, options.seed, experiment);
+      setState1D(&ctx->A, options, ctx->input);
+      if(!ctx->A){
+	printf("Error: could not allocate initial state.\n");
+	exit(EXIT_FAILURE);
+      }
+      options.support = getStateSupport1D(ctx->A, options);
+      ctx->options.support = options.support;
+
+      if(options.calcMix)
+	cleanReal1D(ctx->SumProb, rbound);
+
+      steps = options.steps;
+      t = 0;
+    }
+
+    /********************************
+     * Performing a full simulation *
+     ********************************/
+    for(; t<steps; t++){
+      closeBrokenLink(ctx->BLinks);
+      randomBrokenLink1D(ctx->BLinks, options, &rng);
+
+      check1D(ctx->A, options, t); 
+      iterate1D(&ctx->A, &ctx->Atemp, ctx->C, ctx->BLinks, options, t);
+
+      if(options.detectors){
+	/* If the user requested the simulation of a detector, we enter here
+	 */
+	int result;
+
+	result = measureState1D(&ctx->A, options, &rng);
+
+	if(result < 0){
+	  printf("Error: could not measure state.");
+	  exit(EXIT_FAILURE);
+	}
+	else if(result>0) /* non-trivial result */
+	  steps = t+options.stepsAfterMeasure; /* we run some additional steps */
+      }
+
+      if(options.dtProb>0)
+	randMeasure1D(&ctx->A, options, &rng);
+
+      doStatistics1D(ctx, t+1, experiment);
+
+      if(options.checkEvery && ++sinceCheck == options.checkEvery){
+	saveExperimentCheckpoint1D(ctx, experiment, t+1, steps, &rng);
+	sinceCheck = 0;
+      }
+    }/* End-for t */
+
+    error = averageProbFromState1D(&ctx->AverageProb, ctx->A, options);
+    if(error){
+      printf("Error: could not update average probability matrix.\n");
+      exit(EXIT_FAILURE);
+    }
+
+  } /* End-for experiment */
+
+  return;
+}
+
+
+
+/* Runs the experiments at the same time, in options.expThreads threads,
+ * beginning with the experiment first. See runParallelExperiments2D.
+ */
+static void runParallelExperiments1D(qw1d_context *ctx, int first){
+  int experiment, sinceCheck = 0;
+  const options1D_t options = ctx->options;
+  const int MAX = options.max;
+  const int rbound = (options.lattType == LINE_LATT) ? 2*MAX+1 : MAX;
+
+#pragma omp parallel num_threads(options.expThreads)
+  {
+    blinks_t BLinks = {NULL, 0, 0, 0};
+    double complex **Anew = NULL, **Atemp;
+    double *SumProb = NULL;
+    statistics_t *stats;
+    int error;
+
+    error = initBrokenLink1D(&BLinks, MAX, options.lattType);
+    if(error){
+      printf("Error: could not initialize all links closed.\n");
+      exit(EXIT_FAILURE);
+    }
+
+    Atemp = allocComplex2D(2, rbound);
+    if(!Atemp){
+      printf("Error: could not allocate memory for temporary matrix.\n");
+      exit(EXIT_FAILURE);
+    }
+
+    stats = (statistics_t *)malloc((options.steps+1)*sizeof(statistics_t));
+    if(options.calcMix)
+      SumProb = allocReal1D(rbound);
+    if(!stats || (options.calcMix && !SumProb)){
+      printf("Error: could not allocate memory for statistics.\n");
+      exit(EXIT_FAILURE);
     }
+
+#pragma omp for schedule(static,1) ordered
+    for(experiment=first; experiment <= options.numOfExperiments; experiment++){
+      options1D_t opts = options;
+      rng_t rng;
+      int steps, t, k;
+
+      printf("Starting experiment %d of %d...\n", 
+	     experiment, options.numOfExperiments);
+
+      initRandom(&rng, options.seed, experiment);
+
+      setState1D(&Anew, opts, ctx->input);
+      if(!Anew){
+	printf("Error: could not allocate initial state.\n");
+	exit(EXIT_FAILURE);
+      }
+      opts.support = getStateSupport1D(Anew, opts);
+
+      if(opts.calcMix)
+	cleanReal1D(SumProb, rbound);
+
+      steps = opts.steps;
+      for(t=0; t<steps; t++){
+	closeBrokenLink(BLinks);
+	randomBrokenLink1D(BLinks, opts, &rng);
+
+	check1D(Anew, opts, t); 
+	iterate1D(&Anew, &Atemp, ctx->C, BLinks, opts, t);
+
+	if(opts.detectors){
+	  int result;
+
+	  result = measureState1D(&Anew, opts, &rng);
+	  if(result < 0){
+	    printf("Error: could not measure state.");
+	    exit(EXIT_FAILURE);
+	  }
+	  else if(result>0) /* non-trivial result */
+	    steps = t+opts.stepsAfterMeasure; /* we run some additional steps */
+	}
+
+	if(opts.dtProb>0)
+	  randMeasure1D(&Anew, opts, &rng);
+
+	if(t+1 > opts.steps){
+	  printf("Error: unexpected number of steps when calculating statistics.\n");
+	  exit(EXIT_FAILURE);
+	}
+	/* See doStatistics1D */
+	if(!STATSTEP(t+1, opts.statEvery, opts.steps)){
+	  if(opts.calcMix)
+	    addProbFromState1D(SumProb, Anew, opts);
+	  continue;
+	}
+
+	stats[t+1] = getStatisticsFromState1D(Anew, ctx->StatProb, SumProb, 
+					      opts, t+1);
+	if(stats[t+1].iteration<0){
+	  printf("Error: could not generate statistics.\n");
+	  exit(EXIT_FAILURE);
+	}
+      }/* End-for t */
+
+#pragma omp ordered
+      {
+	for(k=1; k<=t; k++)
+	  if(STATSTEP(k, options.statEvery, options.steps))
+	    saveStatistics1D(ctx, stats[k], k, experiment);
+
+	error = averageProbFromState1D(&ctx->AverageProb, Anew, opts);
+	if(error){
+	  printf("Error: could not update average probability matrix.\n");
+	  exit(EXIT_FAILURE);
+	}
+
+	if(experiment == options.numOfExperiments){
+	  /* The state of the last experiment is kept in the context */
+	  double complex **aux = ctx->A;
+
+	  ctx->A = Anew;
+	  Anew = aux;
+	  ctx->options.support = opts.support;
+	}
+
+	sinceCheck += t;
+	if(options.checkEvery && sinceCheck >= options.checkEvery &&
+	   experiment < options.numOfExperiments){
+	  saveExperimentCheckpoint1D(ctx, experiment+1, 0, 0, NULL);
+	  sinceCheck = 0;
+	}
+      }
+
+    }/* End-for experiment */
+
+    if(Anew)
+      freeComplex2D(Anew, 2);
+    freeComplex2D(Atemp, 2);
+    freeBrokenLink(&BLinks);
+    free(stats);
+    free(SumProb);
+  }/* End of parallel region */
+
+  return;
+}
+
+
+
+/* Reports the number of steps used to obtain the stationary 
+ * distribution with a tolerance (see MIXTOL).
+ */
+static void reportStationary1D(options1D_t opts){
+
+  if(opts.mixError >= 0.0)
+    printf("Stationary distribution obtained with %d steps (L1 change %e).\n",
+	   opts.stepsMix, opts.mixError);
+  else
+    printf("Stationary distribution obtained with %d steps (no checkpoint reached).\n",
+	   opts.stepsMix);
+
+  return;
+}
+
+
+
+/* A coherent walk is the same in every experiment, and its evolution is
+ * the one used to obtain the stationary distribution (see mergedMix2D).
+ */
+static int mergedMix1D(options1D_t opts){
+  return opts.calcMix && opts.numOfExperiments == 1 && 
+    opts.blProb <= 0.0 && opts.dtProb <= 0.0 && !opts.detectors;
+}
+
+
+
+/* Runs the only experiment of a coherent walk and obtains the stationary
+ * distribution from the same evolution (see runMixedExperiment2D). The
+ * sums SumProb of the steps written are kept in the whole lattice. The
+ * function returns 0 on success, or 1 if there is not enough memory for
+ * the sums, in which case nothing was computed.
+ */
+static int runMixedExperiment1D(qw1d_context *ctx){
+  int t, k, check, lastCheck;
+  const options1D_t options = ctx->options;
+  const int steps = options.steps;
+  const int MAX = options.max;
+  const int rbound = (options.lattType == LINE_LATT) ? 2*MAX+1 : MAX;
+  options1D_t noMix;
+  statistics_t *stats;
+  size_t *offset, total;
+  double *sums, *previous = NULL;
+  double complex **Aend = NULL;
+
+  /* Where the sums of each step written are kept */
+  offset = (size_t *)malloc((steps+1)*sizeof(size_t));
+  if(!offset)
+    return 1;
+  total = 0;
+  for(k=1; k<=steps; k++){
+    offset[k] = total;
+    if(STATSTEP(k, options.statEvery, steps))
+      total += rbound;
+  }
+  if(total*sizeof(double) > MIXMERGE_MAXMEM){
+    free(offset);
+    return 1;
   }
 
-  freeComplex2D(Atemp, 2);
+  stats = (statistics_t *)malloc((steps+1)*sizeof(statistics_t));
+  sums = (double *)malloc(total*sizeof(double));
+  if(options.mixTol > 0.0)
+    previous = allocReal1D(rbound);
+  if(options.stepsMix > steps)
+    Aend = allocComplex2D(2, rbound);
+  if(!stats || !sums || (options.mixTol > 0.0 && !previous) ||
+     (options.stepsMix > steps && !Aend)){
+    free(offset);
+    free(stats);
+    free(sums);
+    free(previous);
+    if(Aend)
+      freeComplex2D(Aend, 2);
+    return 1;
+  }
+
+  printf("Starting experiment 1 of 1, together with the stationary distribution...\n");
+
+  setState1D(&ctx->A, options, ctx->input);
+  if(!ctx->A){
+    printf("Error: could not allocate initial state.\n");
+    exit(EXIT_FAILURE);
+  }
+  ctx->options.support = getStateSupport1D(ctx->A, options);
+  noMix = ctx->options;
+  noMix.calcMix = 0;
+
+  cleanReal1D(ctx->SumProb, rbound);
+  check = rbound;
+  lastCheck = 0;
+  ctx->options.mixError = -1.0;
+
+  for(t=0; t<steps || !ctx->StatProb; t++){
+
+    if(t < steps)
+      check1D(ctx->A, noMix, t);
+    iterate1D(&ctx->A, &ctx->Atemp, ctx->C, ctx->BLinks, noMix, t);
+    addProbFromState1D(ctx->SumProb, ctx->A, noMix);
+
+    if(t < steps){
+      if(STATSTEP(t+1, options.statEvery, steps)){
+	stats[t+1] = getStatisticsFromState1D(ctx->A, NULL, NULL, noMix, t+1);
+	if(stats[t+1].iteration<0){
+	  printf("Error: could not generate statistics.\n");
+	  exit(EXIT_FAILURE);
+	}
+	memcpy(sums + offset[t+1], ctx->SumProb, rbound*sizeof(double));
+      }
+
+      if(t+1 == steps){
+	if(averageProbFromState1D(&ctx->AverageProb, ctx->A, noMix)){
+	  printf("Error: could not update average probability matrix.\n");
+	  exit(EXIT_FAILURE);
+	}
+	if(Aend)
+	  copyComplex2D(Aend, ctx->A, 2, rbound);
+      }
+    }
+
+    /* The stationary distribution, as in getStationary1D */
+    if(!ctx->StatProb &&
+       ((previous && t+1 == check && 
+	 mixCheckpoint1D(ctx->SumProb, previous, rbound, t+1, &check, 
+			 &lastCheck, &ctx->options.mixError, options.mixTol)) ||
+	t+1 == options.stepsMix)){
+      int m;
+
+      ctx->StatProb = allocReal1D(rbound);
+      if(!ctx->StatProb){
+	printf("Error: could not obtain (approximate) stationary distribution.\n");
+	exit(EXIT_FAILURE);
+      }
+      for(m=0; m<rbound; m++)
+	ctx->StatProb[m] = ctx->SumProb[m]/(t+1);
+      if(!checkProb1D(ctx->StatProb, MAX, options.lattType)){
+	printf("Error: could not obtain (approximate) stationary distribution.\n");
+	exit(EXIT_FAILURE);
+      }
+      ctx->options.stepsMix = t+1;
+    }
+
+  }/* End-for t */
+
+  /* The final state of the experiment */
+  if(Aend){
+    double complex **aux = ctx->A;
+
+    ctx->A = Aend;
+    Aend = aux;
+  }
+
+  /* Now the distances to the stationary distribution */
+  for(k=1; k<=steps; k++){
+    if(!STATSTEP(k, options.statEvery, steps))
+      continue;
+
+    getDistancesFromSumProb1D(&stats[k], ctx->StatProb, sums + offset[k], 
+			      noMix, k);
+    saveStatistics1D(ctx, stats[k], k, 1);
+  }
+
+  free(offset);
+  free(stats);
+  free(sums);
+  free(previous);
+  if(Aend)
+    freeComplex2D(Aend, 2);
+
+  return 0;
+}
+
+
+
+/* Calculates the stationary distribution with checkpoints, as 
+ * checkedStationary2D.
+ */
+static double *checkedStationary1D(qw1d_context *ctx, FILE *in, 
+				   const checkheader_t *header){
+  const options1D_t options = ctx->options;
+  const int rbound = (options.lattType == LINE_LATT) ? 
+    2*options.max+1 : options.max;
+  double *sum, *previous = NULL;
+  int m, t, check, lastCheck, done;
+  float error;
+
+  sum = allocReal1D(rbound);
+  if(!sum)
+    return NULL;
+  if(options.mixTol > 0.0){
+    previous = allocReal1D(rbound);
+    if(!previous)
+      return NULL;
+  }
+
+  if(in){
+    t = header->step;
+    check = header->mixCheck;
+    lastCheck = header->mixLastCheck;
+    error = header->mixError;
+    if(readBlock(in, ctx->A[0], rbound*sizeof(double complex)) ||
+       readBlock(in, ctx->A[1], rbound*sizeof(double complex)) ||
+       readBlock(in, sum, rbound*sizeof(double)) ||
+       (previous && readBlock(in, previous, rbound*sizeof(double)))){
+      printf("Error: could not read checkpoint file.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  else{
+    cleanReal1D(sum, rbound);
+    t = 0;
+    check = rbound;
+    lastCheck = 0;
+    error = -1.0;
+  }
+
+  done = 0;
+  while(!done && t < options.stepsMix){
+    done = stationarySteps1D(&ctx->A, &ctx->Atemp, ctx->C, ctx->BLinks, 
+			     options, sum, previous, &t, 
+			     MINIMUM(t+options.checkEvery, options.stepsMix),
+			     &check, &lastCheck, &error);
+    if(!done && t < options.stepsMix)
+      saveStationaryCheckpoint1D(ctx, sum, previous, t, check, lastCheck, 
+				 error);
+  }
+  ctx->options.stepsMix = t;
+  ctx->options.mixError = error;
+
+  free(previous);
 
   for(m=0; m<rbound; m++)
-    stationary[m] /= options.stepsMix;
+    sum[m] /= t;
 
-  if(!checkProb1D(stationary,MAX, options.lattType))
+  if(!checkProb1D(sum, options.max, options.lattType))
     return NULL;
 
-  return stationary;
+  return sum;
+}
+
+
+
+/* Runs the simulation of simulate1D: the stationary distribution, if
+ * it was requested, and the experiments.
+ */
+static void runSimulation1D(qw1d_context *ctx){
+  const options1D_t options = ctx->options;
+  checkheader_t header;
+  FILE *in = NULL;
+  rng_t rng;
+  int resumed = 0;
+
+  /* See simulate2D */
+  if(options.resume){
+    in = openCheckpoint(ctx->fnames.chk_file, &header, 1);
+    if(!in || !sameSimulation(&header, &ctx->check)){
+      printf("Error: could not resume simulation from checkpoint file %s.\n",
+	     ctx->fnames.chk_file);
+      exit(EXIT_FAILURE);
+    }
+    printf("Resuming simulation from checkpoint file %s.\n", 
+	   ctx->fnames.chk_file);
+    ctx->options.seed = ctx->check.seed = header.seed;
+    resumed = 1;
+  }
+
+  /* If the user requested the calculation of mixing time, we need to
+   * calculate the approximate stationary distribution here.
+   */
+  if(options.calcMix && !(resumed && header.phase == CHECK_EXPERIMENTS)){
+    if(options.mixTol > 0.0)
+      printf("Calculating (approximate) stationary distribution with at most %d steps.\n",
+	     options.stepsMix);
+    else
+      printf("Calculating (approximate) stationary distribution with %d steps.\n",
+	     options.stepsMix);
+    if(options.blProb > 0.0 || options.dtProb > 0.0){
+      printf("Warning: this version of qwalk should not be used to calculate or to plot\n");
+      printf("  the approximate stationary distribution for decoherent one-dimensional\n");
+      printf("  quantum walks (it is the uniform distribution, always).\n");
+    }
+    printf("This calculation may take a really long time...\n");
+    if(!options.checkEvery && mergedMix1D(options) && 
+       !runMixedExperiment1D(ctx)){
+      if(options.mixTol > 0.0)
+	reportStationary1D(ctx->options);
+      return;
+    }
+    setState1D(&ctx->A, options, ctx->input);
+    if(!ctx->A){
+      printf("Error: could not allocate initial state.\n");
+      exit(EXIT_FAILURE);
+    } 
+    ctx->options.support = getStateSupport1D(ctx->A, options);
+    if(options.checkEvery){
+      ctx->StatProb = checkedStationary1D(ctx, in, &header);
+      if(in){
+	fclose(in);
+	in = NULL;
+      }
+    }
+    else
+      ctx->StatProb = getStationary1D(ctx->A, ctx->C, ctx->BLinks, ctx->options,
+				      &ctx->options.stepsMix, &ctx->options.mixError);
+    if(!ctx->StatProb){
+      printf("Error: could not obtain (approximate) stationary distribution.\n");
+      exit(EXIT_FAILURE);
+    }
+    if(options.mixTol > 0.0)
+      reportStationary1D(ctx->options);
+    if(options.checkEvery)
+      saveExperimentCheckpoint1D(ctx, 1, 0, 0, NULL);
+  }
+
+  if(in){
+    if(readExperimentCheckpoint1D(ctx, in, &header, &rng)){
+      printf("Error: could not read checkpoint file.\n");
+      exit(EXIT_FAILURE);
+    }
+    fclose(in);
+    if(options.calcMix && options.mixTol > 0.0)
+      reportStationary1D(ctx->options);
+  }
+  else{
+    resumed = 0;
+    header.experiment = 1;
+    header.step = 0;
+  }
+
+  /***************************
+   * Running the experiments *
+   ***************************/
+  if(options.expThreads && header.step == 0)
+    runParallelExperiments1D(ctx, header.experiment);
+  else
+    runSerialExperiments1D(ctx, resumed ? &header : NULL, &rng);
+
+  return;
+}
+
+
+
+void simulate1D(qw1d_context *ctx){
+  int error;
+
+  /* The statistics are written by a separate thread, so that the 
+   * experiments do not wait for the disk (see qwwriter.h).
+   */
+  if(!STREQ(ctx->fnames.sta_file, "")){
+    ctx->staWriter = openStatistics(ctx->fnames.sta_file);
+    if(!ctx->staWriter){
+      printf("Error: could not write statistics.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  runSimulation1D(ctx);
+
+  if(ctx->staWriter){
+    error = closeWriter(ctx->staWriter);
+    ctx->staWriter = NULL;
+    if(error){
+      printf("Error: could not write statistics.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  return;
 }
@@ -19,6 +19,7 @@
 
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
 #include<complex.h>
 #include<math.h>
 #include "qwmem_int.h"
@@ -41,13 +42,10 @@
 #include "qw2d_sub.h"
 
 int main(int argc, char **argv){
-  int MAX, error, experiment;
-  int ****BrokenLinks1, ****BrokenLinks2;
-  double complex ****A, ****Atemp, ****C;
-  double **AverageProb = NULL, **StatProb = NULL;
+  int error, arg = 1;
   options2D_t options;
-  filenames_t fnames;
-  screen_t screen;
+  qw2d_context ctx;
+  inputfile_t *input;
 
   printf("QWalk 2D, version 1.4 (qw2d).\n");
   printf("Copyright (C) 2008 Franklin Marquezino.\n");
@@ -57,16 +55,24 @@ int main(int argc, char **argv){
 
   printf("Email bug reports to <franklin@lncc.br>\n\n");
 
-  if(argc<2){
-    printf("Missing arguments.\nCorrect usage:\n  qw2d inputfile\n\n");
+  /* With --resume the simulation continues from its checkpoint file */
+  if(argc>1 && STREQ(argv[1],"--resume"))
+    arg = 2;
+
+  if(argc<arg+1){
+    printf("Missing arguments.\nCorrect usage:\n  qw2d [--resume] inputfile\n\n");
     exit(EXIT_FAILURE);
   }
 
   /**************************************************
    * Reading options and performing initializations *
    **************************************************/
-  /* First we read the options file (usually with extension .in) */
-  options = readOptionsFile2D(argv[1]);
+  /* First we read the options file (usually with extension .in). It is
+   * read only once: the coin, the state and the broken links are read
+   * from the same input, kept in memory.
+   */
+  input = readInputFile(argv[arg]);
+  options = readOptions2D(input);
   switch(options.error){
   case 0:
     break;
@@ -109,222 +115,91 @@ int main(int argc, char **argv){
   case 13:
     printf("Error: invalid lattice type\n");
     exit(EXIT_FAILURE);
-  }
-
-  /* Here we define MAX as a short for options.max. It means 
-   * that the lattice ranges from -MAX to MAX in X axys, and
-   * from -MAX to MAX in Y axys.
-   */
-  MAX = options.max;
-
-  /* Here we set the seed for the pseudorandom number generator */
-  srand(options.seed);
-
-  /* Here we define the names of output files based on the 
-   * name of input file 
-   */
-  fnames = createFilenames2D(argv[1],options);
-  printFilenames(stdout, argv[1],fnames);
-
-  /* First we initialize all the links closed */
-  error = initBrokenLink2D(&BrokenLinks1, &BrokenLinks2, MAX, options.lattType);
-  if(error){
-    printf("Error: could not initialize all links closed.\n");
+  case 14:
+    printf("Error: invalid memory layout\n");
+    exit(EXIT_FAILURE);
+  case 15:
+    printf("Error: invalid number of threads\n");
+    exit(EXIT_FAILURE);
+  case 16:
+    printf("Error: invalid number of threads for experiments\n");
+    exit(EXIT_FAILURE);
+  case 17:
+    printf("Error: invalid interval between statistics\n");
+    exit(EXIT_FAILURE);
+  case 18:
+    printf("Error: invalid tolerance for the stationary distribution\n");
+    exit(EXIT_FAILURE);
+  case 19:
+    printf("Error: invalid format of the wave-function file\n");
+    exit(EXIT_FAILURE);
+  case 20:
+    printf("Error: invalid interval between checkpoints\n");
+    exit(EXIT_FAILURE);
+  case 21:
+    printf("Error: invalid snapshot option\n");
     exit(EXIT_FAILURE);
   }
-
-  /* In case of broken links, we read the broken link file in 
-   * order to open the appropriate links. Note that the broken 
-   * link information can be written in the same file used for 
-   * the general options (usually a file with extension .in)     
-   */
-  if(options.blType == PERMANENT_BROKENLINKS){
-    error = readBrokenLinkFile2D(argv[1], MAX, &BrokenLinks1, &BrokenLinks2,
-				 options.lattType);
-    if(error){
-      printf("Error: could not read broken links from file.\n");
-      exit(EXIT_FAILURE);
-    }
+  options.resume = (arg == 2);
+  if(options.resume && !options.checkEvery){
+    printf("Error: --resume requires the keyword CHECKPOINT in the input file\n");
+    exit(EXIT_FAILURE);
   }
 
-  /* If an observation screen was required in the input file then this
-   * screen is initialized here. The screen is represented by a straight
-   * line from (a0,a1) to (b0,b1) 
+  /* Here we create the context of the simulation: the names of the
+   * output files, the coin, the broken links, the screen, etc.
    */
-  if(options.screen){
-    error = initScreen(&screen, options.screen_pta[0], options.screen_pta[1], 
-		       options.screen_ptb[0], options.screen_ptb[1]);
-    if(error){
-      printf("Error: could not initialize screen detector.\n");
-      exit(EXIT_FAILURE);
-    }
-  }
-
-  setCoin2D(&C, options.coinType, argv[1]);
-  if(!C){
+  error = initContext2D(&ctx, options, argv[arg], input);
+  switch(error){
+  case 0:
+    break;
+  case 1:
+    printf("Error: could not initialize all links closed.\n");
+    exit(EXIT_FAILURE);
+  case 2:
+    printf("Error: could not read broken links from file.\n");
+    exit(EXIT_FAILURE);
+  case 3:
     printf("Error: could not allocate matrix for coin");
     exit(EXIT_FAILURE);
-  }
-
-
-  /* If the user requested the calculation of mixing time, we need to
-   * calculate the approximate stationary distribution here.
-   */
-  if(options.calcMix){
-    printf("Calculating (approximate) stationary distribution with %d steps.\n",
-	   options.stepsMix);
-    if((options.blProbA > 0.0) || (options.blProbB > 0.0) || (options.dtProb > 0.0)){
-      printf("Warning: this version of qwalk should not be used to calculate or to plot\n");
-      printf("  the approximate stationary distribution for decoherent two-dimensional\n");
-      printf("  quantum walks (it is the uniform distribution, always).\n");
-    }
-    printf("This calculation may take a really long time...\n");
-    setState2D(&A, options, argv[1]);
-    if(!A){
-      printf("Error: could not allocate initial state.\n");
-      exit(EXIT_FAILURE);
-    } 
-    StatProb = getStationary2D(A, C, BrokenLinks1, BrokenLinks2, options);
-    if(!StatProb){
-      printf("Error: could not obtain (approximate) stationary distribution.\n");
-      exit(EXIT_FAILURE);
-    }
-  }
-
-  Atemp = (options.lattType == CYCLE_LATT) ?
-    allocComplex4D(2, 2, MAX, MAX) : allocComplex4D(2, 2, 2*MAX+1, 2*MAX+1);
-  if(!Atemp){
-    printf("Error: could not allocate memory for temporary matrix.\n");
+  case 4:
+    printf("Error: could not initialize screen detector.\n");
+    exit(EXIT_FAILURE);
+  case 6:
+    printf("Error: detector outside the lattice.\n");
+    exit(EXIT_FAILURE);
+  case 7:
+    printf("Error: invalid binary state file %s.\n", options.stateFile);
+    exit(EXIT_FAILURE);
+  case 8:
+    printf("Error: could not allocate initial state.\n");
+    exit(EXIT_FAILURE);
+  default:
+    printf("Error: could not allocate memory for the simulation.\n");
     exit(EXIT_FAILURE);
   }
+  printFilenames(stdout, argv[arg], ctx.fnames);
 
   /*********************************************
    * Running the experiments                   *
    *********************************************/
-  for(experiment=1; experiment <= options.numOfExperiments; experiment++){
-    int steps, t;
-
-    printf("Starting experiment %d of %d...\n", 
-	   experiment, options.numOfExperiments);
-
-    setState2D(&A, options, argv[1]);
-    if(!A){
-      printf("Error: could not allocate initial state.\n");
-      exit(EXIT_FAILURE);
-    } 
-
-    /********************************
-     * Performing a full simulation *
-     ********************************/
-    steps = options.steps;
-    for(t=0; t<steps; t++){
-      
-      if((options.blProbA > 0.0) || (options.blProbB > 0.0)){
-	/* If the user requested simulation of random broken links we enter here at 
-	 * every step. We start by initializing all broken links closed.
-	 */
-	error = initBrokenLink2D(&BrokenLinks1, &BrokenLinks2, MAX, options.lattType);
-	if(error){
-	  printf("Error: could not initialize all links closed.\n");
-	  exit(EXIT_FAILURE);
-	}
-	/* If besides random broken links we have also permanent broken links, then
-	 * we need to read those permanent broken links from a file before breaking 
-	 * the random ones.
-	 */
-	if(options.blType == PERMANENT_BROKENLINKS){
-	  error = readBrokenLinkFile2D(argv[1], MAX, &BrokenLinks1, &BrokenLinks2,
-				       options.lattType);
-	  if(error){
-	    printf("Error: could not read broken links from file.\n");
-	    exit(EXIT_FAILURE);
-	  }
-	}
-	/* Finally, we may break the random broken links.
-	 */
-	randomBrokenLink2D(&BrokenLinks1, &BrokenLinks2, options);
-		
-      }
-
-      check2D(A, options, t);
-      iterate2D(&A, &Atemp, C, BrokenLinks1, BrokenLinks2, options, t);
-
-      if(options.detectors){
-	/* If the user requested the simulation of a detector, we enter here
-	 */
-	int result;
-
-	result = measureState2D(&A, &Atemp, options);
-	if(result < 0){
-	  printf("Error: could not measure state.");
-	  exit(EXIT_FAILURE);
-	}
-	else if(result>0) /* non-trivial result */
-	  steps = t+options.stepsAfterMeasure; /* we run some additional steps */
-      }
-
-      if(options.dtProb>0)
-	randMeasure2D(&A, options);
-
-      /* Now we calculate expectation, variance, standard deviation, etc, 
-       * and save in a file.
-       */
-      doStatistics2D(A, StatProb, options, fnames, t+1, experiment);
-
-      if(options.screen){
-	/* If the user requested an observation screen, then we do it here */
-	error = updateScreen(&screen, A, MAX);
-	if(error){
-	  printf("Error: could not update screen.\n");
-	  exit(EXIT_FAILURE);
-	}
-      }
-
-    }/* End-for t */
-
-    /* Here we take the probability distribution obtained after of one experiment
-     * and accumulate it to obtain, at the end, an average probability distribution
-     * (which should not be confused with the average distribution used to define
-     * the stationary distribution of a quantum Markov chain)
-     */
-    error = averageProbFromState2D(&AverageProb, A, options);
-    if(error){
-      printf("Error: could not update average probability matrix.\n");
-      exit(EXIT_FAILURE);
-    }
-
-  }/* End-for experiments */
-
-
-  /**********************
-   * Freeing memory (I) *
-   **********************/
-  if(options.lattType == CYCLE_LATT){
-    freeComplex4D(Atemp, 2, 2, MAX);
-    freeInt4D(BrokenLinks1, 2, 2, MAX);
-  }
-  else{
-    freeComplex4D(Atemp, 2, 2, 2*MAX+1);
-    freeInt4D(BrokenLinks1, 2, 2, 2*MAX+1);
-  }
-  if(options.lattType == DIAG_LATT) 
-    freeInt4D(BrokenLinks2, 2, 2, 2*MAX+1);
-  else  
-    freeInt4D(BrokenLinks2, 1, 1, 1);
-  freeComplex4D(C, 2, 2, 2);
+  simulate2D(&ctx);
 
   /******************* 
    * Writing results *
    *******************/
   printf("Writing probabilities file...\n");
-  error = writeData2D(fnames.dat_file, AverageProb, options);
+  error = writeData2D(ctx.fnames.dat_file, ctx.AverageProb, ctx.options);
   if(error){
     printf("Error: could not write output data file.\n");
     exit(EXIT_FAILURE);
   }
 
   printf("Writing wave-function file...\n");
-  error = writeState2D(fnames.datwav_file, A, options);
+  if(options.waveBinary)
+    error = writeStateBinary2D(ctx.fnames.datwav_file, ctx.A, ctx.options, ctx.steps);
+  else
+    error = writeState2D(ctx.fnames.datwav_file, ctx.A, ctx.options, ctx.steps);
   if(error){
     printf("Error: could not write wave-function file.\n");
     exit(EXIT_FAILURE);
@@ -333,7 +208,7 @@ int main(int argc, char **argv){
 
   if(options.calcMix){
     printf("Writing approximate stationary distribution...\n");
-    error = writeData2D(fnames.datpb_file, StatProb, options);
+    error = writeData2D(ctx.fnames.datpb_file, ctx.StatProb, ctx.options);
     if(error){
       printf("Error: could not write stationary data.\n");
       exit(EXIT_FAILURE);
@@ -343,7 +218,7 @@ int main(int argc, char **argv){
 
   if(options.screen){
     printf("Writing observation screen file...\n");
-    error = writeScreen(fnames.datscr_file, screen);
+    error = writeScreen(ctx.fnames.datscr_file, ctx.screen);
     if(error){
       printf("Error: could not write screen detector file.\n");
       exit(EXIT_FAILURE);
@@ -351,27 +226,19 @@ int main(int argc, char **argv){
   }
 
   printf("Writing gnuplot script...\n");
-  error = writeScript2D(fnames, options);
+  error = writeScript2D(ctx.fnames, ctx.options);
   if(error)
     printf("Warning: could not write script file for gnuplot.\n");
 
-  /***********************
-   * Freeing memory (II) *
-   ***********************/
-  if(options.lattType == CYCLE_LATT){
-    freeComplex4D(A, 2, 2, MAX);
-    if(options.calcMix)
-      freeReal2D(StatProb, MAX);
-    freeReal2D(AverageProb, MAX);
-  }
-  else{
-    freeComplex4D(A, 2, 2, 2*MAX+1);
-    if(options.calcMix)
-      freeReal2D(StatProb, 2*MAX+1);
-    freeReal2D(AverageProb, 2*MAX+1);
-  }
-  if(options.screen)
-    free(screen.values);
+  /* The simulation is complete, so its checkpoint is no longer needed */
+  if(options.checkEvery)
+    remove(ctx.fnames.chk_file);
+
+  /******************
+   * Freeing memory *
+   ******************/
+  freeContext2D(&ctx);
+  freeInputFile(input);
 
   exit(EXIT_SUCCESS);
 }
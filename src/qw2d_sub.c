@@ -19,6 +19,7 @@
 
 #include<stdio.h>
 #include<stdlib.h>
+#include<string.h>
 #include<complex.h>
 #include<math.h>
 #include "qwmem_complex.h"
@@ -32,19 +33,24 @@
 #include "qwstatistics_io.h"
 #include "qwconsts.h"
 #include "qwmeasure.h"
+#include "qwkernel.h"
+#include "qwlinks.h"
+#include "qwscreen.h"
+#include "qwrandom.h"
+#include "qwcheckpoint.h"
+#include "qwsnapshot.h"
 #include "qw2d_sub.h"
 
-void setCoin2D(double complex *****C,int coinType,const char *filename){
-  static char previousAlloc = 0;
+void setCoin2D(double complex *****C,int coinType,const inputfile_t *input){
 
-  if(previousAlloc)
+  if(*C)
     freeComplex4D(*C, 2, 2, 2);
 
   *C = NULL;
 
   switch(coinType){
   case CUSTOM_COIN:
-    *C = readCoinFile2D(filename);
+    *C = readCoin2D(input);
     break;
   case FOURIER_COIN:
     *C = createFourierCoin2D();
@@ -57,46 +63,43 @@ void setCoin2D(double complex *****C,int coinType,const char *filename){
     break;
   }
 
-  if(*C)
-    previousAlloc = 1;
-  else
-    previousAlloc = 0;
-
   return;
 }
 
 
-void setState2D(double complex *****A,options2D_t opts,const char *filename){
-  static char previousAlloc = 0;
+complex4D_t newState2D(options2D_t opts, const inputfile_t *input){
+  complex4D_t A;
 
-  if(previousAlloc){
-    if(opts.lattType == CYCLE_LATT)
-      freeComplex4D(*A, 2, 2, opts.max);
-    else
-      freeComplex4D(*A, 2, 2, 2*opts.max+1);
-  }
-
-  *A = NULL;
+  A.data = NULL;
 
   switch(opts.stateType){
   case CUSTOM_STATE:
-    *A = readStateFile2D(filename,opts.max,opts.lattType);
+    A = readState2D(input,opts.max,opts.lattType,opts.layout);
     break;
   case FOURIER_STATE:
-    *A = createFourierState2D(opts.max,opts.lattType);
+    A = createFourierState2D(opts.max,opts.lattType,opts.layout);
     break;
   case GROVER_STATE:
-    *A = createGroverState2D(opts.max,opts.lattType);
+    A = createGroverState2D(opts.max,opts.lattType,opts.layout);
     break;
   case HADAMARD_STATE:
-    *A = createHadamardState2D(opts.max,opts.lattType);
+    A = createHadamardState2D(opts.max,opts.lattType,opts.layout);
+    break;
+  case FILE_STATE:
+    A = readStateBinary2D(opts.stateFile, opts);
     break;
   }
 
-  if(*A)
-    previousAlloc = 1;
-  else
-    previousAlloc = 0;
+  return A;
+}
+
+
+void setState2D(complex4D_t *A,options2D_t opts,const inputfile_t *input){
+
+  if(A->block)
+    freeTensor4D(A);
+
+  *A = newState2D(opts, input);
 
   return;
 }
@@ -104,7 +107,7 @@ void setState2D(double complex *****A,options2D_t opts,const char *filename){
 
 
 
-void check2D(double complex ****A, options2D_t options, int iteration){
+void check2D(complex4D_t A, options2D_t options, int iteration){
 
   if(options.checkState && !checkState2D(A, options)){
     printf("Error: state norm is not unitary in iteration %d.\n", iteration);
@@ -125,110 +128,329 @@ void check2D(double complex ****A, options2D_t options, int iteration){
 
 
 
-void iterate2D(double complex *****A,double complex *****Atemp,double complex ****C, 
-	       int ****BLinks1, int ****BLinks2, options2D_t opts, int iteration){
-  int m, n, error; 
-  double complex ****aux;
+/* Applies a coin kernel to count sites of a row of the cyclic lattice,
+ * starting at column first, and writes each result shift columns 
+ * (-1, 0 or 1) away. The row is split wherever the source or the 
+ * destination wraps around the end of the lattice.
+ */
+static void kernelCycle2D(coinkernel_t kernel, double complex *dst,
+			  const double complex *const src[4], 
+			  const double complex row[4], long sn, int MAX,
+			  int first, int count, int shift){
+
+  while(count>0){
+    const int c = first%MAX;
+    const int d = (c + shift + MAX)%MAX;
+    const int run = MINIMUM(count, MINIMUM(MAX-c, MAX-d));
+    const double complex *const part[4] = {src[0] + c*sn, src[1] + c*sn,
+					   src[2] + c*sn, src[3] + c*sn};
+
+    kernel(dst + d*sn, part, row, sn, run);
+    first += run;
+    count -= run;
+  }/* end-while */
+
+  return;
+}
+
 
 
-  /* We define constants MAX and LATTEXTRA as shorts for options.max and
-   * options.lattextra, respectively.
-   */
+/* Evolution of a row of sites whose links are all closed. In this case
+ * the coin applied to a site, and the neighbour from which each 
+ * amplitude comes, are the same for all of them (L1 = (-1)^j and 
+ * L2 = (-1)^k, see blinks_t). So the columns (nlo,nhi) of row m are 
+ * updated by four calls of the coin kernel, one for each coin state, 
+ * which can use the vector instructions of the processor.
+ */
+static void iterateClosedRow2D(const complex4D_t Aold, const complex4D_t Anew,
+			       double complex ****C, options2D_t opts,
+			       coinkernel_t kernel, int m, int nlo, int nhi){
+  int j,k;
   const int MAX = opts.max;
-  const int LATTEXTRA = opts.lattextra;
-  const int auxsize = (opts.lattType == CYCLE_LATT) ? opts.max : 2*opts.max+1;
+  const int len = nhi - nlo + 1;
+  const long sm = Aold.stride[2];
+  const long sn = Aold.stride[3];
+  const long coin[2][2] = {{0, Aold.stride[1]}, 
+			   {Aold.stride[0], Aold.stride[0]+Aold.stride[1]}};
+
+  for(j=0; j<2; j++){
+    for(k=0; k<2; k++){
+      const int L = 1-2*j;
+      const int d = DELTA(j,k);
+      const double complex *src[4];
+      double complex row[4];
+
+      switch(opts.lattType){
+      case DIAG_LATT:
+	/* The amplitude comes from site (m+L1,n+L2) and goes to 
+	 * coin state (1-j,1-k).
+	 */
+	row[0] = C[1-j][1-k][0][0];
+	row[1] = C[1-j][1-k][0][1];
+	row[2] = C[1-j][1-k][1][0];
+	row[3] = C[1-j][1-k][1][1];
+	src[0] = Aold.data + coin[0][0] + (m+L)*sm + (nlo+1-2*k)*sn;
+	src[1] = src[0] - coin[0][0] + coin[0][1];
+	src[2] = src[0] - coin[0][0] + coin[1][0];
+	src[3] = src[0] - coin[0][0] + coin[1][1];
+	kernel(Anew.data + coin[1-j][1-k] + m*sm + nlo*sn, 
+	       src, row, sn, len);
+	break;
+
+      case NATURAL_LATT:
+	row[0] = C[1-j][1-k][0][0];
+	row[1] = C[1-j][1-k][0][1];
+	row[2] = C[1-j][1-k][1][0];
+	row[3] = C[1-j][1-k][1][1];
+	src[0] = Aold.data + coin[0][0] + (m + L*(1-d))*sm + (nlo + L*d)*sn;
+	src[1] = src[0] - coin[0][0] + coin[0][1];
+	src[2] = src[0] - coin[0][0] + coin[1][0];
+	src[3] = src[0] - coin[0][0] + coin[1][1];
+	kernel(Anew.data + coin[1-j][1-k] + m*sm + nlo*sn, 
+	       src, row, sn, len);
+	break;
+
+      case CYCLE_LATT:
+	/* Here the amplitudes are pushed from site (m,n) to its 
+	 * neighbour, so the destination row is shifted and may wrap
+	 * around the lattice.
+	 */
+	row[0] = C[j][k][0][0];
+	row[1] = C[j][k][0][1];
+	row[2] = C[j][k][1][0];
+	row[3] = C[j][k][1][1];
+	src[0] = Aold.data + coin[0][0] + m*sm;
+	src[1] = Aold.data + coin[0][1] + m*sm;
+	src[2] = Aold.data + coin[1][0] + m*sm;
+	src[3] = Aold.data + coin[1][1] + m*sm;
+	kernelCycle2D(kernel, Anew.data + coin[j][k] + ((MAX + m + L*(1-d))%MAX)*sm,
+		      src, row, sn, MAX, nlo, len, L*d);
+	break;
+
+      default:
+	printf("Error: invalid lattice type for two-dimensional simulation");
+	exit(EXIT_FAILURE);
+      }/* end-switch */
+
+    }/* End-for k */
+  }/* End-for j */
 
-  /* In the n-th iteration the walker cannot be farther than n sites from 
-   * its initial position. Therefore, we don't need to update the entire 
-   * lattice, but only a square region (lbound,rbound)X(lbound,rbound).
-   * Constant MAX represents the size of the lattice and constant LATTEXTRA 
-   * represents an extra space in the lattice, used to avoid "bound errors" 
-   * when accessing the array.
+  return;
+}
+
+
+
+/* Observables of the columns (nlo,nhi) of row m of the new state (see
+ * observables2D_t), computed right after the row is updated. Each row
+ * is written by a single thread, and so are its entries of RowSums and
+ * SumProb and the points of the screen in it.
+ */
+static void rowObservables2D(const complex4D_t A, observables2D_t *obs,
+			     options2D_t opts, int m, int nlo, int nhi){
+  int n, t, tlo, thi;
+  double sum, fstMoment, secMoment, tvd, tvdu, stat;
+  const double UnifProb = obs->StatProb ? getUniformProb2D(opts) : 0.0;
+  const int MAX = opts.max;
+  const long sm = A.stride[2];
+  const long sn = A.stride[3];
+  const long coin[4] = {0, A.stride[1], A.stride[0], A.stride[0]+A.stride[1]};
+
+  sum = fstMoment = secMoment = tvd = tvdu = stat = 0.0;
+  for(n=nlo; n<=nhi; n++){
+    const double complex *site = A.data + m*sm + n*sn;
+    double prob;
+    int q;
+
+    prob = 0.0;
+    for(q=0; q<4; q++)
+      prob += site[coin[q]]*conj(site[coin[q]]);
+
+    sum += prob;
+    fstMoment += (n-MAX)*prob;
+    secMoment += (n-MAX)*(n-MAX)*prob;
+    if(obs->SumProb)
+      obs->SumProb[m][n] += prob;
+
+    /* The terms of getDistancesFromSumProb2D */
+    if(obs->StatProb){
+      const double average = obs->SumProb[m][n]/(double)obs->steps;
+
+      tvd += fabs( obs->StatProb[m][n] - average );
+      if(opts.lattType != DIAG_LATT || (m+n+1)%2)
+	tvdu += fabs( UnifProb - average );
+      stat += obs->StatProb[m][n];
+    }
+  }/* end-for n */
+
+  obs->RowSums[m][0] = sum;
+  obs->RowSums[m][1] = fstMoment;
+  obs->RowSums[m][2] = secMoment;
+  obs->RowSums[m][3] = tvd;
+  obs->RowSums[m][4] = tvdu;
+  obs->RowSums[m][5] = stat;
+
+  if(!obs->screen)
+    return;
+
+  /* The points t of the screen in this row: all of them if the screen
+   * is vertical (xvar = 0), or at most one, since xvar is 1 or -1. The 
+   * amplitudes are added one by one, as in updateScreen, so the screen
+   * is the same.
    */
-  const int lbound = (opts.lattType == CYCLE_LATT) ? 
-    0 : MAXIMUM(MAX-LATTEXTRA-iteration, 1);
-  const int rbound = (opts.lattType == CYCLE_LATT) ? 
-    MAX-1 : MINIMUM(MAX+LATTEXTRA+iteration, 2*MAX-1);
+  if(obs->screen->xvar == 0){
+    tlo = (m == MAX + obs->screen->xa) ? 0 : obs->screen->numpts;
+    thi = obs->screen->numpts - 1;
+  }
+  else
+    tlo = thi = (m - MAX - obs->screen->xa)*obs->screen->xvar;
 
-  error = cleanComplex4D(*Atemp, 2, 2, auxsize, auxsize);
-  if(error){
-    printf("Error: could not clean temporary matrix in iteration %d.\n", iteration);
-    exit(EXIT_FAILURE);
+  for(t=MAXIMUM(tlo,0); t<=MINIMUM(thi,obs->screen->numpts-1); t++){
+    const int sy = MAX + obs->screen->ya + obs->screen->yvar*t;
+    int q;
+
+    if(sy < nlo || sy > nhi)
+      continue;
+    for(q=0; q<4; q++)
+      obs->screen->values[t] += A.data[m*sm + sy*sn + coin[q]]*
+	conj(A.data[m*sm + sy*sn + coin[q]]);
+  }/* end-for t */
+
+  return;
+}
+
+
+
+/* Evolution of the rectangle (mlo,mhi)X(nlo,nhi) when all the links 
+ * are closed. If obs is not NULL the observables of each row are 
+ * computed after it is updated.
+ */
+static void iterateClosed2D(const complex4D_t Aold, const complex4D_t Anew,
+			    double complex ****C, options2D_t opts,
+			    int mlo, int mhi, int nlo, int nhi,
+			    observables2D_t *obs){
+  int m;
+  const coinkernel_t kernel = getCoinKernel(opts.coinType);
+
+#pragma omp parallel for schedule(static) \
+  num_threads(opts.threads) if(opts.threads > 1)
+  for(m = mlo; m <= mhi; m++){
+    iterateClosedRow2D(Aold, Anew, C, opts, kernel, m, nlo, nhi);
+    if(obs)
+      rowObservables2D(Anew, obs, opts, m, nlo, nhi);
   }
 
-  switch(opts.lattType){
-    /* This "switch" looks ugly, but it is better for performance. It 
-     * is a good programming practice to avoid "if"s inside loops.
-     */
+  return;
+}
 
-  case DIAG_LATT:
-    for(m = lbound; m <= rbound; m++){
-      for(n = lbound; n <= rbound; n++){
+
+
+/* Runs of closed sites shorter than this are updated site by site, 
+ * since the calls of the coin kernel would cost more than they save.
+ */
+#define MIN_CLOSED_RUN 16
+
+/* Evolution of the columns (nlo,nhi) of row m when some links may be
+ * broken. The runs of at least MIN_CLOSED_RUN sites without broken 
+ * links are updated by iterateClosedRow2D, and the other sites one by
+ * one. Further information on the broken links can be found in 
+ * Physical Review A, 74, 012312 (2006).
+ */
+static void iterateRow2D(const complex4D_t Aold, const complex4D_t Anew,
+			 double complex ****C, blinks_t BLinks, options2D_t opts,
+			 coinkernel_t kernel, int m, int nlo, int nhi){
+  int n = nlo;
+  const int MAX = opts.max;
+  const long sm = Aold.stride[2];
+  const long sn = Aold.stride[3];
+  const long coin[2][2] = {{0, Aold.stride[1]}, 
+			   {Aold.stride[0], Aold.stride[0]+Aold.stride[1]}};
+
+  while(n <= nhi){
+    const int next = nextBrokenSite2D(BLinks, m, n, nhi+1);
+    int last;
+
+    if(next - n >= MIN_CLOSED_RUN){
+      iterateClosedRow2D(Aold, Anew, C, opts, kernel, m, n, next-1);
+      n = next;
+    }
+    last = MINIMUM(next, nhi);
+
+    switch(opts.lattType){
+      /* This "switch" looks ugly, but it is better for performance. It 
+       * is a good programming practice to avoid "if"s inside loops.
+       */
+
+    case DIAG_LATT:
+      for(; n <= last; n++){
+	const long site = m*sm + n*sn;
 	int j,k;
 
 	for(j=0; j<2; j++){
 	  for(k=0; k<2; k++){
 	    int L1,L2, jprime,kprime;
+	    const double complex *src;
 	    double complex newValue; 
 
-	    /* Further information on the matrices of broken links
-	     * can be found in Physical Review A, 74, 012312 (2006)
-	     */
-	    L1 = BLinks1[j][k][m][n];
-	    L2 = BLinks2[j][k][m][n];
+	    if(ISBROKEN2D(BLinks,j,k,m,n))
+	      L1 = L2 = 0;
+	    else{
+	      L1 = 1-2*j;
+	      L2 = 1-2*k;
+	    }
+	    src = Aold.data + site + L1*sm + L2*sn;
 
 	    newValue = 0.0;
 	    for(jprime=0; jprime<2; jprime++){
 	      for(kprime=0; kprime<2; kprime++){
 
 		newValue += C[j+L1][k+L2][jprime][kprime]*
-		  (*A)[jprime][kprime][m+L1][n+L2];
+		  src[coin[jprime][kprime]];
 
 	      }/* End-for kprime */
 	    }/* End-for jprime */
 
-	    (*Atemp)[1-j][1-k][m][n] = newValue;
+	    Anew.data[site + coin[1-j][1-k]] = newValue;
 
 	  }/* End-for k */
 	}/* End-for j */
 
       }/* End-for n */
-    }/* End-for m */
-    break;
+      break;
 
-  case NATURAL_LATT:
-    for(m = lbound; m <= rbound; m++){
-      for(n = lbound; n <= rbound; n++){
+    case NATURAL_LATT:
+      for(; n <= last; n++){
+	const long site = m*sm + n*sn;
 	int j,d;
 
 	for(j=0; j<2; j++){
 	  for(d=0; d<2; d++){
 	    int L,jprime,dprime;
+	    const double complex *src;
 	    double complex newValue; 
 
-	    L = BLinks1[j][d][m][n];
+	    L = ISBROKEN2D(BLinks,j,d,m,n) ? 0 : 1-2*j;
+	    src = Aold.data + site + L*(1-DELTA(j,d))*sm + L*DELTA(j,d)*sn;
 	    newValue = 0.0;
 	    for(jprime=0; jprime<2; jprime++){
 	      for(dprime=0; dprime<2; dprime++){
 
 		newValue += C[j+L][abs(d+L)%2][jprime][dprime]*
-		  (*A)[jprime][dprime][m + L*(1-DELTA(j,d))][n + L*DELTA(j,d)];
+		  src[coin[jprime][dprime]];
 
 	      }/* End-for kprime */
 	    }/* End-for jprime */
-	    (*Atemp)[1-j][1-d][m][n] = newValue;
+	    Anew.data[site + coin[1-j][1-d]] = newValue;
 	    
 
 	  }/* End-for k */
 	}/* End-for j */
 
       }/* End-for n */
-    }/* End-for m */
-    break;
+      break;
 
-  case CYCLE_LATT:
-    for(m = lbound; m <= rbound; m++){
-      for(n = lbound; n <= rbound; n++){
+    case CYCLE_LATT:
+      for(; n <= last; n++){
+	const double complex *src = Aold.data + m*sm + n*sn;
 	int j,d;
 
 	for(j=0; j<2; j++){
@@ -236,29 +458,155 @@ void iterate2D(double complex *****A,double complex *****Atemp,double complex **
 	    int L,jprime,dprime;
 	    double complex newValue; 
 
-	    L = BLinks1[j][d][m][n];
+	    L = ISBROKEN2D(BLinks,j,d,m,n) ? 0 : 1-2*j;
 	    newValue = 0.0;
 	    for(jprime=0; jprime<2; jprime++){
 	      for(dprime=0; dprime<2; dprime++){
 
-		newValue += C[j][d][jprime][dprime]*(*A)[jprime][dprime][m][n];
+		newValue += C[j][d][jprime][dprime]*src[coin[jprime][dprime]];
 
 	      }/* End-for kprime */
 	    }/* End-for jprime */
-	    (*Atemp)[1-(j+L)][1-abs(d+L)%2][(MAX + m + L*(1-DELTA(j,d)))%MAX][(MAX + n + L*DELTA(j,d))%MAX] = newValue;
+	    Anew.data[coin[1-(j+L)][1-abs(d+L)%2] + 
+		      ((MAX + m + L*(1-DELTA(j,d)))%MAX)*sm +
+		      ((MAX + n + L*DELTA(j,d))%MAX)*sn] = newValue;
 
 	  }/* End-for k */
 	}/* End-for j */
 
       }/* End-for n */
-    }/* End-for m */
-    break;
+      break;
 
-  default:
-    printf("Error: invalid lattice type for two-dimensional simulation");
-    exit(EXIT_FAILURE);
+    default:
+      printf("Error: invalid lattice type for two-dimensional simulation");
+      exit(EXIT_FAILURE);
         
-  }/* end-switch */
+    }/* end-switch */
+  }/* end-while */
+
+  return;
+}
+
+
+
+void iterate2D(complex4D_t *A, complex4D_t *Atemp, double complex ****C, 
+	       blinks_t BLinks, options2D_t opts, int iteration,
+	       observables2D_t *obs){
+  int m, error; 
+  complex4D_t aux;
+
+
+  /* We define constants MAX and LATTEXTRA as shorts for options.max and
+   * options.lattextra, respectively.
+   */
+  const int MAX = opts.max;
+  const int LATTEXTRA = opts.lattextra;
+
+  /* Local copies of the state structures. Since both arrays are 
+   * contiguous, the address of an entry is computed directly from
+   * the strides, without any pointer chasing.
+   *
+   * The entry (j,k,m,n) of either matrix lies at the position 
+   * coin[j][k] + m*sm + n*sn of the array data. This holds for the 
+   * coin-major and for the site-major layouts, so the loops work on
+   * both of them. In the site-major layout the four amplitudes read 
+   * from a site share the same cache line.
+   */
+  const complex4D_t Aold = *A;
+  const complex4D_t Anew = *Atemp;
+
+  /* In the n-th iteration the walker cannot be farther than n sites from 
+   * its initial position. Therefore, we don't need to update the entire 
+   * lattice, but only a square region (lbound,rbound)X(lbound,rbound).
+   * Constant MAX represents the size of the lattice and constant LATTEXTRA 
+   * represents an extra space in the lattice, used to avoid "bound errors" 
+   * when accessing the array.
+   */
+  const int lbound = (opts.lattType == CYCLE_LATT) ? 
+    0 : MAXIMUM(MAX-LATTEXTRA-iteration, 1);
+  const int rbound = (opts.lattType == CYCLE_LATT) ? 
+    MAX-1 : MINIMUM(MAX+LATTEXTRA+iteration, 2*MAX-1);
+
+  /* In the CYCLE lattice we update the support of the wave function 
+   * instead (see getSupport2D). It may wrap around the lattice, so it 
+   * is split in at most 2x2 rectangles that do not wrap.
+   */
+  const support2D_t supp = getSupport2D(opts, iteration);
+  int rows[2][2], cols[2][2], nrows, ncols, ir, ic;
+  const coinkernel_t kernel = getCoinKernel(opts.coinType);
+
+  for(m=0; m<4; m++)
+    if(Anew.stride[m] != Aold.stride[m]){
+      printf("Error: temporary matrix has a different memory layout.\n");
+      exit(EXIT_FAILURE);
+    }
+
+  nrows = getSupportRanges(supp.lo[0], supp.len[0], MAX, rows);
+  ncols = getSupportRanges(supp.lo[1], supp.len[1], MAX, cols);
+
+  /* The loops below write every entry of Anew inside the square (or 
+   * every entry reached from the support, in the cyclic lattice). 
+   * Outside of it Anew is zero, since it holds the state of the 
+   * iteration before the previous one, whose region was smaller. So we
+   * only clean Anew in the first two iterations, when we do not know 
+   * where it came from.
+   */
+  if(iteration < 2){
+    error = cleanTensor4D(Anew);
+    if(error){
+      printf("Error: could not clean temporary matrix in iteration %d.\n", iteration);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if(obs){
+    if(opts.lattType == CYCLE_LATT){
+      printf("Error: observables are not computed in the cyclic lattice.\n");
+      exit(EXIT_FAILURE);
+    }
+    obs->mlo = lbound;
+    obs->mhi = rbound;
+    obs->steps = iteration+1;
+  }
+
+  if(opts.blType == NO_BROKENLINKS && opts.blProbA <= 0.0 && opts.blProbB <= 0.0){
+    if(opts.lattType == CYCLE_LATT){
+      for(ir=0; ir<nrows; ir++)
+	for(ic=0; ic<ncols; ic++)
+	  iterateClosed2D(Aold, Anew, C, opts, rows[ir][0], rows[ir][1]-1,
+			  cols[ic][0], cols[ic][1]-1, NULL);
+    }
+    else
+      iterateClosed2D(Aold, Anew, C, opts, lbound, rbound, lbound, rbound, obs);
+  }
+
+  /* Each entry of Anew depends only on Aold, so the rows of the square
+   * (lbound,rbound)X(lbound,rbound) are split in bands, one for each 
+   * thread. Every entry is computed exactly as in the serial code, and
+   * the result does not depend on the number of threads. In the cyclic
+   * lattice a thread may write in the rows of its neighbours, but each 
+   * entry of Anew is still written by a single site of Aold.
+   */
+  else if(opts.lattType == CYCLE_LATT){
+    for(ir=0; ir<nrows; ir++){
+      for(ic=0; ic<ncols; ic++){
+#pragma omp parallel for schedule(static) \
+  num_threads(opts.threads) if(opts.threads > 1)
+	for(m = rows[ir][0]; m < rows[ir][1]; m++)
+	  iterateRow2D(Aold, Anew, C, BLinks, opts, kernel, m, 
+		       cols[ic][0], cols[ic][1]-1);
+      }/* End-for ic */
+    }/* End-for ir */
+  }
+  else{
+#pragma omp parallel for schedule(static) \
+  num_threads(opts.threads) if(opts.threads > 1)
+    for(m = lbound; m <= rbound; m++){
+      iterateRow2D(Aold, Anew, C, BLinks, opts, kernel, m, lbound, rbound);
+      if(obs)
+	rowObservables2D(Anew, obs, opts, m, lbound, rbound);
+    }
+  }
   
   /* Now we quicky exchange matrices A and Atemp */
   aux = *A;
@@ -271,12 +619,82 @@ void iterate2D(double complex *****A,double complex *****Atemp,double complex **
 
 
 
-double **getStationary2D(double complex ****A, double complex ****C, 
-			 int ****BLinks1, int ****BLinks2, 
-			 options2D_t options){
+/* Checkpoint of the tolerance of the stationary distribution (see 
+ * getStationary2D) after step t, which must be equal to *check. sum 
+ * contains the sums of the probabilities up to step t and previous the
+ * sums at the last checkpoint (*lastCheck, or 0 if there is none). The
+ * function updates previous, *check, *lastCheck and *error, and returns
+ * 1 if the average has converged.
+ */
+static int mixCheckpoint2D(double **sum, double **previous, int rbound, int t,
+			   int *check, int *lastCheck, float *error, float tol){
+  int m, n;
+
+  /* L1 distance between the averages at this checkpoint and at the
+   * last one.
+   */
+  if(*lastCheck){
+    double dist = 0.0;
+
+    for(m=0; m<rbound; m++)
+      for(n=0; n<rbound; n++)
+	dist += fabs(sum[m][n]/t - previous[m][n]/(*lastCheck));
+    *error = dist;
+  }
+
+  for(m=0; m<rbound; m++)
+    for(n=0; n<rbound; n++)
+      previous[m][n] = sum[m][n];
+  *check = 2*t;
+
+  if(*lastCheck && *error < tol)
+    return 1;
+  *lastCheck = t;
+
+  return 0;
+}
+
+
+
+/* Evolves the state *A from step *t to step tEnd of the calculation of
+ * the stationary distribution (see getStationary2D), adding the 
+ * probabilities of each step to sum. previous, *check, *lastCheck and
+ * *error are the ones of mixCheckpoint2D (previous is NULL if there is
+ * no tolerance). The function updates *t, and returns 1 if the average
+ * has converged.
+ */
+static int stationarySteps2D(complex4D_t *A, complex4D_t *Atemp, 
+			     double complex ****C, blinks_t BLinks, 
+			     options2D_t options, double **sum, 
+			     double **previous, int *t, int tEnd, int *check,
+			     int *lastCheck, float *error){
+  const int rbound = (options.lattType == CYCLE_LATT) ? 
+    options.max : 2*options.max+1;
+
+  while(*t < tEnd){
+    iterate2D(A, Atemp, C, BLinks, options, *t, NULL);
+    addProbFromState2D(sum, *A, options, *t+1);
+    (*t)++;
+
+    if(previous && *t == *check &&
+       mixCheckpoint2D(sum, previous, rbound, *t, check, lastCheck,
+		       error, options.mixTol))
+      return 1;
+  }
+
+  return 0;
+}
+
+
+
+double **getStationary2D(complex4D_t A, double complex ****C, 
+			 blinks_t BLinks, options2D_t options,
+			 int *stepsMix, float *error){
   int m,n,t;
-  double complex ****Atemp;
-  double **stationary;
+  int check, lastCheck;
+  complex4D_t Atemp;
+  const complex4D_t Ainit = A;
+  double **stationary, **previous = NULL;
   const int MAX = options.max;
   const int rbound = (options.lattType == CYCLE_LATT) ? MAX : 2*MAX+1;
 
@@ -286,48 +704,160 @@ double **getStationary2D(double complex ****A, double complex ****C,
 
   cleanReal2D(stationary, rbound, rbound);
 
-  Atemp = allocComplex4D(2, 2, rbound, rbound);
-  if(!Atemp)
+  /* With a tolerance, the sums at the last checkpoint are kept in 
+   * previous. The first checkpoint is after rbound steps, and the
+   * distance between checkpoints doubles each time.
+   */
+  if(options.mixTol > 0.0){
+    previous = allocReal2D(rbound, rbound);
+    if(!previous)
+      return NULL;
+  }
+  check = rbound;
+  lastCheck = 0;
+  *error = -1.0;
+
+  Atemp = allocState2D(MAX, options.lattType, options.layout);
+  if(!Atemp.data)
     return NULL;
 
-  for(t=0; t<options.stepsMix; t++){
+  t = 0;
+  stationarySteps2D(&A, &Atemp, C, BLinks, options, stationary, previous,
+		    &t, options.stepsMix, &check, &lastCheck, error);
+  *stepsMix = t;
 
-    iterate2D(&A, &Atemp, C, BLinks1, BLinks2, options, t);
-    for(m=0; m<rbound; m++){
-      for(n=0; n<rbound; n++){
-	int j,k;
-	double prob = 0.0;
+  /* Since iterate2D exchanges the arrays at every step, we must free 
+   * the one that was not passed by the caller.
+   */
+  if(Atemp.data == Ainit.data)
+    freeTensor4D(&A);
+  else
+    freeTensor4D(&Atemp);
+  if(previous)
+    freeReal2D(previous, rbound);
+
+  for(m=0; m<rbound; m++)
+    for(n=0; n<rbound; n++)
+      stationary[m][n] /= t;
 
-	for(j=0; j<2; j++)
-	  for(k=0; k<2; k++)
-	    prob += A[j][k][m][n]*conj(A[j][k][m][n]);
+  if(!checkProb2D(stationary,MAX,options.lattType))
+    return NULL;
 
-	stationary[m][n] += prob;
-      }
+  return stationary;
+}
+
+
+
+
+/* Number of the sites of the square (lo,hi)X(lo,hi) which enter the
+ * total variation distance to the uniform distribution (see 
+ * getDistancesFromSumProb2D): all of them, except in the DIAG lattice,
+ * where only the sites (m,n) with m+n even are used. The corners of 
+ * the square are such sites.
+ */
+static double uniformSites2D(options2D_t opts, int lo, int hi){
+  const double side = hi - lo + 1;
+
+  if(side <= 0)
+    return 0.0;
+  if(opts.lattType != DIAG_LATT)
+    return side*side;
+
+  return floor((side*side + 1.0)/2.0);
+}
+
+
+
+statistics_t getStatisticsFromObservables2D(observables2D_t obs, 
+					    options2D_t opts, int iteration){
+  statistics_t stat;
+  double fstMomentX, secMomentX, fstMomentY, secMomentY;
+  double tvd, tvdu, visited;
+  int m;
+  const int auxsize = 2*opts.max+1;
+
+  fstMomentX = secMomentX = fstMomentY = secMomentY = 0.0;
+  tvd = tvdu = visited = 0.0;
+  for(m=obs.mlo; m<=obs.mhi; m++){
+    const int x = m - opts.max;
+
+    fstMomentX += x*obs.RowSums[m][0];
+    secMomentX += x*x*obs.RowSums[m][0];
+    fstMomentY += obs.RowSums[m][1];
+    secMomentY += obs.RowSums[m][2];
+    if(obs.StatProb){
+      tvd += obs.RowSums[m][3];
+      tvdu += obs.RowSums[m][4];
+      visited += obs.RowSums[m][5];
     }
+  }/* end-for m */
 
+  stat = getStatisticsFromMoments2D(fstMomentX, secMomentX, 
+				    fstMomentY, secMomentY, iteration);
+
+  /* Outside the square updated by iterate2D the walker has never been,
+   * so SumProb is zero there, and each site adds its stationary 
+   * probability to tvd and the uniform probability to tvdu.
+   */
+  if(obs.StatProb){
+    stat.tvd = tvd + (obs.StatTotal - visited);
+    stat.tvdu = tvdu + getUniformProb2D(opts)*
+      (uniformSites2D(opts, 0, auxsize-1) - 
+       uniformSites2D(opts, obs.mlo, obs.mhi));
   }
 
-  freeComplex4D(Atemp, 2, 2, rbound);
+  return stat;
+}
 
-  for(m=0; m<rbound; m++)
-    for(n=0; n<rbound; n++)
-      stationary[m][n] /= options.stepsMix;
 
-  if(!checkProb2D(stationary,MAX,options.lattType))
-    return NULL;
 
-  return stationary;
+void doStatistics2D(qw2d_context *ctx, int iteration, int experiment){
+  statistics_t stat;
+  const options2D_t options = ctx->options;
+
+  /* In the steps without statistics only the sums of the mixing time
+   * are updated.
+   */
+  if(!STATSTEP(iteration, options.statEvery, options.steps)){
+    if(options.calcMix)
+      addProbFromState2D(ctx->SumProb, ctx->A, options, iteration);
+    return;
+  }
+
+  /* Here we get the statistics for this step */
+  stat = getStatisticsFromState2D(ctx->A, ctx->StatProb, ctx->SumProb, 
+				  ctx->options, iteration);
+  if(stat.iteration<0){
+    printf("Error: could not generate statistics.\n");
+    exit(EXIT_FAILURE);
+  }
+
+  saveStatistics2D(ctx, stat, iteration, experiment);
+
+  return;
 }
 
 
 
+/* Writes the averaged statistics of a step in the statistics file,
+ * through the writer of the context when simulate2D has opened it. 
+ */
+static int writeStep2D(qw2d_context *ctx, int iteration){
+
+  if(ctx->staWriter)
+    return sendStatistics(ctx->staWriter, ctx->vStat[iteration]);
+
+  return writeStatistics(ctx->fnames.sta_file, ctx->vStat[iteration], 
+			 iteration <= ctx->options.statEvery);
+}
 
-void doStatistics2D(double complex ****A, double **StatProb, options2D_t options, 
-		    filenames_t fnames, int iteration, int experiment){
+
+
+void saveStatistics2D(qw2d_context *ctx, statistics_t stat, 
+		      int iteration, int experiment){
   int error;
-  statistics_t stat;
-  static statistics_t *vStat = NULL;
+  statistics_t *vStat = ctx->vStat;
+  const options2D_t options = ctx->options;
 
   if(iteration<1 || iteration>options.steps){
     printf("Error: unexpected number of steps when calculating statistics.\n");
@@ -338,37 +868,11 @@ void doStatistics2D(double complex ****A, double **StatProb, options2D_t options
     exit(EXIT_FAILURE);
   }
 
-  if((experiment == 1) && (iteration == 1)){
-    /* The first call of this subroutine, i.e., first iteration of
-     * first experiment
-     */
-    register int t;
-
-    vStat = (statistics_t *)malloc((options.steps+1)*sizeof(statistics_t));
-    for(t=1; t<=options.steps; t++){
-      /* Initializing the array of structures */
-      vStat[t].iteration = t;
-      vStat[t].variance = 0.0;
-      vStat[t].meanX = 0.0;
-      vStat[t].meanY = 0.0;
-      vStat[t].tvd = 0.0;
-      vStat[t].tvdu = 0.0;
-    }
-
-  }
-
   if(!vStat){
     printf("Error: invalid statistics vector\n");
     exit(EXIT_FAILURE);
   }
 
-  /* Here we get the statistics for this step */
-  stat = getStatisticsFromState2D(A, StatProb, options, iteration);
-  if(stat.iteration<0){
-    printf("Error: could not generate statistics.\n");
-    exit(EXIT_FAILURE);
-  }
-
 
   /* Here we accumulate the results of this iteration in 
    * the structure 
@@ -391,36 +895,29 @@ void doStatistics2D(double complex ****A, double **StatProb, options2D_t options
     vStat[iteration].tvdu /= options.numOfExperiments;
 
     /* Here we write the statistics in the appropriate file */
-    error = writeStatistics(fnames.sta_file,vStat[iteration]);
+    error = writeStep2D(ctx, iteration);
     if(error){
       printf("Error: could not write statistics.\n");
       exit(EXIT_FAILURE);
     }
   }
 
-  if((experiment == options.numOfExperiments) && (iteration == options.steps)){
-    /* The last call of this subroutine, i.e., last iteration 
-     * of last experiment 
-     */
-    free(vStat);
-    vStat = NULL;
-  }
-
   return;
 }
 
 
-void randomBrokenLink2D(int *****BLinks1, int *****BLinks2, options2D_t options){
+void randomBrokenLink2D(blinks_t BLinks, options2D_t options, rng_t *rng){
+  long long k, count;
   int m,n;
 
   /* We define constants MAX and LATTEXTRA as shorts for options.max and
    * options.lattextra, respectively.
    */
   const int MAX = options.max;
+  const double pA = options.blProbA;
+  const double pB = options.blProbB;
 
-  if(!*BLinks1)
-    return;
-  if(!*BLinks2)
+  if(!BLinks.bits)
     return;
 
   if(MAX<1)
@@ -429,75 +926,1362 @@ void randomBrokenLink2D(int *****BLinks1, int *****BLinks2, options2D_t options)
   if((options.blProbA < 0.0) || options.blProbB < 0.0)
     return;
 
+  /* Each family of links (A or B) is numbered row by row, and instead of
+   * testing every link we jump from one broken link to the next one, 
+   * skipping a number of links drawn from the geometric distribution 
+   * (see getSkip). The cost is proportional to the number of broken 
+   * links, and each link is still broken with the same probability.
+   */
   if(options.lattType == DIAG_LATT){
-
-    for(m=0; m<2*MAX; m++){
-      for(n=0; n<2*MAX; n++){
-	if(rand() < options.blProbA*RAND_MAX){
-	  (*BLinks1)[0][0][ m ][ n ] = 0;
-	  (*BLinks1)[1][1][m+1][n+1] = 0;
-	  (*BLinks2)[0][0][ m ][ n ] = 0;
-	  (*BLinks2)[1][1][m+1][n+1] = 0;
-	}
-      }
+    const int W = 2*MAX;
+
+    count = (long long)W*W;
+    for(k = getSkip(rng, pA, count); k < count; k += 1 + getSkip(rng, pA, count)){
+      m = (int)(k/W);
+      n = (int)(k%W);
+      BREAKLINK2D(BLinks,0,0,m,n);
+      BREAKLINK2D(BLinks,1,1,m+1,n+1);
     }
-    for(m=1; m<=2*MAX; m++){
-      for(n=0; n<2*MAX; n++){
-	if(rand() < options.blProbB*RAND_MAX){
-	  (*BLinks1)[1][0][ m ][ n ] = 0;
-	  (*BLinks1)[0][1][m-1][n+1] = 0;
-	  (*BLinks2)[1][0][ m ][ n ] = 0;
-	  (*BLinks2)[0][1][m-1][n+1] = 0;
-	}
-      }
+    for(k = getSkip(rng, pB, count); k < count; k += 1 + getSkip(rng, pB, count)){
+      m = 1 + (int)(k/W);
+      n = (int)(k%W);
+      BREAKLINK2D(BLinks,1,0,m,n);
+      BREAKLINK2D(BLinks,0,1,m-1,n+1);
     }
     
   }
   else if(options.lattType == NATURAL_LATT){
-
-    for(m=0; m<2*MAX; m++){
-      for(n=0; n<2*MAX; n++){
-	if(rand() < options.blProbA*RAND_MAX){
-	  (*BLinks1)[0][1][ m ][ n ] = 0;
-	  (*BLinks1)[1][0][m+1][ n ] = 0;
-	}
-	if(rand() < options.blProbB*RAND_MAX){
-	  (*BLinks1)[0][0][ m ][ n ] = 0;
-	  (*BLinks1)[1][1][ m ][n+1] = 0;
-	}
-      }
-    }
-    for(m=0; m<2*MAX; m++){
-      if(rand() < options.blProbA*RAND_MAX){
-	(*BLinks1)[0][1][ m ][2*MAX] = 0;
-	(*BLinks1)[1][0][m+1][2*MAX] = 0;
-      }
+    const int W = 2*MAX;
+
+    /* Links A: m from 0 to 2*MAX-1 and n from 0 to 2*MAX */
+    count = (long long)W*(W+1);
+    for(k = getSkip(rng, pA, count); k < count; k += 1 + getSkip(rng, pA, count)){
+      m = (int)(k/(W+1));
+      n = (int)(k%(W+1));
+      BREAKLINK2D(BLinks,0,1,m,n);
+      BREAKLINK2D(BLinks,1,0,m+1,n);
     }
-    for(n=0; n<2*MAX; n++){
-      if(rand() < options.blProbB*RAND_MAX){
-	(*BLinks1)[0][0][2*MAX][ n ] = 0;
-	(*BLinks1)[1][1][2*MAX][n+1] = 0;
-      }
+    /* Links B: m from 0 to 2*MAX and n from 0 to 2*MAX-1 */
+    for(k = getSkip(rng, pB, count); k < count; k += 1 + getSkip(rng, pB, count)){
+      m = (int)(k/W);
+      n = (int)(k%W);
+      BREAKLINK2D(BLinks,0,0,m,n);
+      BREAKLINK2D(BLinks,1,1,m,n+1);
     }
 
   }
   else{  /* if(options.lattType == CYCLE_LATT) */
 
-    for(m=0; m<MAX; m++){
-      for(n=0; n<MAX; n++){
-	if(rand() < options.blProbA*RAND_MAX){
-	  (*BLinks1)[0][1][ m ][ n ] = 0;
-	  (*BLinks1)[1][0][(m+1)%MAX][ n ] = 0;
-	}
-	if(rand() < options.blProbB*RAND_MAX){
-	  (*BLinks1)[0][0][ m ][ n ] = 0;
-	  (*BLinks1)[1][1][ m ][(n+1)%MAX] = 0;
-	}
-      }
+    count = (long long)MAX*MAX;
+    for(k = getSkip(rng, pA, count); k < count; k += 1 + getSkip(rng, pA, count)){
+      m = (int)(k/MAX);
+      n = (int)(k%MAX);
+      BREAKLINK2D(BLinks,0,1,m,n);
+      BREAKLINK2D(BLinks,1,0,(m+1)%MAX,n);
+    }
+    for(k = getSkip(rng, pB, count); k < count; k += 1 + getSkip(rng, pB, count)){
+      m = (int)(k/MAX);
+      n = (int)(k%MAX);
+      BREAKLINK2D(BLinks,0,0,m,n);
+      BREAKLINK2D(BLinks,1,1,m,(n+1)%MAX);
     }
     
   }
-
   
   return;
 }
+
+
+
+int initContext2D(qw2d_context *ctx, options2D_t options, 
+		  const char *filename, const inputfile_t *input){
+  int t;
+  const int MAX = options.max;
+  const int auxsize = (options.lattType == CYCLE_LATT) ? MAX : 2*MAX+1;
+
+  /* Every pointer is set first, so that freeContext2D may be called 
+   * even if the initialization fails.
+   */
+  ctx->options = options;
+  ctx->input = input;
+  ctx->C = NULL;
+  ctx->staWriter = NULL;
+  ctx->snapWriter = NULL;
+  ctx->A.data = ctx->Atemp.data = NULL;
+  ctx->A.block = ctx->Atemp.block = NULL;
+  ctx->BLinks.bits = ctx->BLinksPerm.bits = NULL;
+  ctx->AverageProb = ctx->StatProb = ctx->SumProb = NULL;
+  ctx->RowSums = NULL;
+  ctx->vStat = NULL;
+  ctx->screen.values = NULL;
+  ctx->steps = 0;
+  ctx->initial.offset = NULL;
+  ctx->initial.value = NULL;
+  ctx->initial.numEntries = 0;
+
+  /* Description of the simulation in the checkpoint files */
+  memset(&ctx->check, 0, sizeof(checkheader_t));
+  memcpy(ctx->check.magic, CHECK_MAGIC, sizeof(CHECK_MAGIC));
+  ctx->check.version = CHECK_VERSION;
+  ctx->check.dimension = 2;
+  ctx->check.seed = options.seed;
+  ctx->check.max = MAX;
+  ctx->check.lattType = options.lattType;
+  ctx->check.layout = options.layout;
+  ctx->check.coinType = options.coinType;
+  ctx->check.stateType = options.stateType;
+  ctx->check.numOfExperiments = options.numOfExperiments;
+  ctx->check.optSteps = options.steps;
+  ctx->check.optStepsMix = options.stepsMix;
+  ctx->check.statEvery = options.statEvery;
+  ctx->check.calcMix = options.calcMix;
+  ctx->check.blProb[0] = options.blProbA;
+  ctx->check.blProb[1] = options.blProbB;
+  ctx->check.dtProb = options.dtProb;
+  ctx->check.mixTol = options.mixTol;
+
+  /* Here we define the names of output files based on the 
+   * name of input file 
+   */
+  ctx->fnames = createFilenames2D(filename, options);
+
+  /* First we initialize all the links closed */
+  if(initBrokenLink2D(&ctx->BLinks, MAX, options.lattType))
+    return 1;
+
+  /* In case of broken links, we read the broken link file in 
+   * order to open the appropriate links. Note that the broken 
+   * link information can be written in the same file used for 
+   * the general options (usually a file with extension .in)     
+   * The file is read only once: the permanent topology is kept in
+   * BLinksPerm, and copied when it is needed again.
+   */
+  if(options.blType == PERMANENT_BROKENLINKS){
+    if(initBrokenLink2D(&ctx->BLinksPerm, MAX, options.lattType))
+      return 1;
+    if(readBrokenLink2D(input, MAX, ctx->BLinksPerm, options.lattType))
+      return 2;
+    copyBrokenLink(ctx->BLinks, ctx->BLinksPerm);
+  }
+
+  setCoin2D(&ctx->C, options.coinType, input);
+  if(!ctx->C)
+    return 3;
+
+  /* A binary state file is checked here, before the initial state is
+   * read from it (see below).
+   */
+  if(options.stateType == FILE_STATE && 
+     checkStateBinary2D(options.stateFile, options))
+    return 7;
+
+  /* The detectors are measured at every step (see measureState2D), so
+   * their coordinates are checked only once, here.
+   */
+  for(t=1; t<=options.detectors; t++){
+    const int lbound = (options.lattType == CYCLE_LATT) ? 0 : -MAX;
+    const int rbound = (options.lattType == CYCLE_LATT) ? MAX-1 : MAX;
+
+    if(options.detector_pts[t][0] < lbound || options.detector_pts[t][0] > rbound ||
+       options.detector_pts[t][1] < lbound || options.detector_pts[t][1] > rbound)
+      return 6;
+  }
+
+  /* If an observation screen was required in the input file then this
+   * screen is initialized here. The screen is represented by a straight
+   * line from (a0,a1) to (b0,b1) 
+   */
+  if(options.screen)
+    if(initScreen(&ctx->screen, options.screen_pta[0], options.screen_pta[1], 
+		  options.screen_ptb[0], options.screen_ptb[1]))
+      return 4;
+
+  ctx->Atemp = allocState2D(MAX, options.lattType, options.layout);
+  if(!ctx->Atemp.data)
+    return 5;
+
+  /* The initial state is built (or read from the input file) only once,
+   * here. Its non-zero amplitudes are kept in a template, from which it
+   * is set again in the same array at the beginning of each experiment
+   * (see startState2D).
+   */
+  ctx->A = newState2D(options, input);
+  if(!ctx->A.data)
+    return 8;
+  if(newStateTemplate2D(&ctx->initial, ctx->A, options))
+    return 5;
+  ctx->options.support = ctx->initial.support;
+
+  ctx->vStat = (statistics_t *)malloc((options.steps+1)*sizeof(statistics_t));
+  if(!ctx->vStat)
+    return 5;
+  for(t=1; t<=options.steps; t++){
+    /* Initializing the array of structures */
+    ctx->vStat[t].iteration = t;
+    ctx->vStat[t].variance = 0.0;
+    ctx->vStat[t].meanX = 0.0;
+    ctx->vStat[t].meanY = 0.0;
+    ctx->vStat[t].tvd = 0.0;
+    ctx->vStat[t].tvdu = 0.0;
+  }
+
+  if(options.calcMix){
+    ctx->SumProb = allocReal2D(auxsize, auxsize);
+    if(!ctx->SumProb)
+      return 5;
+  }
+
+  if(options.fusedStats){
+    ctx->RowSums = (double (*)[6])malloc(auxsize*sizeof(*ctx->RowSums));
+    if(!ctx->RowSums)
+      return 5;
+  }
+
+  return 0;
+}
+
+
+
+void freeContext2D(qw2d_context *ctx){
+  const int MAX = ctx->options.max;
+  const int auxsize = (ctx->options.lattType == CYCLE_LATT) ? MAX : 2*MAX+1;
+
+  freeTensor4D(&ctx->A);
+  freeTensor4D(&ctx->Atemp);
+  freeStateTemplate2D(&ctx->initial);
+  if(ctx->C)
+    freeComplex4D(ctx->C, 2, 2, 2);
+  freeBrokenLink(&ctx->BLinks);
+  freeBrokenLink(&ctx->BLinksPerm);
+  if(ctx->AverageProb)
+    freeReal2D(ctx->AverageProb, auxsize);
+  if(ctx->StatProb)
+    freeReal2D(ctx->StatProb, auxsize);
+  if(ctx->SumProb)
+    freeReal2D(ctx->SumProb, auxsize);
+  free(ctx->RowSums);
+  free(ctx->vStat);
+  free(ctx->screen.values);
+
+  ctx->C = NULL;
+  ctx->AverageProb = ctx->StatProb = ctx->SumProb = NULL;
+  ctx->RowSums = NULL;
+  ctx->vStat = NULL;
+  ctx->screen.values = NULL;
+
+  return;
+}
+
+
+
+/* Sets the broken links L back to the permanent topology of the context,
+ * or closes all of them if there are no permanent broken links.
+ */
+static void resetBrokenLink2D(qw2d_context *ctx, blinks_t L){
+
+  if(ctx->options.blType == PERMANENT_BROKENLINKS)
+    copyBrokenLink(L, ctx->BLinksPerm);
+  else
+    closeBrokenLink(L);
+
+  return;
+}
+
+
+
+/* The observables are computed by iterate2D (see observables2D_t) if
+ * the user asked for it, except in the cyclic lattice and when the 
+ * state is measured after the evolution.
+ */
+static int fusedObservables2D(options2D_t opts){
+  return opts.fusedStats && opts.lattType != CYCLE_LATT && 
+    !opts.detectors && opts.dtProb <= 0.0;
+}
+
+
+
+/* Sum of the entries of the approximate stationary distribution (see
+ * the field StatTotal of observables2D_t), or zero if the mixing time
+ * is not calculated.
+ */
+static double stationaryTotal2D(qw2d_context *ctx){
+  int m, n;
+  double total = 0.0;
+  const int auxsize = 2*ctx->options.max+1;
+
+  if(!ctx->options.calcMix || !ctx->StatProb)
+    return 0.0;
+
+  for(m=0; m<auxsize; m++)
+    for(n=0; n<auxsize; n++)
+      total += ctx->StatProb[m][n];
+
+  return total;
+}
+
+
+
+/* Writes a checkpoint of the calculation of the stationary distribution
+ * (see checkedStationary2D) after step t. The arrays are the ones of
+ * stationarySteps2D. A checkpoint which cannot be written is reported,
+ * but the simulation goes on.
+ */
+static void saveStationaryCheckpoint2D(qw2d_context *ctx, double **sum,
+				       double **previous, int t, int check,
+				       int lastCheck, float error){
+  const int rbound = (ctx->options.lattType == CYCLE_LATT) ? 
+    ctx->options.max : 2*ctx->options.max+1;
+  checkheader_t header = ctx->check;
+  FILE *out;
+  int fail;
+
+  header.phase = CHECK_STATIONARY;
+  header.step = t;
+  header.mixCheck = check;
+  header.mixLastCheck = lastCheck;
+  header.mixError = error;
+
+  out = createCheckpoint(ctx->fnames.chk_file);
+  if(!out){
+    printf("Warning: could not write checkpoint file.\n");
+    return;
+  }
+
+  fail = writeBlock(out, &header, sizeof(checkheader_t)) ||
+    writeBlock(out, ctx->A.data, SIZE4D(ctx->A)*sizeof(double complex)) ||
+    writeReal2DBlock(out, sum, rbound, rbound) ||
+    (previous && writeReal2DBlock(out, previous, rbound, rbound));
+
+  if(closeCheckpoint(out, ctx->fnames.chk_file, fail))
+    printf("Warning: could not write checkpoint file.\n");
+
+  return;
+}
+
+
+
+/* Opens the snapshot file, if the keyword SNAPSHOT was used and it is
+ * not open yet. If resumeStep is not negative, the last experiment is
+ * resumed at this step (see openSnapshots2D).
+ */
+static void startSnapshots2D(qw2d_context *ctx, int resumeStep){
+
+  if(!ctx->options.snapEvery || ctx->snapWriter)
+    return;
+
+  ctx->snapWriter = openSnapshots2D(ctx->fnames.snap_file, ctx->options, 
+				    resumeStep);
+  if(!ctx->snapWriter){
+    printf("Error: could not write snapshot file %s.\n", ctx->fnames.snap_file);
+    exit(EXIT_FAILURE);
+  }
+
+  return;
+}
+
+
+
+/* Sends state A, after the given step of an experiment, to the snapshot
+ * file. Only the steps of the last experiment which are multiples of 
+ * snapEvery are written.
+ */
+static void takeSnapshot2D(qw2d_context *ctx, complex4D_t A, 
+			   options2D_t opts, int experiment, int step){
+
+  if(!ctx->snapWriter || experiment != opts.numOfExperiments ||
+     step % opts.snapEvery)
+    return;
+
+  if(sendSnapshot2D(ctx->snapWriter, A, opts, step)){
+    printf("Error: could not write snapshot file %s.\n", ctx->fnames.snap_file);
+    exit(EXIT_FAILURE);
+  }
+
+  return;
+}
+
+
+
+/* Writes a checkpoint of the experiments: the stationary distribution,
+ * the statistics and the probabilities accumulated so far, and the 
+ * screen. If step is positive the experiment is in progress, and the
+ * state, the stream of random numbers rng, the support and the sums of
+ * the mixing time of this experiment are also saved. Otherwise the 
+ * simulation continues with the beginning of the experiment.
+ */
+static void saveExperimentCheckpoint2D(qw2d_context *ctx, int experiment,
+				       int step, int steps, const rng_t *rng){
+  const options2D_t options = ctx->options;
+  const int auxsize = (options.lattType == CYCLE_LATT) ? 
+    options.max : 2*options.max+1;
+  checkheader_t header = ctx->check;
+  FILE *out;
+  int fail;
+
+  header.phase = CHECK_EXPERIMENTS;
+  header.experiment = experiment;
+  header.step = step;
+  header.steps = steps;
+  header.stepsMix = options.stepsMix;
+  header.mixError = options.mixError;
+  header.hasAverage = (ctx->AverageProb != NULL);
+
+  /* The frames of the last experiment must be in the snapshot file 
+   * before the checkpoint that continues it.
+   */
+  if(ctx->snapWriter && experiment == options.numOfExperiments &&
+     flushWriter(ctx->snapWriter)){
+    printf("Error: could not write snapshot file %s.\n", ctx->fnames.snap_file);
+    exit(EXIT_FAILURE);
+  }
+
+  out = createCheckpoint(ctx->fnames.chk_file);
+  if(!out){
+    printf("Warning: could not write checkpoint file.\n");
+    return;
+  }
+
+  fail = writeBlock(out, &header, sizeof(checkheader_t)) ||
+    (options.calcMix && writeReal2DBlock(out, ctx->StatProb, auxsize, auxsize)) ||
+    writeBlock(out, ctx->vStat+1, options.steps*sizeof(statistics_t)) ||
+    (header.hasAverage && writeReal2DBlock(out, ctx->AverageProb, auxsize, auxsize)) ||
+    (options.screen && writeBlock(out, ctx->screen.values, 
+				  ctx->screen.numpts*sizeof(double)));
+
+  if(!fail && step > 0)
+    fail = writeBlock(out, rng, sizeof(rng_t)) ||
+      writeBlock(out, &options.support, sizeof(support2D_t)) ||
+      writeBlock(out, ctx->A.data, SIZE4D(ctx->A)*sizeof(double complex)) ||
+      (options.calcMix && writeReal2DBlock(out, ctx->SumProb, auxsize, auxsize));
+
+  if(closeCheckpoint(out, ctx->fnames.chk_file, fail))
+    printf("Warning: could not write checkpoint file.\n");
+
+  return;
+}
+
+
+
+/* Reads a checkpoint of the experiments (see saveExperimentCheckpoint2D)
+ * into the context, and the stream of random numbers of the experiment
+ * in progress into rng. The statistics already written by the 
+ * interrupted simulation are written again. Returns 1 if the checkpoint
+ * cannot be read, and 0 otherwise.
+ */
+static int readExperimentCheckpoint2D(qw2d_context *ctx, FILE *in, 
+				      const checkheader_t *header, rng_t *rng){
+  const options2D_t options = ctx->options;
+  const int auxsize = (options.lattType == CYCLE_LATT) ? 
+    options.max : 2*options.max+1;
+  int k;
+
+  if(options.calcMix){
+    if(!ctx->StatProb)
+      ctx->StatProb = allocReal2D(auxsize, auxsize);
+    if(!ctx->StatProb || readReal2DBlock(in, ctx->StatProb, auxsize, auxsize))
+      return 1;
+    ctx->options.stepsMix = header->stepsMix;
+    ctx->options.mixError = header->mixError;
+  }
+
+  if(readBlock(in, ctx->vStat+1, options.steps*sizeof(statistics_t)))
+    return 1;
+
+  if(header->hasAverage){
+    ctx->AverageProb = allocReal2D(auxsize, auxsize);
+    if(!ctx->AverageProb || 
+       readReal2DBlock(in, ctx->AverageProb, auxsize, auxsize))
+      return 1;
+  }
+
+  if(options.screen && readBlock(in, ctx->screen.values, 
+				 ctx->screen.numpts*sizeof(double)))
+    return 1;
+
+  if(header->step > 0){
+    if(!ctx->A.data)
+      ctx->A = allocState2D(options.max, options.lattType, options.layout);
+    if(!ctx->A.data ||
+       readBlock(in, rng, sizeof(rng_t)) ||
+       readBlock(in, &ctx->options.support, sizeof(support2D_t)) ||
+       readBlock(in, ctx->A.data, SIZE4D(ctx->A)*sizeof(double complex)) ||
+       (options.calcMix && readReal2DBlock(in, ctx->SumProb, auxsize, auxsize)))
+      return 1;
+  }
+
+  /* The statistics are written during the last experiment */
+  if(header->experiment == options.numOfExperiments)
+    for(k=1; k<=header->step; k++)
+      if(STATSTEP(k, options.statEvery, options.steps) &&
+	 writeStep2D(ctx, k))
+	return 1;
+
+  return 0;
+}
+
+
+
+/* Sets *A to the initial state of an experiment, copied from the
+ * template of the context (see initContext2D). If the array was not
+ * allocated yet, it is allocated here. Otherwise, steps is the number
+ * of steps of the state it holds, or -1 if it is not known (see
+ * copyStateTemplate2D), so that only the region reached by the walker
+ * is cleaned.
+ */
+static void startState2D(qw2d_context *ctx, complex4D_t *A, 
+			 options2D_t opts, int steps){
+
+  if(!A->data){
+    *A = allocState2D(opts.max, opts.lattType, opts.layout);
+    if(!A->data){
+      printf("Error: could not allocate initial state.\n");
+      exit(EXIT_FAILURE);
+    }
+    steps = 0;
+  }
+  copyStateTemplate2D(*A, &ctx->initial, opts, steps);
+
+  return;
+}
+
+
+
+/* Runs the experiments one after the other, using the arrays of the
+ * context. Each experiment has its own stream of random numbers, as in
+ * the parallel version, so both give the same results. If resume is
+ * not NULL, the simulation continues from the checkpoint with this 
+ * header (see readExperimentCheckpoint2D), and rng is the stream of 
+ * the experiment in progress.
+ */
+static void runSerialExperiments2D(qw2d_context *ctx, 
+				   const checkheader_t *resume, 
+				   const rng_t *resumeRng){
+  int experiment, error, sinceCheck = 0;
+  const int MAX = ctx->options.max;
+  const int auxsize = (ctx->options.lattType == CYCLE_LATT) ? MAX : 2*MAX+1;
+  options2D_t options = ctx->options;
+  const int fused = fusedObservables2D(options);
+  observables2D_t obs;
+  int evolved = -1;   /* steps of the state in ctx->A, if known */
+
+  obs.RowSums = ctx->RowSums;
+  obs.SumProb = ctx->SumProb;
+  obs.StatProb = NULL;
+  obs.StatTotal = fused ? stationaryTotal2D(ctx) : 0.0;
+  obs.screen = options.screen ? &ctx->screen : NULL;
+
+  for(experiment = resume ? resume->experiment : 1; 
+      experiment <= options.numOfExperiments; experiment++){
+    int steps, t;
+    rng_t rng;
+
+    if(resume && experiment == resume->experiment && resume->step > 0){
+      /* The state was read from the checkpoint */
+      printf("Resuming experiment %d of %d at step %d...\n", 
+	     experiment, options.numOfExperiments, resume->step);
+      rng = *resumeRng;
+      options.support = ctx->options.support;
+      steps = resume->steps;
+      t = resume->step;
+    }
+    else{
+      printf("Starting experiment %d of %d...\n", 
+	     experiment, options.numOfExperiments);
+
+      initRandom(&rng, options.seed, experiment);
+      startState2D(ctx, &ctx->A, options, evolved);
+      options.support = ctx->initial.support;
+      ctx->options.support = options.support;
+
+      if(options.calcMix)
+	cleanReal2D(ctx->SumProb, auxsize, auxsize);
+
+      steps = options.steps;
+      t = 0;
+      takeSnapshot2D(ctx, ctx->A, options, experiment, 0);
+    }
+
+    /********************************
+     * Performing a full simulation *
+     ********************************/
+    for(; t<steps; t++){
+      
+      if((options.blProbA > 0.0) || (options.blProbB > 0.0)){
+	/* If the user requested simulation of random broken links we enter here at 
+	 * every step. We start from the permanent broken links (or from all the
+	 * links closed, if there are none)...
+	 */
+	resetBrokenLink2D(ctx, ctx->BLinks);
+	/* ...and then we break the random broken links.
+	 */
+	randomBrokenLink2D(ctx->BLinks, options, &rng);
+		
+      }
+
+      check2D(ctx->A, options, t);
+      if(options.calcMix && STATSTEP(t+1, options.statEvery, options.steps))
+	obs.StatProb = ctx->StatProb;
+      else
+	obs.StatProb = NULL;
+      iterate2D(&ctx->A, &ctx->Atemp, ctx->C, ctx->BLinks, options, t,
+		fused ? &obs : NULL);
+
+      if(options.detectors){
+	/* If the user requested the simulation of a detector, we enter here
+	 */
+	int result;
+
+	result = measureState2D(&ctx->A, options, t+1, &rng);
+	if(result < 0){
+	  printf("Error: could not measure state.");
+	  exit(EXIT_FAILURE);
+	}
+	else if(result>0) /* non-trivial result */
+	  steps = t+options.stepsAfterMeasure; /* we run some additional steps */
+      }
+
+      if(fused){
+	/* The statistics and the screen were computed by iterate2D */
+	if(STATSTEP(t+1, options.statEvery, options.steps))
+	  saveStatistics2D(ctx, getStatisticsFromObservables2D(obs, options, 
+							       t+1),
+			   t+1, experiment);
+      }
+      else if(options.dtProb>0 && !options.calcMix){
+	/* The random measurements visit every site of the support, so they
+	 * also give us the statistics of this step (see randMeasure2D).
+	 */
+	statistics_t stat;
+	const int sample = STATSTEP(t+1, options.statEvery, options.steps);
+
+	if(randMeasure2D(&ctx->A, options, t+1, &rng, sample ? &stat : NULL)){
+	  printf("Error: could not measure state.\n");
+	  exit(EXIT_FAILURE);
+	}
+	if(sample)
+	  saveStatistics2D(ctx, stat, t+1, experiment);
+      }
+      else{
+	if(options.dtProb>0 && randMeasure2D(&ctx->A, options, t+1, &rng, NULL)){
+	  printf("Error: could not measure state.\n");
+	  exit(EXIT_FAILURE);
+	}
+
+	/* Now we calculate expectation, variance, standard deviation, etc, 
+	 * and save in a file.
+	 */
+	doStatistics2D(ctx, t+1, experiment);
+      }
+
+      if(options.screen && !fused){
+	/* If the user requested an observation screen, then we do it here */
+	error = updateScreen(&ctx->screen, ctx->A, MAX);
+	if(error){
+	  printf("Error: could not update screen.\n");
+	  exit(EXIT_FAILURE);
+	}
+      }
+
+      takeSnapshot2D(ctx, ctx->A, options, experiment, t+1);
+
+      if(options.checkEvery && ++sinceCheck == options.checkEvery){
+	saveExperimentCheckpoint2D(ctx, experiment, t+1, steps, &rng);
+	sinceCheck = 0;
+      }
+
+    }/* End-for t */
+
+    /* Here we take the probability distribution obtained after of one experiment
+     * and accumulate it to obtain, at the end, an average probability distribution
+     * (which should not be confused with the average distribution used to define
+     * the stationary distribution of a quantum Markov chain)
+     */
+    error = averageProbFromState2D(&ctx->AverageProb, ctx->A, options, t);
+    if(error){
+      printf("Error: could not update average probability matrix.\n");
+      exit(EXIT_FAILURE);
+    }
+    ctx->steps = evolved = t;
+
+  }/* End-for experiments */
+
+  return;
+}
+
+
+
+/* Runs the experiments at the same time, in options.expThreads threads
+ * (see keyword EXPTHREADS). Each experiment has its own state, broken 
+ * links and stream of random numbers, obtained from the seed and from
+ * the number of the experiment. The statistics, the average 
+ * probabilities and the screen are accumulated in the context in the
+ * order of the experiments, so the results do not depend on the number
+ * of threads. The final state of the last experiment is left in ctx->A.
+ * The checkpoints are written between experiments, and the simulation
+ * may only be resumed at the beginning of the experiment first.
+ */
+static void runParallelExperiments2D(qw2d_context *ctx, int first){
+  int experiment, sinceCheck = 0;
+  const options2D_t options = ctx->options;
+  const int MAX = options.max;
+  const int auxsize = (options.lattType == CYCLE_LATT) ? MAX : 2*MAX+1;
+  const int randomLinks = (options.blProbA > 0.0) || (options.blProbB > 0.0);
+  const int fused = fusedObservables2D(options);
+
+  /* See the "ordered" construction below */
+#pragma omp parallel num_threads(options.expThreads)
+  {
+    blinks_t BLinks = {NULL, 0, 0, 0};
+    complex4D_t Anew, Atemp;
+    double **SumProb = NULL;
+    statistics_t *stats;
+    screen_t local;
+    observables2D_t obs;
+    int error, evolved = -1;
+
+    error = initBrokenLink2D(&BLinks, MAX, options.lattType);
+    if(error){
+      printf("Error: could not initialize all links closed.\n");
+      exit(EXIT_FAILURE);
+    }
+    resetBrokenLink2D(ctx, BLinks);
+
+    Atemp = allocState2D(MAX, options.lattType, options.layout);
+    if(!Atemp.data){
+      printf("Error: could not allocate memory for temporary matrix.\n");
+      exit(EXIT_FAILURE);
+    }
+    Anew.data = NULL;
+    Anew.block = NULL;
+
+    stats = (statistics_t *)malloc((options.steps+1)*sizeof(statistics_t));
+    if(options.calcMix)
+      SumProb = allocReal2D(auxsize, auxsize);
+    if(!stats || (options.calcMix && !SumProb)){
+      printf("Error: could not allocate memory for statistics.\n");
+      exit(EXIT_FAILURE);
+    }
+
+    local.values = NULL;
+    if(options.screen){
+      error = initScreen(&local, options.screen_pta[0], options.screen_pta[1], 
+			 options.screen_ptb[0], options.screen_ptb[1]);
+      if(error){
+	printf("Error: could not initialize screen detector.\n");
+	exit(EXIT_FAILURE);
+      }
+    }
+
+    obs.RowSums = NULL;
+    obs.SumProb = SumProb;
+    obs.StatProb = NULL;
+    obs.StatTotal = fused ? stationaryTotal2D(ctx) : 0.0;
+    obs.screen = options.screen ? &local : NULL;
+    if(fused){
+      obs.RowSums = (double (*)[6])malloc(auxsize*sizeof(*obs.RowSums));
+      if(!obs.RowSums){
+	printf("Error: could not allocate memory for statistics.\n");
+	exit(EXIT_FAILURE);
+      }
+    }
+
+#pragma omp for schedule(static,1) ordered
+    for(experiment=first; experiment <= options.numOfExperiments; experiment++){
+      options2D_t opts = options;
+      rng_t rng;
+      int steps, t, k, sample;
+
+      printf("Starting experiment %d of %d...\n", 
+	     experiment, options.numOfExperiments);
+
+      /* The evolution itself is not split among threads here */
+      opts.threads = 1;
+      initRandom(&rng, options.seed, experiment);
+
+      startState2D(ctx, &Anew, opts, evolved);
+      opts.support = ctx->initial.support;
+
+      if(opts.calcMix)
+	cleanReal2D(SumProb, auxsize, auxsize);
+      for(k=0; options.screen && k<local.numpts; k++)
+	local.values[k] = 0.0;
+
+      steps = opts.steps;
+      takeSnapshot2D(ctx, Anew, opts, experiment, 0);
+      for(t=0; t<steps; t++){
+
+	if(randomLinks){
+	  resetBrokenLink2D(ctx, BLinks);
+	  randomBrokenLink2D(BLinks, opts, &rng);
+	}
+
+	check2D(Anew, opts, t);
+	obs.StatProb = (opts.calcMix && STATSTEP(t+1, opts.statEvery, opts.steps)) ?
+	  ctx->StatProb : NULL;
+	iterate2D(&Anew, &Atemp, ctx->C, BLinks, opts, t, fused ? &obs : NULL);
+
+	if(opts.detectors){
+	  int result;
+
+	  result = measureState2D(&Anew, opts, t+1, &rng);
+	  if(result < 0){
+	    printf("Error: could not measure state.");
+	    exit(EXIT_FAILURE);
+	  }
+	  else if(result>0) /* non-trivial result */
+	    steps = t+opts.stepsAfterMeasure; /* we run some additional steps */
+	}
+
+	if(t+1 > opts.steps){
+	  printf("Error: unexpected number of steps when calculating statistics.\n");
+	  exit(EXIT_FAILURE);
+	}
+
+	sample = STATSTEP(t+1, opts.statEvery, opts.steps);
+	if(opts.dtProb>0){
+	  /* See runSerialExperiments2D */
+	  if(randMeasure2D(&Anew, opts, t+1, &rng, 
+			   (opts.calcMix || !sample) ? NULL : &stats[t+1])){
+	    printf("Error: could not measure state.\n");
+	    exit(EXIT_FAILURE);
+	  }
+	}
+	if(!sample){
+	  /* See doStatistics2D */
+	  if(opts.calcMix && !fused)
+	    addProbFromState2D(SumProb, Anew, opts, t+1);
+	}
+	else if(fused)
+	  stats[t+1] = getStatisticsFromObservables2D(obs, opts, t+1);
+	else if(opts.dtProb<=0 || opts.calcMix)
+	  stats[t+1] = getStatisticsFromState2D(Anew, ctx->StatProb, SumProb, 
+						opts, t+1);
+	if(sample && stats[t+1].iteration<0){
+	  printf("Error: could not generate statistics.\n");
+	  exit(EXIT_FAILURE);
+	}
+
+	if(opts.screen && !fused){
+	  error = updateScreen(&local, Anew, MAX);
+	  if(error){
+	    printf("Error: could not update screen.\n");
+	    exit(EXIT_FAILURE);
+	  }
+	}
+
+	takeSnapshot2D(ctx, Anew, opts, experiment, t+1);
+
+      }/* End-for t */
+      evolved = t;
+
+      /* The results are accumulated one experiment at a time, in order */
+#pragma omp ordered
+      {
+	for(k=1; k<=t; k++)
+	  if(STATSTEP(k, options.statEvery, options.steps))
+	    saveStatistics2D(ctx, stats[k], k, experiment);
+
+	error = averageProbFromState2D(&ctx->AverageProb, Anew, opts, t);
+	if(error){
+	  printf("Error: could not update average probability matrix.\n");
+	  exit(EXIT_FAILURE);
+	}
+
+	for(k=0; options.screen && k<local.numpts; k++)
+	  ctx->screen.values[k] += local.values[k];
+
+	if(experiment == options.numOfExperiments){
+	  /* The state of the last experiment is kept in the context */
+	  const complex4D_t aux = ctx->A;
+
+	  ctx->A = Anew;
+	  Anew = aux;
+	  evolved = -1;
+	  ctx->options.support = opts.support;
+	  ctx->steps = t;
+	}
+
+	sinceCheck += t;
+	if(options.checkEvery && sinceCheck >= options.checkEvery &&
+	   experiment < options.numOfExperiments){
+	  saveExperimentCheckpoint2D(ctx, experiment+1, 0, 0, NULL);
+	  sinceCheck = 0;
+	}
+      }
+
+    }/* End-for experiments */
+
+    freeTensor4D(&Anew);
+    freeTensor4D(&Atemp);
+    freeBrokenLink(&BLinks);
+    free(stats);
+    free(obs.RowSums);
+    if(options.calcMix)
+      freeReal2D(SumProb, auxsize);
+    free(local.values);
+  }/* End of parallel region */
+
+  return;
+}
+
+
+
+/* Reports the number of steps used to obtain the stationary 
+ * distribution with a tolerance (see MIXTOL).
+ */
+static void reportStationary2D(options2D_t opts){
+
+  if(opts.mixError >= 0.0)
+    printf("Stationary distribution obtained with %d steps (L1 change %e).\n",
+	   opts.stepsMix, opts.mixError);
+  else
+    printf("Stationary distribution obtained with %d steps (no checkpoint reached).\n",
+	   opts.stepsMix);
+
+  return;
+}
+
+
+
+/* A coherent walk (without random broken links, measurements or 
+ * detectors) is the same in every experiment, and its evolution is the
+ * one used to obtain the stationary distribution. With a single 
+ * experiment both are obtained from the same evolution (see 
+ * runMixedExperiment2D).
+ */
+static int mergedMix2D(options2D_t opts){
+  return opts.calcMix && opts.numOfExperiments == 1 && 
+    opts.blProbA <= 0.0 && opts.blProbB <= 0.0 && 
+    opts.dtProb <= 0.0 && !opts.detectors;
+}
+
+
+
+/* Copies the entries of SumProb in the support of the walker after the
+ * given number of steps to sums (toSums nonzero), or back to SumProb.
+ * Returns the number of entries copied.
+ */
+static size_t copySupportSums2D(double **SumProb, double *sums, 
+				options2D_t opts, int steps, int toSums){
+  const support2D_t supp = getSupport2D(opts, steps);
+  const int auxsize = (opts.lattType == CYCLE_LATT) ? opts.max : 2*opts.max+1;
+  int rows[2][2], cols[2][2], nrows, ncols, ir, ic, m, n;
+  size_t i = 0;
+
+  nrows = getSupportRanges(supp.lo[0], supp.len[0], auxsize, rows);
+  ncols = getSupportRanges(supp.lo[1], supp.len[1], auxsize, cols);
+  for(ir=0; ir<nrows; ir++)
+    for(m=rows[ir][0]; m<rows[ir][1]; m++)
+      for(ic=0; ic<ncols; ic++)
+	for(n=cols[ic][0]; n<cols[ic][1]; n++, i++){
+	  if(toSums)
+	    sums[i] = SumProb[m][n];
+	  else
+	    SumProb[m][n] = sums[i];
+	}
+
+  return i;
+}
+
+
+
+/* Runs the only experiment of a coherent walk and obtains the stationary
+ * distribution from the same evolution, of MAXIMUM(steps, stepsMix) 
+ * steps (or less, see MIXTOL). The sums SumProb of the first steps are
+ * the ones of the experiment. The distances to the stationary 
+ * distribution are only known at the end, so the sums of the steps 
+ * written are kept (in the support of the walker) and the statistics 
+ * are written afterwards; the results are the same as in 
+ * getStationary2D and runSerialExperiments2D. The function returns 0 on
+ * success, or 1 if there is not enough memory for the sums, in which 
+ * case nothing was computed.
+ */
+static int runMixedExperiment2D(qw2d_context *ctx){
+  int t, k, error, check, lastCheck;
+  const options2D_t options = ctx->options;
+  const int steps = options.steps;
+  const int MAX = options.max;
+  const int auxsize = (options.lattType == CYCLE_LATT) ? MAX : 2*MAX+1;
+  const int fused = fusedObservables2D(options);
+  options2D_t noMix;
+  statistics_t *stats;
+  size_t *offset, total;
+  double *sums, **previous = NULL;
+  complex4D_t Aend = {NULL, NULL, {0,0,0,0}, {0,0,0,0}};
+  observables2D_t obs;
+
+  startState2D(ctx, &ctx->A, options, -1);
+  ctx->options.support = ctx->initial.support;
+  noMix = ctx->options;
+  noMix.calcMix = 0;
+
+  /* Where the sums of each step written are kept */
+  offset = (size_t *)malloc((steps+1)*sizeof(size_t));
+  if(!offset)
+    return 1;
+  total = 0;
+  for(k=1; k<=steps; k++){
+    const support2D_t supp = getSupport2D(noMix, k);
+
+    offset[k] = total;
+    if(STATSTEP(k, options.statEvery, steps))
+      total += (size_t)supp.len[0]*supp.len[1];
+  }
+  if(total*sizeof(double) > MIXMERGE_MAXMEM){
+    free(offset);
+    return 1;
+  }
+
+  stats = (statistics_t *)malloc((steps+1)*sizeof(statistics_t));
+  sums = (double *)malloc(total*sizeof(double));
+  if(options.mixTol > 0.0)
+    previous = allocReal2D(auxsize, auxsize);
+  if(options.stepsMix > steps)
+    Aend = allocState2D(MAX, options.lattType, options.layout);
+  if(!stats || !sums || (options.mixTol > 0.0 && !previous) ||
+     (options.stepsMix > steps && !Aend.data)){
+    free(offset);
+    free(stats);
+    free(sums);
+    if(previous)
+      freeReal2D(previous, auxsize);
+    freeTensor4D(&Aend);
+    return 1;
+  }
+
+  printf("Starting experiment 1 of 1, together with the stationary distribution...\n");
+  startSnapshots2D(ctx, -1);
+  takeSnapshot2D(ctx, ctx->A, noMix, 1, 0);
+
+  obs.RowSums = ctx->RowSums;
+  obs.SumProb = ctx->SumProb;
+  obs.StatProb = NULL;
+  obs.StatTotal = 0.0;
+  obs.screen = options.screen ? &ctx->screen : NULL;
+
+  cleanReal2D(ctx->SumProb, auxsize, auxsize);
+  check = auxsize;
+  lastCheck = 0;
+  ctx->options.mixError = -1.0;
+
+  for(t=0; t<steps || !ctx->StatProb; t++){
+
+    /* After the experiment only the sums are needed */
+    if(t == steps)
+      obs.screen = NULL;
+
+    if(t < steps)
+      check2D(ctx->A, noMix, t);
+    iterate2D(&ctx->A, &ctx->Atemp, ctx->C, ctx->BLinks, noMix, t,
+	      fused ? &obs : NULL);
+    if(!fused)
+      addProbFromState2D(ctx->SumProb, ctx->A, noMix, t+1);
+
+    if(t < steps){
+      if(STATSTEP(t+1, options.statEvery, steps)){
+	stats[t+1] = fused ? 
+	  getStatisticsFromObservables2D(obs, noMix, t+1) :
+	  getStatisticsFromState2D(ctx->A, NULL, NULL, noMix, t+1);
+	if(stats[t+1].iteration<0){
+	  printf("Error: could not generate statistics.\n");
+	  exit(EXIT_FAILURE);
+	}
+	copySupportSums2D(ctx->SumProb, sums + offset[t+1], noMix, t+1, 1);
+      }
+
+      if(options.screen && !fused){
+	error = updateScreen(&ctx->screen, ctx->A, MAX);
+	if(error){
+	  printf("Error: could not update screen.\n");
+	  exit(EXIT_FAILURE);
+	}
+      }
+
+      takeSnapshot2D(ctx, ctx->A, noMix, 1, t+1);
+
+      if(t+1 == steps){
+	error = averageProbFromState2D(&ctx->AverageProb, ctx->A, noMix, steps);
+	if(error){
+	  printf("Error: could not update average probability matrix.\n");
+	  exit(EXIT_FAILURE);
+	}
+	ctx->steps = steps;
+	if(Aend.data)
+	  copyTensor4D(Aend, ctx->A);
+      }
+    }
+
+    /* The stationary distribution, as in getStationary2D */
+    if(!ctx->StatProb &&
+       ((previous && t+1 == check && 
+	 mixCheckpoint2D(ctx->SumProb, previous, auxsize, t+1, &check, 
+			 &lastCheck, &ctx->options.mixError, options.mixTol)) ||
+	t+1 == options.stepsMix)){
+      int m, n;
+
+      ctx->StatProb = allocReal2D(auxsize, auxsize);
+      if(!ctx->StatProb){
+	printf("Error: could not obtain (approximate) stationary distribution.\n");
+	exit(EXIT_FAILURE);
+      }
+      for(m=0; m<auxsize; m++)
+	for(n=0; n<auxsize; n++)
+	  ctx->StatProb[m][n] = ctx->SumProb[m][n]/(t+1);
+      if(!checkProb2D(ctx->StatProb, MAX, options.lattType)){
+	printf("Error: could not obtain (approximate) stationary distribution.\n");
+	exit(EXIT_FAILURE);
+      }
+      ctx->options.stepsMix = t+1;
+    }
+
+  }/* End-for t */
+
+  /* The final state of the experiment */
+  if(Aend.data){
+    const complex4D_t aux = ctx->A;
+
+    ctx->A = Aend;
+    Aend = aux;
+  }
+
+  /* Now the distances to the stationary distribution */
+  for(k=1; k<=steps; k++){
+    if(!STATSTEP(k, options.statEvery, steps))
+      continue;
+
+    cleanReal2D(ctx->SumProb, auxsize, auxsize);
+    copySupportSums2D(ctx->SumProb, sums + offset[k], noMix, k, 0);
+    getDistancesFromSumProb2D(&stats[k], ctx->StatProb, ctx->SumProb, 
+			      noMix, k);
+    saveStatistics2D(ctx, stats[k], k, 1);
+  }
+
+  free(offset);
+  free(stats);
+  free(sums);
+  if(previous)
+    freeReal2D(previous, auxsize);
+  freeTensor4D(&Aend);
+
+  return 0;
+}
+
+
+
+/* Calculates the stationary distribution as getStationary2D, using the
+ * states of the context, and saves a checkpoint every 
+ * options.checkEvery steps. If in is not NULL, the calculation 
+ * continues from the checkpoint whose header was read from it. The 
+ * number of steps used and the last distance between the checkpoints
+ * of MIXTOL are stored in the options of the context.
+ */
+static double **checkedStationary2D(qw2d_context *ctx, FILE *in, 
+				    const checkheader_t *header){
+  const options2D_t options = ctx->options;
+  const int rbound = (options.lattType == CYCLE_LATT) ? 
+    options.max : 2*options.max+1;
+  double **sum, **previous = NULL;
+  int m, n, t, check, lastCheck, done;
+  float error;
+
+  sum = allocReal2D(rbound, rbound);
+  if(!sum)
+    return NULL;
+  if(options.mixTol > 0.0){
+    previous = allocReal2D(rbound, rbound);
+    if(!previous)
+      return NULL;
+  }
+
+  if(in){
+    t = header->step;
+    check = header->mixCheck;
+    lastCheck = header->mixLastCheck;
+    error = header->mixError;
+    if(readBlock(in, ctx->A.data, SIZE4D(ctx->A)*sizeof(double complex)) ||
+       readReal2DBlock(in, sum, rbound, rbound) ||
+       (previous && readReal2DBlock(in, previous, rbound, rbound))){
+      printf("Error: could not read checkpoint file.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+  else{
+    cleanReal2D(sum, rbound, rbound);
+    t = 0;
+    check = rbound;
+    lastCheck = 0;
+    error = -1.0;
+  }
+
+  done = 0;
+  while(!done && t < options.stepsMix){
+    done = stationarySteps2D(&ctx->A, &ctx->Atemp, ctx->C, ctx->BLinks, 
+			     options, sum, previous, &t, 
+			     MINIMUM(t+options.checkEvery, options.stepsMix),
+			     &check, &lastCheck, &error);
+    if(!done && t < options.stepsMix)
+      saveStationaryCheckpoint2D(ctx, sum, previous, t, check, lastCheck, 
+				 error);
+  }
+  ctx->options.stepsMix = t;
+  ctx->options.mixError = error;
+
+  if(previous)
+    freeReal2D(previous, rbound);
+
+  for(m=0; m<rbound; m++)
+    for(n=0; n<rbound; n++)
+      sum[m][n] /= t;
+
+  if(!checkProb2D(sum, options.max, options.lattType))
+    return NULL;
+
+  return sum;
+}
+
+
+
+/* Runs the simulation of simulate2D: the stationary distribution, if
+ * it was requested, and the experiments.
+ */
+static void runSimulation2D(qw2d_context *ctx){
+  const options2D_t options = ctx->options;
+  checkheader_t header;
+  FILE *in = NULL;
+  rng_t rng;
+  int resumed = 0;
+
+  /* The simulation continues from the checkpoint file, which must have
+   * been written by a simulation with the same input file.
+   */
+  if(options.resume){
+    in = openCheckpoint(ctx->fnames.chk_file, &header, 2);
+    if(!in || !sameSimulation(&header, &ctx->check)){
+      printf("Error: could not resume simulation from checkpoint file %s.\n",
+	     ctx->fnames.chk_file);
+      exit(EXIT_FAILURE);
+    }
+    printf("Resuming simulation from checkpoint file %s.\n", 
+	   ctx->fnames.chk_file);
+    ctx->options.seed = ctx->check.seed = header.seed;
+    resumed = 1;
+  }
+
+  /* If the user requested the calculation of mixing time, we need to
+   * calculate the approximate stationary distribution here.
+   */
+  if(options.calcMix && !(resumed && header.phase == CHECK_EXPERIMENTS)){
+    if(options.mixTol > 0.0)
+      printf("Calculating (approximate) stationary distribution with at most %d steps.\n",
+	     options.stepsMix);
+    else
+      printf("Calculating (approximate) stationary distribution with %d steps.\n",
+	     options.stepsMix);
+    if((options.blProbA > 0.0) || (options.blProbB > 0.0) || (options.dtProb > 0.0)){
+      printf("Warning: this version of qwalk should not be used to calculate or to plot\n");
+      printf("  the approximate stationary distribution for decoherent two-dimensional\n");
+      printf("  quantum walks (it is the uniform distribution, always).\n");
+    }
+    printf("This calculation may take a really long time...\n");
+    if(!options.checkEvery && mergedMix2D(options) && 
+       !runMixedExperiment2D(ctx)){
+      if(options.mixTol > 0.0)
+	reportStationary2D(ctx->options);
+      return;
+    }
+    startState2D(ctx, &ctx->A, options, -1);
+    ctx->options.support = ctx->initial.support;
+    if(options.checkEvery){
+      ctx->StatProb = checkedStationary2D(ctx, in, &header);
+      if(in){
+	fclose(in);
+	in = NULL;
+      }
+    }
+    else
+      ctx->StatProb = getStationary2D(ctx->A, ctx->C, ctx->BLinks, ctx->options,
+				      &ctx->options.stepsMix, &ctx->options.mixError);
+    if(!ctx->StatProb){
+      printf("Error: could not obtain (approximate) stationary distribution.\n");
+      exit(EXIT_FAILURE);
+    }
+    if(options.mixTol > 0.0)
+      reportStationary2D(ctx->options);
+    if(options.checkEvery)
+      saveExperimentCheckpoint2D(ctx, 1, 0, 0, NULL);
+  }
+
+  if(in){
+    if(readExperimentCheckpoint2D(ctx, in, &header, &rng)){
+      printf("Error: could not read checkpoint file.\n");
+      exit(EXIT_FAILURE);
+    }
+    fclose(in);
+    if(options.calcMix && options.mixTol > 0.0)
+      reportStationary2D(ctx->options);
+  }
+  else{
+    resumed = 0;
+    header.experiment = 1;
+    header.step = 0;
+  }
+
+  /* If the last experiment was interrupted, its first frames are 
+   * already in the snapshot file.
+   */
+  startSnapshots2D(ctx, (resumed && header.step > 0 &&
+			 header.experiment == options.numOfExperiments) ?
+		   header.step : -1);
+
+  /*********************************************
+   * Running the experiments                   *
+   *********************************************/
+  /* An experiment interrupted in the middle is finished by the serial
+   * version, which gives the same results.
+   */
+  if(options.expThreads && header.step == 0)
+    runParallelExperiments2D(ctx, header.experiment);
+  else
+    runSerialExperiments2D(ctx, resumed ? &header : NULL, &rng);
+
+  return;
+}
+
+
+
+void simulate2D(qw2d_context *ctx){
+  int error;
+
+  /* The statistics are written by a separate thread, so that the 
+   * experiments do not wait for the disk (see qwwriter.h).
+   */
+  if(!STREQ(ctx->fnames.sta_file, "")){
+    ctx->staWriter = openStatistics(ctx->fnames.sta_file);
+    if(!ctx->staWriter){
+      printf("Error: could not write statistics.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  runSimulation2D(ctx);
+
+  if(ctx->snapWriter){
+    error = closeWriter(ctx->snapWriter);
+    ctx->snapWriter = NULL;
+    if(error){
+      printf("Error: could not write snapshot file %s.\n", ctx->fnames.snap_file);
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  if(ctx->staWriter){
+    error = closeWriter(ctx->staWriter);
+    ctx->staWriter = NULL;
+    if(error){
+      printf("Error: could not write statistics.\n");
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  return;
+}
@@ -0,0 +1,167 @@
+/* QWalk (qwcheckpoint.c)
+ * Copyright (C) 2008  Franklin Marquezino
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include "qwcheckpoint.h"
+#include "qwconsts.h"
+
+
+/* Returns a newly allocated string with the name of the temporary file
+ * of a checkpoint, or NULL if there is not enough memory.
+ */
+static char *tempName(const char *filename){
+  char *name;
+
+  name = (char *)malloc(strlen(filename)+5);
+  if(!name)
+    return NULL;
+  strcpy(name, filename);
+  strcat(name, ".tmp");
+
+  return name;
+}
+
+
+
+FILE *createCheckpoint(const char *filename){
+  FILE *out;
+  char *name;
+
+  name = tempName(filename);
+  if(!name)
+    return NULL;
+
+  out = fopen(name, "wb");
+  free(name);
+
+  return out;
+}
+
+
+
+int closeCheckpoint(FILE *out, const char *filename, int error){
+  char *name;
+
+  if(fflush(out))
+    error = 1;
+  if(fclose(out))
+    error = 1;
+
+  name = tempName(filename);
+  if(!name)
+    return 1;
+
+  if(error){
+    remove(name);
+    free(name);
+    return 1;
+  }
+
+  /* Some systems do not replace an existing file with rename */
+  if(rename(name, filename)){
+    remove(filename);
+    if(rename(name, filename)){
+      free(name);
+      return 2;
+    }
+  }
+  free(name);
+
+  return 0;
+}
+
+
+
+FILE *openCheckpoint(const char *filename, checkheader_t *header,
+		     int dimension){
+  FILE *in;
+
+  in = fopen(filename, "rb");
+  if(!in)
+    return NULL;
+
+  if(fread(header, sizeof(checkheader_t), 1, in) != 1 ||
+     memcmp(header->magic, CHECK_MAGIC, sizeof(CHECK_MAGIC)) ||
+     header->version != CHECK_VERSION || header->dimension != dimension){
+    fclose(in);
+    return NULL;
+  }
+
+  return in;
+}
+
+
+
+int sameSimulation(const checkheader_t *a, const checkheader_t *b){
+
+  return a->dimension == b->dimension && a->max == b->max &&
+    a->lattType == b->lattType && a->layout == b->layout &&
+    a->coinType == b->coinType && a->stateType == b->stateType &&
+    a->numOfExperiments == b->numOfExperiments &&
+    a->optSteps == b->optSteps && a->optStepsMix == b->optStepsMix &&
+    a->statEvery == b->statEvery && a->calcMix == b->calcMix &&
+    a->blProb[0] == b->blProb[0] && a->blProb[1] == b->blProb[1] &&
+    a->dtProb == b->dtProb && a->mixTol == b->mixTol;
+}
+
+
+
+int writeBlock(FILE *out, const void *data, size_t bytes){
+
+  if(bytes && fwrite(data, 1, bytes, out) != bytes)
+    return 1;
+
+  return 0;
+}
+
+
+
+int readBlock(FILE *in, void *data, size_t bytes){
+
+  if(bytes && fread(data, 1, bytes, in) != bytes)
+    return 1;
+
+  return 0;
+}
+
+
+
+int writeReal2DBlock(FILE *out, double **data, int rows, int cols){
+  int m;
+
+  for(m=0; m<rows; m++)
+    if(writeBlock(out, data[m], cols*sizeof(double)))
+      return 1;
+
+  return 0;
+}
+
+
+
+int readReal2DBlock(FILE *in, double **data, int rows, int cols){
+  int m;
+
+  for(m=0; m<rows; m++)
+    if(readBlock(in, data[m], cols*sizeof(double)))
+      return 1;
+
+  return 0;
+}
@@ -26,25 +26,17 @@
 #include<time.h>
 #include "qwmem_complex.h"
 #include "qwcoin_io.h"
+#include "qwinput.h"
 #include "qwconsts.h"
 
 
-double complex **readCoinFile1D(const char *filename){
-  FILE *in;
+double complex **readCoin1D(const inputfile_t *input){
+  inputfile_t cursor = *input, *in = &cursor;
   double complex **coin;
   int j, k;
-  char keyword[100];
-
-  in = fopen(filename,"rt");
-  if(!in)
-    return NULL;
 
   /* First we search the BEGINCOIN keyword, ... */
-  do{
-    fscanf(in,"%s",keyword);
-  }while(STRNEQ(keyword,"BEGINCOIN") && !feof(in));
-
-  if(feof(in))
+  if(!findKeyword(in,"BEGINCOIN"))
     return NULL;
   
   coin = allocComplex2D(2, 2);
@@ -60,33 +52,37 @@ double complex **readCoinFile1D(const char *filename){
     for(k=0; k<2; k++){
       double real, imag;
 
-      fscanf(in,"%lf", &real);
-      fscanf(in,"%lf", &imag);
+      scanReal(in, &real);
+      scanReal(in, &imag);
       coin[j][k] = real+ I*imag;
     }
   }
 
-  fclose(in);
   return coin;
 }
 
 
-double complex ****readCoinFile2D(const char *filename){
-  FILE *in;
-  double complex ****coin;
-  int j, k;
-  char keyword[100];
+double complex **readCoinFile1D(const char *filename){
+  inputfile_t *in;
+  double complex **coin;
 
-  in = fopen(filename,"rt");
+  in = readInputFile(filename);
   if(!in)
     return NULL;
+  coin = readCoin1D(in);
+  freeInputFile(in);
+
+  return coin;
+}
 
-  /* First we search the BEGINCOIN keyword... */
-  do{
-    fscanf(in,"%s",keyword);
-  }while(STRNEQ(keyword,"BEGINCOIN") && !feof(in));
 
-  if(feof(in))
+double complex ****readCoin2D(const inputfile_t *input){
+  inputfile_t cursor = *input, *in = &cursor;
+  double complex ****coin;
+  int j, k;
+
+  /* First we search the BEGINCOIN keyword... */
+  if(!findKeyword(in,"BEGINCOIN"))
     return NULL;
   
   coin = allocComplex4D(2, 2, 2, 2);
@@ -106,8 +102,8 @@ double complex ****readCoinFile2D(const char *filename){
 	for(kprime=0; kprime<2; kprime++){
 	  double real, imag;
 
-	  fscanf(in,"%lf", &real);
-	  fscanf(in,"%lf", &imag);
+	  scanReal(in, &real);
+	  scanReal(in, &imag);
 	  coin[j][k][jprime][kprime] = real+ I*imag;
 	}
       }
@@ -116,3 +112,17 @@ double complex ****readCoinFile2D(const char *filename){
   
   return coin;
 }
+
+
+double complex ****readCoinFile2D(const char *filename){
+  inputfile_t *in;
+  double complex ****coin;
+
+  in = readInputFile(filename);
+  if(!in)
+    return NULL;
+  coin = readCoin2D(in);
+  freeInputFile(in);
+
+  return coin;
+}
@@ -35,7 +35,8 @@ filenames_t createFilenames1D(const char *input_filename, options1D_t options){
   changeFileEnding(&(fnames.dat_file), input_filename, ".dat");
 
   /* wave */
-  changeFileEnding(&(fnames.datwav_file), input_filename, "-wave.dat");
+  changeFileEnding(&(fnames.datwav_file), input_filename, 
+		   options.waveBinary ? "-wave.bin" : "-wave.dat");
 
   /* Stationary distribution, $\bar{P}$ */
   if(options.calcMix){
@@ -50,6 +51,15 @@ filenames_t createFilenames1D(const char *input_filename, options1D_t options){
   /* statistics */
   changeFileEnding(&(fnames.sta_file), input_filename, ".sta");
 
+  /* checkpoint */
+  if(options.checkEvery)
+    changeFileEnding(&(fnames.chk_file), input_filename, "-check.bin");
+  else
+    fnames.chk_file = "";
+
+  /* snapshots are only taken in 2D simulations */
+  fnames.snap_file = "";
+
   /* plot */
   changeFileEnding(&(fnames.eps2d_file), input_filename, ".eps");
 
@@ -72,7 +82,8 @@ filenames_t createFilenames2D(const char *input_filename, options2D_t options){
   changeFileEnding(&(fnames.dat_file), input_filename, ".dat");
 
   /* wave */
-  changeFileEnding(&(fnames.datwav_file), input_filename, "-wave.dat");
+  changeFileEnding(&(fnames.datwav_file), input_filename, 
+		   options.waveBinary ? "-wave.bin" : "-wave.dat");
 
   /* Stationary distribution, $\bar{P}$ */
   if(options.calcMix){
@@ -98,6 +109,18 @@ filenames_t createFilenames2D(const char *input_filename, options2D_t options){
   /* statistics */
   changeFileEnding(&(fnames.sta_file), input_filename, ".sta");
 
+  /* checkpoint */
+  if(options.checkEvery)
+    changeFileEnding(&(fnames.chk_file), input_filename, "-check.bin");
+  else
+    fnames.chk_file = "";
+
+  /* snapshots */
+  if(options.snapEvery)
+    changeFileEnding(&(fnames.snap_file), input_filename, "-snap.bin");
+  else
+    fnames.snap_file = "";
+
   /* 3D plot */
   changeFileEnding(&(fnames.eps3d_file), input_filename, "-3d.eps");
 
@@ -126,6 +149,8 @@ int printFilenames(FILE *out, char *input_filename, filenames_t fnames){
   fprintf(out,"  Stationary distribution: %s\n", fnames.datpb_file);
   fprintf(out,"  Screen data ...........: %s\n", fnames.datscr_file);
   fprintf(out,"  Statistics ............: %s\n", fnames.sta_file);
+  fprintf(out,"  Checkpoint ............: %s\n", fnames.chk_file);
+  fprintf(out,"  Snapshots .............: %s\n", fnames.snap_file);
   fprintf(out,"  Gnuplot script ........: %s\n\n", fnames.gpt_file);
 
   fprintf(out,"Files generated after running gnuplot:\n");
@@ -139,28 +164,23 @@ int printFilenames(FILE *out, char *input_filename, filenames_t fnames){
 }
 
 
-int readBrokenLinkFile2D(const char *filename, int max, int *****L1, 
-			 int *****L2, int type){
-  FILE *in;
+int readBrokenLink2D(const inputfile_t *input, int max, blinks_t L, int type){
+  inputfile_t cursor, *in = &cursor;
   char keyword[100];
 
   if(max<1)
     return 1;
-  if(!*L1 || !*L2)
+  if(!L.bits)
     return 2;
-  in = fopen(filename,"rt");
-  if(!in)
+  if(!input)
     return 3;
+  cursor = *input;
 
-  do{
-    fscanf(in,"%s",keyword);
-  }while(STRNEQ(keyword,"BEGINBL") && !feof(in));
-
-  if(feof(in))
+  if(!findKeyword(in,"BEGINBL"))
     return 6;
 
 
-  while(STRNEQ(keyword,"ENDBL")){
+  do{
     /* In this loop we read a sequence of keywords and interpret them. 
      * We finish when we find a ENDBL keyword.
      */
@@ -168,7 +188,8 @@ int readBrokenLinkFile2D(const char *filename, int max, int *****L1,
     int xi,yi,xf,yf;
     int j,k, auxj,auxk;
 
-    fscanf(in,"%s",keyword);
+    if(!scanString(in, keyword, sizeof(keyword)))
+      return 6;
 
     if(STREQ(keyword,"POINT")){
       /* If we find a POINT keyword we read its coordinates and, if 
@@ -176,11 +197,11 @@ int readBrokenLinkFile2D(const char *filename, int max, int *****L1,
        * point, i.e., we isolate the point.
        */
 
-      fscanf(in,"%d",&xi);
+      scanInt(in, &xi);
       if(xi<-max || xi>max)
 	return 4;
 
-      fscanf(in,"%d",&yi);
+      scanInt(in, &yi);
       if(yi<-max || yi>max)
 	return 4;
 
@@ -196,9 +217,7 @@ int readBrokenLinkFile2D(const char *filename, int max, int *****L1,
 	   * add max to the coordinates in order to make the correct
 	   * conversion.
 	   */
-	  (*L1)[j][k][max+xi][max+yi] = 0; 
-	  if(type==DIAG_LATT)
-	    (*L2)[j][k][max+xi][max+yi] = 0; 
+	  BREAKLINK2D(L,j,k,max+xi,max+yi); 
 
 	  /* If the point is on a boundary site of the lattice 
 	   * then we don't have to set the complement (it would
@@ -213,13 +232,11 @@ int readBrokenLinkFile2D(const char *filename, int max, int *****L1,
 	  if(yi==-max && auxk==-1)
 	    continue;
 
-	  /* In any other case we MUST set the complement to zero */
-	  if(type==DIAG_LATT){
-	    (*L1)[1-j][1-k][max+xi+auxj][max+yi+auxk] = 0;
-	    (*L2)[1-j][1-k][max+xi+auxj][max+yi+auxk] = 0;
-	  }
+	  /* In any other case we MUST break the complement too */
+	  if(type==DIAG_LATT)
+	    BREAKLINK2D(L,1-j,1-k,max+xi+auxj,max+yi+auxk);
 	  else
-	    (*L1)[1-j][1-k][max+xi+(auxj*(1-DELTA(j,k)))][max+yi+(auxj*DELTA(j,k))] = 0;
+	    BREAKLINK2D(L,1-j,1-k,max+xi+(auxj*(1-DELTA(j,k))),max+yi+(auxj*DELTA(j,k)));
 
 	}/* end-for k */
       }/* end-for j */
@@ -236,19 +253,19 @@ int readBrokenLinkFile2D(const char *filename, int max, int *****L1,
       int distx, disty, xvar, yvar;
       int t;
 
-      fscanf(in,"%d",&xi);
+      scanInt(in, &xi);
       if(xi<-max || xi>max)
 	return 4;
 
-      fscanf(in,"%d",&yi);
+      scanInt(in, &yi);
       if(yi<-max || yi>max)
 	return 4;
 
-      fscanf(in,"%d",&xf);
+      scanInt(in, &xf);
       if(xf<-max || xf>max)
 	return 4;
 
-      fscanf(in,"%d",&yf);
+      scanInt(in, &yf);
       if(yf<-max || yf>max)
 	return 4;
 
@@ -287,9 +304,7 @@ int readBrokenLinkFile2D(const char *filename, int max, int *****L1,
 	     * add max to the coordinates in order to make the correct
 	     * conversion.
 	     */
-	    (*L1)[j][k][max+m][max+n] = 0; 
-	    if(type==DIAG_LATT)
-	      (*L2)[j][k][max+m][max+n] = 0; 
+	    BREAKLINK2D(L,j,k,max+m,max+n); 
 
 	    /* If the point is on a boundary site of the lattice 
 	     * then we don't have to set the complement (it would
@@ -304,27 +319,35 @@ int readBrokenLinkFile2D(const char *filename, int max, int *****L1,
 	    if(n==-max && auxk==-1)
 	      continue;
 
-	    /* In any other case we MUST set the complement to zero */
-	    if(type==DIAG_LATT){
-	      (*L1)[1-j][1-k][max+m+auxj][max+n+auxk] = 0;
-	      (*L2)[1-j][1-k][max+m+auxj][max+n+auxk] = 0;
-	    }
+	    /* In any other case we MUST break the complement too */
+	    if(type==DIAG_LATT)
+	      BREAKLINK2D(L,1-j,1-k,max+m+auxj,max+n+auxk);
 	    else
-	      (*L1)[1-j][1-k][max+m+(auxj*(1-DELTA(j,k)))][max+n+(auxj*DELTA(j,k))] = 0;
+	      BREAKLINK2D(L,1-j,1-k,max+m+(auxj*(1-DELTA(j,k))),max+n+(auxj*DELTA(j,k)));
 
 	  }/* end-for k */
 	}/* end-for j */
       }/* end-for t */
 	      
     }/* end-if */
-  }/* end-while */
-
-  fclose(in);
+  }while(STRNEQ(keyword,"ENDBL"));
 
   return 0;
 }
 
 
+int readBrokenLinkFile2D(const char *filename, int max, blinks_t L, int type){
+  inputfile_t *in;
+  int error;
+
+  in = readInputFile(filename);
+  error = readBrokenLink2D(in, max, L, type);
+  freeInputFile(in);
+
+  return error;
+}
+
+
 int writeScreen(const char *filename, screen_t screen){
   FILE *out;
   int n;
@@ -0,0 +1,234 @@
+/* QWalk (qwinput.c)
+ * Copyright (C) 2008  Franklin Marquezino
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<ctype.h>
+#include "qwinput.h"
+#include "qwconsts.h"
+
+/* Size of the blocks in which the file is read */
+#define INPUT_BLOCK 65536
+
+
+/* Reads the whole file into a null-terminated string. Returns NULL if
+ * the file cannot be read or there is not enough memory.
+ */
+static char *readWholeFile(const char *filename){
+  FILE *in;
+  char *text, *aux;
+  size_t length = 0, size = INPUT_BLOCK, count;
+
+  in = fopen(filename,"rb");
+  if(!in)
+    return NULL;
+
+  text = (char *)malloc(size+1);
+  if(!text){
+    fclose(in);
+    return NULL;
+  }
+
+  while((count = fread(text+length, 1, size-length, in)) > 0){
+    length += count;
+    if(length == size){
+      size *= 2;
+      aux = (char *)realloc(text, size+1);
+      if(!aux){
+	free(text);
+	fclose(in);
+	return NULL;
+      }
+      text = aux;
+    }
+  }/* end-while */
+
+  if(ferror(in)){
+    free(text);
+    fclose(in);
+    return NULL;
+  }
+
+  fclose(in);
+  text[length] = '\0';
+  return text;
+}
+
+
+
+inputfile_t *readInputFile(const char *filename){
+  inputfile_t *in;
+  char *c;
+  long t;
+
+  in = (inputfile_t *)malloc(sizeof(inputfile_t));
+  if(!in)
+    return NULL;
+
+  in->text = readWholeFile(filename);
+  if(!in->text){
+    free(in);
+    return NULL;
+  }
+
+  /* The file is scanned twice: first we count the tokens, and then we
+   * end each of them with a null character, in place, and keep where
+   * it starts.
+   */
+  in->numTokens = 0;
+  for(c=in->text; *c; ){
+    while(isspace((unsigned char)*c))
+      c++;
+    if(!*c)
+      break;
+    in->numTokens++;
+    while(*c && !isspace((unsigned char)*c))
+      c++;
+  }/* end-for c */
+
+  in->tokens = (char **)malloc((in->numTokens+1)*sizeof(char *));
+  if(!in->tokens){
+    free(in->text);
+    free(in);
+    return NULL;
+  }
+
+  t = 0;
+  for(c=in->text; *c; ){
+    while(isspace((unsigned char)*c))
+      c++;
+    if(!*c)
+      break;
+    in->tokens[t++] = c;
+    while(*c && !isspace((unsigned char)*c))
+      c++;
+    if(*c)
+      *c++ = '\0';
+  }/* end-for c */
+  in->tokens[t] = NULL;
+
+  in->next = 0;
+  return in;
+}
+
+
+
+void freeInputFile(inputfile_t *in){
+
+  if(!in)
+    return;
+  free(in->tokens);
+  free(in->text);
+  free(in);
+
+  return;
+}
+
+
+
+int findKeyword(inputfile_t *in, const char *keyword){
+  long t;
+
+  for(t=0; t<in->numTokens; t++)
+    if(STREQ(in->tokens[t],keyword)){
+      in->next = t+1;
+      return 1;
+    }
+
+  in->next = in->numTokens;
+  return 0;
+}
+
+
+
+const char *nextToken(inputfile_t *in){
+
+  if(in->next >= in->numTokens)
+    return NULL;
+
+  return in->tokens[in->next++];
+}
+
+
+
+int scanString(inputfile_t *in, char *s, size_t size){
+  const char *token = nextToken(in);
+
+  if(!token || !size)
+    return 0;
+
+  strncpy(s, token, size-1);
+  s[size-1] = '\0';
+  return 1;
+}
+
+
+
+int scanInt(inputfile_t *in, int *value){
+  char *end;
+  long aux;
+
+  if(in->next >= in->numTokens)
+    return 0;
+
+  aux = strtol(in->tokens[in->next], &end, 10);
+  if(end == in->tokens[in->next])
+    return 0;
+
+  *value = (int)aux;
+  in->next++;
+  return 1;
+}
+
+
+
+int scanFloat(inputfile_t *in, float *value){
+  char *end;
+  float aux;
+
+  if(in->next >= in->numTokens)
+    return 0;
+
+  aux = strtof(in->tokens[in->next], &end);
+  if(end == in->tokens[in->next])
+    return 0;
+
+  *value = aux;
+  in->next++;
+  return 1;
+}
+
+
+
+int scanReal(inputfile_t *in, double *value){
+  char *end;
+  double aux;
+
+  if(in->next >= in->numTokens)
+    return 0;
+
+  aux = strtod(in->tokens[in->next], &end);
+  if(end == in->tokens[in->next])
+    return 0;
+
+  *value = aux;
+  in->next++;
+  return 1;
+}
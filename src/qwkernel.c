@@ -0,0 +1,340 @@
+/* QWalk (qwkernel.c)
+ * Copyright (C) 2008  Franklin Marquezino
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<complex.h>
+#include "qwkernel.h"
+#include "qwconsts.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define QW_X86_KERNELS
+#include<immintrin.h>
+#endif
+
+
+void coinKernelScalar(double complex *dst, const double complex *const src[4],
+		      const double complex coin[4], long stride, int len){
+  int i;
+
+  for(i=0; i<len; i++){
+    const long s = i*stride;
+    double complex newValue = 0.0;
+
+    newValue += coin[0]*src[0][s];
+    newValue += coin[1]*src[1][s];
+    newValue += coin[2]*src[2][s];
+    newValue += coin[3]*src[3][s];
+
+    dst[s] = newValue;
+  }/* end-for i */
+
+  return;
+}
+
+
+
+/* Every entry of the Hadamard, Grover and Fourier coins is 1/2 times
+ * one of 1, -1, i or -i. Multiplying an amplitude by such a number only
+ * swaps its real and imaginary parts and changes their signs. This 
+ * function describes an entry in this way: if swap is 1 the real and
+ * imaginary parts are exchanged, and then they are multiplied by sr 
+ * and si, respectively.
+ */
+static void decodeSignRow(const double complex coin[4], int swap[4],
+			  double sr[4], double si[4]){
+  int q;
+
+  for(q=0; q<4; q++){
+    if(creal(coin[q]) != 0.0){
+      swap[q] = 0;
+      sr[q] = (creal(coin[q]) > 0.0) ? 1.0 : -1.0;
+      si[q] = sr[q];
+    }
+    else{
+      swap[q] = 1;
+      si[q] = (cimag(coin[q]) > 0.0) ? 1.0 : -1.0;
+      sr[q] = -si[q];
+    }
+  }/* end-for q */
+
+  return;
+}
+
+
+
+void coinKernelSignScalar(double complex *dst, const double complex *const src[4],
+			  const double complex coin[4], long stride, int len){
+  int i, q, swap[4];
+  double sr[4], si[4];
+
+  decodeSignRow(coin, swap, sr, si);
+
+  /* The factor 1/2 is applied after the sum. Since multiplication by 
+   * 1/2 is exact, the result is the same as in coinKernelScalar.
+   */
+  for(i=0; i<len; i++){
+    const long s = i*stride;
+    double re = 0.0, im = 0.0;
+
+    for(q=0; q<4; q++){
+      const double *x = (const double *)(src[q] + s);
+      re += sr[q]*x[swap[q]];
+      im += si[q]*x[1-swap[q]];
+    }/* end-for q */
+
+    dst[s] = 0.5*re + I*(0.5*im);
+  }/* end-for i */
+
+  return;
+}
+
+
+
+#ifdef QW_X86_KERNELS
+
+/* The vector kernels keep the amplitudes interleaved (real, imaginary)
+ * as they are in memory. The product by a coin entry c is computed as
+ *
+ *   (re,im)*creal(c) -/+ (im,re)*cimag(c)
+ *
+ * which gives the same real products, added in the same order, as the
+ * scalar complex product. We do not use fused multiply-add, since it
+ * would change the rounding.
+ */
+
+/* Loads two complex numbers, stride apart, into one AVX register. */
+__attribute__((target("avx2")))
+static inline __m256d load2(const double complex *p, long stride){
+  return _mm256_insertf128_pd(_mm256_castpd128_pd256(_mm_loadu_pd((const double *)p)),
+			      _mm_loadu_pd((const double *)(p + stride)), 1);
+}
+
+
+__attribute__((target("avx2")))
+static inline void store2(double complex *p, long stride, __m256d v){
+  _mm_storeu_pd((double *)p, _mm256_castpd256_pd128(v));
+  _mm_storeu_pd((double *)(p + stride), _mm256_extractf128_pd(v, 1));
+}
+
+
+__attribute__((target("avx2")))
+static void coinKernelAVX2(double complex *dst, const double complex *const src[4],
+			   const double complex coin[4], long stride, int len){
+  int i, q;
+  __m256d cre[4], cim[4];
+
+  for(q=0; q<4; q++){
+    cre[q] = _mm256_set1_pd(creal(coin[q]));
+    cim[q] = _mm256_set1_pd(cimag(coin[q]));
+  }
+
+  for(i=0; i+1<len; i+=2){
+    const long s = i*stride;
+    __m256d newValue = _mm256_setzero_pd();
+
+    for(q=0; q<4; q++){
+      const __m256d v = load2(src[q] + s, stride);
+      const __m256d t1 = _mm256_mul_pd(v, cre[q]);
+      const __m256d t2 = _mm256_mul_pd(_mm256_permute_pd(v, 0x5), cim[q]);
+      newValue = _mm256_add_pd(newValue, _mm256_addsub_pd(t1, t2));
+    }/* end-for q */
+
+    store2(dst + s, stride, newValue);
+  }/* end-for i */
+
+  if(i<len){
+    const long s = i*stride;
+    const double complex *const tail[4] = {src[0]+s, src[1]+s,
+					   src[2]+s, src[3]+s};
+    coinKernelScalar(dst + s, tail, coin, stride, len - i);
+  }
+
+  return;
+}
+
+
+__attribute__((target("avx512f")))
+static void coinKernelAVX512(double complex *dst, const double complex *const src[4],
+			     const double complex coin[4], long stride, int len){
+  int i, q;
+  __m512d cre[4], cim[4];
+
+  for(q=0; q<4; q++){
+    cre[q] = _mm512_set1_pd(creal(coin[q]));
+    cim[q] = _mm512_set1_pd(cimag(coin[q]));
+  }
+
+  for(i=0; i+3<len; i+=4){
+    const long s = i*stride;
+    __m512d newValue = _mm512_setzero_pd();
+
+    for(q=0; q<4; q++){
+      __m512d v, t1, t2;
+
+      if(stride == 1)
+	v = _mm512_loadu_pd((const double *)(src[q] + s));
+      else
+	v = _mm512_insertf64x4(_mm512_castpd256_pd512(load2(src[q] + s, stride)),
+			       load2(src[q] + s + 2*stride, stride), 1);
+
+      t1 = _mm512_mul_pd(v, cre[q]);
+      t2 = _mm512_mul_pd(_mm512_permute_pd(v, 0x55), cim[q]);
+
+      /* Subtraction in the real lanes and addition in the imaginary ones */
+      newValue = _mm512_add_pd(newValue,
+			       _mm512_mask_sub_pd(_mm512_add_pd(t1, t2),
+						  0x55, t1, t2));
+    }/* end-for q */
+
+    if(stride == 1)
+      _mm512_storeu_pd((double *)(dst + s), newValue);
+    else{
+      store2(dst + s, stride, _mm512_castpd512_pd256(newValue));
+      store2(dst + s + 2*stride, stride, _mm512_extractf64x4_pd(newValue, 1));
+    }
+  }/* end-for i */
+
+  if(i<len){
+    const long s = i*stride;
+    const double complex *const tail[4] = {src[0]+s, src[1]+s,
+					   src[2]+s, src[3]+s};
+    coinKernelAVX2(dst + s, tail, coin, stride, len - i);
+  }
+
+  return;
+}
+
+
+
+/* Sign kernels. The real and imaginary parts are exchanged by a 
+ * variable permutation, so the loop has no branches.
+ */
+__attribute__((target("avx2")))
+static void coinKernelSignAVX2(double complex *dst, const double complex *const src[4],
+			       const double complex coin[4], long stride, int len){
+  int i, q, swap[4];
+  double sr[4], si[4];
+  __m256i perm[4];
+  __m256d sign[4];
+  const __m256d half = _mm256_set1_pd(0.5);
+
+  decodeSignRow(coin, swap, sr, si);
+  for(q=0; q<4; q++){
+    perm[q] = swap[q] ? _mm256_set_epi64x(0, 2, 0, 2) : _mm256_set_epi64x(2, 0, 2, 0);
+    sign[q] = _mm256_set_pd(si[q], sr[q], si[q], sr[q]);
+  }
+
+  for(i=0; i+1<len; i+=2){
+    const long s = i*stride;
+    __m256d newValue = _mm256_setzero_pd();
+
+    for(q=0; q<4; q++){
+      const __m256d v = load2(src[q] + s, stride);
+      newValue = _mm256_add_pd(newValue, 
+			       _mm256_mul_pd(_mm256_permutevar_pd(v, perm[q]), 
+					     sign[q]));
+    }/* end-for q */
+
+    store2(dst + s, stride, _mm256_mul_pd(newValue, half));
+  }/* end-for i */
+
+  if(i<len){
+    const long s = i*stride;
+    const double complex *const tail[4] = {src[0]+s, src[1]+s,
+					   src[2]+s, src[3]+s};
+    coinKernelSignScalar(dst + s, tail, coin, stride, len - i);
+  }
+
+  return;
+}
+
+
+__attribute__((target("avx512f")))
+static void coinKernelSignAVX512(double complex *dst, const double complex *const src[4],
+				 const double complex coin[4], long stride, int len){
+  int i, q, swap[4];
+  double sr[4], si[4];
+  __m512i perm[4];
+  __m512d sign[4];
+  const __m512d half = _mm512_set1_pd(0.5);
+
+  decodeSignRow(coin, swap, sr, si);
+  for(q=0; q<4; q++){
+    perm[q] = swap[q] ? _mm512_set_epi64(0, 2, 0, 2, 0, 2, 0, 2) : 
+      _mm512_set_epi64(2, 0, 2, 0, 2, 0, 2, 0);
+    sign[q] = _mm512_set_pd(si[q], sr[q], si[q], sr[q], 
+			    si[q], sr[q], si[q], sr[q]);
+  }
+
+  for(i=0; i+3<len; i+=4){
+    const long s = i*stride;
+    __m512d newValue = _mm512_setzero_pd();
+
+    for(q=0; q<4; q++){
+      __m512d v;
+
+      if(stride == 1)
+	v = _mm512_loadu_pd((const double *)(src[q] + s));
+      else
+	v = _mm512_insertf64x4(_mm512_castpd256_pd512(load2(src[q] + s, stride)),
+			       load2(src[q] + s + 2*stride, stride), 1);
+
+      newValue = _mm512_add_pd(newValue, 
+			       _mm512_mul_pd(_mm512_permutevar_pd(v, perm[q]), 
+					     sign[q]));
+    }/* end-for q */
+
+    newValue = _mm512_mul_pd(newValue, half);
+    if(stride == 1)
+      _mm512_storeu_pd((double *)(dst + s), newValue);
+    else{
+      store2(dst + s, stride, _mm512_castpd512_pd256(newValue));
+      store2(dst + s + 2*stride, stride, _mm512_extractf64x4_pd(newValue, 1));
+    }
+  }/* end-for i */
+
+  if(i<len){
+    const long s = i*stride;
+    const double complex *const tail[4] = {src[0]+s, src[1]+s,
+					   src[2]+s, src[3]+s};
+    coinKernelSignAVX2(dst + s, tail, coin, stride, len - i);
+  }
+
+  return;
+}
+
+#endif
+
+
+
+coinkernel_t getCoinKernel(int coinType){
+  const int sign = (coinType == HADAMARD_COIN || coinType == GROVER_COIN ||
+		    coinType == FOURIER_COIN);
+
+#ifdef QW_X86_KERNELS
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512f"))
+    return sign ? coinKernelSignAVX512 : coinKernelAVX512;
+  if(__builtin_cpu_supports("avx2"))
+    return sign ? coinKernelSignAVX2 : coinKernelAVX2;
+#endif
+
+  return sign ? coinKernelSignScalar : coinKernelScalar;
+}
@@ -19,94 +19,116 @@
 
 #include<stdio.h>
 #include<stdlib.h>
-#include<complex.h>
-#include<math.h>
-#include "qwmem_int.h"
+#include<string.h>
 #include "qwlinks.h"
 #include "qwconsts.h"
 
 
-int initBrokenLink1D(int ***L, int max, unsigned char type){
-  int j;
-  static char previousAlloc=0;
-  const int rbound = (type == LINE_LATT) ? 2*max+1 : max;
+/* Allocates (if needed) and closes a set of broken links with the
+ * given number of planes and rows of sites.
+ */
+static int initBrokenLink(blinks_t *L, int planes, int rows, int sites){
+
+  if(!L->bits){
+    L->planes = planes;
+    L->rows = rows;
+    L->words = (sites+63)/64;
+    L->bits = (unsigned long long *)malloc((size_t)planes*rows*L->words*
+					   sizeof(unsigned long long));
+    if(!L->bits)
+      return 2;
+  }
+  else if(L->planes != planes || L->rows != rows || L->words != (sites+63)/64)
+    return 2;
 
-  if(max<1)
-    return 1;
+  return closeBrokenLink(*L);
+}
 
-  if(!previousAlloc){
-    *L = (type == LINE_LATT) ? 
-      allocInt2D(2,2*max+1) : allocInt2D(2,max);
-  }
 
-  if(*L){
-    previousAlloc = 1;
-  }
-  else{
-    previousAlloc = 0;
-    return 2;
-  }
 
-  for(j=0; j<2; j++){
-    int m;
+int initBrokenLink1D(blinks_t *L, int max, unsigned char type){
+  const int rbound = (type == LINE_LATT) ? 2*max+1 : max;
 
-    for(m=0; m<rbound; m++){
-      (*L)[j][m] = (int)pow(-1.0, j);
-    }
-  }
+  if(max<1)
+    return 1;
+  if(!L)
+    return 2;
 
-  return 0;
+  return initBrokenLink(L, 2, 1, rbound);
 }
 
 
-int initBrokenLink2D(int *****L1, int *****L2, int max, unsigned char type){
-  int j, k;
-  static char previousAlloc1 = 0, previousAlloc2 = 0;
+
+int initBrokenLink2D(blinks_t *L, int max, unsigned char type){
   const int rbound = (type == CYCLE_LATT) ? max : 2*max+1;
 
   if(max<1)
     return 1;
+  if(!L)
+    return 2;
+
+  return initBrokenLink(L, 4, rbound, rbound);
+}
+
 
-  if(!previousAlloc1)
-    *L1 = allocInt4D(2, 2, rbound, rbound);
 
-  if(*L1)
-    previousAlloc1 = 1;
-  else{
-    previousAlloc1 = 0;
+int closeBrokenLink(blinks_t L){
+
+  if(!L.bits)
     return 2;
-  }
 
-  if(!previousAlloc2 && type==DIAG_LATT)
-    *L2 = allocInt4D(2, 2, 2*max+1, 2*max+1);
-  else if(!previousAlloc2 && type!=DIAG_LATT)
-    *L2 = allocInt4D(1, 1, 1, 1);
+  memset(L.bits, 0, (size_t)L.planes*L.rows*L.words*sizeof(unsigned long long));
+
+  return 0;
+}
+
 
-  if(*L2)
-    previousAlloc2 = 1;
-  else{
-    previousAlloc2 = 0;
+
+int copyBrokenLink(blinks_t L, blinks_t P){
+
+  if(!L.bits || !P.bits)
+    return 2;
+  if(L.planes != P.planes || L.rows != P.rows || L.words != P.words)
     return 2;
-  }
 
-  /* Initializing all the links closed */
-  for(j=0; j<2; j++){
-    int auxj, auxk, m, n;
-    auxj = (int)pow(-1.0, j);
+  memcpy(L.bits, P.bits, (size_t)L.planes*L.rows*L.words*
+	 sizeof(unsigned long long));
 
-    for(k=0; k<2; k++){
-      auxk = (int)pow(-1.0,k);
+  return 0;
+}
 
-      for(m=0; m<rbound; m++){
-	for(n=0; n<rbound; n++){
-	  (*L1)[j][k][m][n] = auxj;
-	  if( type==DIAG_LATT )
-	    (*L2)[j][k][m][n] = auxk;
-	}
+
+
+int nextBrokenSite2D(blinks_t L, int m, int n, int end){
+  const unsigned long long *r0 = BLROW(L,0,m);
+  const unsigned long long *r1 = BLROW(L,1,m);
+  const unsigned long long *r2 = BLROW(L,2,m);
+  const unsigned long long *r3 = BLROW(L,3,m);
+
+  /* Words without any broken link are skipped at once */
+  while(n < end){
+    const int w = n >> 6;
+    unsigned long long bits = (r0[w] | r1[w] | r2[w] | r3[w]) >> (n & 63);
+
+    if(bits){
+      while(!(bits & 1ULL)){
+	bits >>= 1;
+	n++;
       }
+      return MINIMUM(n, end);
     }
-  }
+    n = (w+1) << 6;
+  }/* end-while */
 
-  return 0;
+  return end;
+}
+
+
+
+void freeBrokenLink(blinks_t *L){
+
+  free(L->bits);
+  L->bits = NULL;
 
+  return;
 }
@@ -23,25 +23,53 @@
 #include<math.h>
 #include "qwmem_complex.h"
 #include "qwmem_real.h"
+#include "qwrandom.h"
 #include "qwmeasure.h"
 #include "qwoptions_io.h"
 #include "qwconsts.h" 
+#include "qwstate.h"
+#include "qwstatistics.h"
 
 
-int measureState2D(double complex *****A, double complex *****Atemp, 
-		   options2D_t opts){
-  int j, k, m, n;
-  int det, dice, result, error;
-  double *p, *sp;
-  double complex ****aux;
+/* Position (*m,*n), in the arrays of the state, of detector det. */
+static void detectorSite2D(options2D_t opts, int det, int *m, int *n){
+
+  if(opts.lattType == CYCLE_LATT){
+    *m = opts.detector_pts[det][0];
+    *n = opts.detector_pts[det][1];
+  }else{
+    *m = opts.max + opts.detector_pts[det][0];
+    *n = opts.max + opts.detector_pts[det][1];
+  }
+
+  return;
+}
 
-  int max = opts.max;
-  int detectors = opts.detectors;
-  int **detector_pts = opts.detector_pts;
 
-  const int lbound   = (opts.lattType == CYCLE_LATT) ? 0 : -max;
-  const int rbound   = (opts.lattType == CYCLE_LATT) ? max-1 : max;
-  const int aux_size = (opts.lattType == CYCLE_LATT) ? max : 2*max+1;
+/* Probability of finding the walker at site (m,n) of the arrays. */
+static double siteProb2D(complex4D_t A, int m, int n){
+  int j, k;
+  double prob;
+
+  prob = 0.0;
+  for(j=0; j<2; j++)
+    for(k=0; k<2; k++)
+      prob += ENTRY4D(A,j,k,m,n)*conj(ENTRY4D(A,j,k,m,n));
+
+  return prob;
+}
+
+
+
+int measureState2D(complex4D_t *A, options2D_t opts, int iteration, 
+		   rng_t *rng){
+  int j, k, m, n, ir, ic, nrows, ncols;
+  int rows[2][2], cols[2][2];
+  int det, result;
+  double dice, p, sp, norm;
+  double complex site[2][2];
+
+  const int auxsize = (opts.lattType == CYCLE_LATT) ? opts.max : 2*opts.max+1;
 
   /* Detectors are described by a collection M_m of measurement 
    * operators which satisfy the completeness equation. The index m
@@ -60,202 +88,281 @@ int measureState2D(double complex *****A, double complex *****Atemp,
    */
 
 
-  if( (!*A) || (!*Atemp))
+  if(!A->data)
     return -1;
-  if(max<1)
+  if(opts.max<1)
     return -2;
-  if(detectors<0)
+  if(opts.detectors<0)
     return -3;
-  if(!detector_pts)
+  if(!opts.detector_pts)
     return -4;
-
-  p = allocReal1D(detectors+1);
-  if(!p)
+  if(iteration<0)
     return -5;
-  error = cleanReal1D(p, detectors+1);
-  if(error)
-    return -6;
 
-  sp = allocReal1D(detectors+1);
-  if(!sp)
-    return -5;
-  error = cleanReal1D(sp, detectors+1);
-  if(error)
-    return -6;
-
-  /* Here we evaluate the probability of each detection... */
-  for(det=1; det<=detectors; det++ ){  
-    if(opts.lattType == CYCLE_LATT){
-      m = detector_pts[det][0];
-      n = detector_pts[det][1];
-    }else{
-      m = max + detector_pts[det][0];
-      n = max + detector_pts[det][1];
+  /* The probabilities p(m) are computed again when they are needed, 
+   * instead of being kept in arrays: only the sites of the detectors 
+   * are visited, so this costs less than allocating the arrays.
+   * First we get the probability of measuring the complement...
+   */
+  p = 1.0;
+  for(det=1; det<=opts.detectors; det++){
+    detectorSite2D(opts, det, &m, &n);
+    p -= siteProb2D(*A, m, n);
+  }
+
+  /* We get a new random number */
+  dice = getRandom(rng);
+
+  /* ...and based on this number we identify the corresponding result */
+  sp = p;
+  result = 0;
+  if(!(dice < sp)){
+    int last = 0;
+
+    for(det=1; det<=opts.detectors; det++){
+      double prob;
+
+      detectorSite2D(opts, det, &m, &n);
+      prob = siteProb2D(*A, m, n);
+      if(prob > 0.0)
+	last = det;
+      sp += prob;
+      if(dice < sp)
+	break;
     }
+    /* Because of rounding, the sum may not reach the random number. In
+     * this case the last detector which may click is chosen.
+     */
+    result = (det <= opts.detectors) ? det : last;
+  }
 
+  if(result){
+    /* The detector clicked: only its site survives, renormalized */
+    detectorSite2D(opts, result, &m, &n);
+    norm = sqrt(siteProb2D(*A, m, n));
     for(j=0; j<2; j++)
       for(k=0; k<2; k++)
-	p[det] += (*A)[j][k][m][n]*conj((*A)[j][k][m][n]);
+	site[j][k] = ENTRY4D(*A,j,k,m,n)/norm;
   }
-
-  /* ...and the probability of measuring the complement */
-  p[0] = 1.0;
-  for(j=1; j<=detectors; j++)
-    p[0] -= p[j];
-
-  /* ...  */
-  sp[0] = p[0];
-  for(det=1; det<=detectors; det++)
-    sp[det] = sp[det-1] + p[det];
-
-  /* We get a new random number */
-  dice = rand();
-
-  /* Based on this number we identify the corresponding result */
-  for(result=0; result<=detectors; result++)
-    if(dice < sp[result]*RAND_MAX) break;
-
-  for(m=lbound; m<rbound; m++){
-    for(n=lbound; n<rbound; n++){
-      int delta;
-      const int auxm = (opts.lattType == CYCLE_LATT) ? m : max+m;
-      const int auxn = (opts.lattType == CYCLE_LATT) ? n : max+n;
-
-      if(result==0){
-	delta = 1;
-	for(det=1; det<=detectors; det++)
-	  delta *= (1-DELTA(m, detector_pts[det][0])*
-		    DELTA(n, detector_pts[det][1]));
-      }
-      else{
-	delta = DELTA(m, detector_pts[result][0])*
-	  DELTA(n, detector_pts[result][1]);
-      }
-      
+  else{
+    /* No detector clicked: the sites of the detectors are cleaned and
+     * the remaining state is renormalized below.
+     */
+    norm = sqrt(p);
+    for(det=1; det<=opts.detectors; det++){
+      detectorSite2D(opts, det, &m, &n);
       for(j=0; j<2; j++)
 	for(k=0; k<2; k++)
-	  (*Atemp)[j][k][auxm][auxn] = 
-	    delta*((*A)[j][k][auxm][auxn])/sqrt(p[result]);
+	  ENTRY4D(*A,j,k,m,n) = 0.0;
     }
   }
 
-  free(p);
-  free(sp);
+  /* The state is changed in place, visiting only its support (see 
+   * getSupport2D). If a detector clicked the support is cleaned and 
+   * the site of the detector is written back.
+   */
+  {
+    const support2D_t supp = getSupport2D(opts, iteration);
+
+    nrows = getSupportRanges(supp.lo[0], supp.len[0], auxsize, rows);
+    ncols = getSupportRanges(supp.lo[1], supp.len[1], auxsize, cols);
+  }
 
-  /* Now we quicky exchange matrices A and Atemp */
-  aux = *A;
-  *A = *Atemp;
-  *Atemp = aux;
+  for(ir=0; ir<nrows; ir++){
+    int auxm;
 
-  error = cleanComplex4D(*Atemp, 2, 2, aux_size, aux_size);
-  if(error)
-    return -6;
+    for(auxm=rows[ir][0]; auxm<rows[ir][1]; auxm++){
+      for(ic=0; ic<ncols; ic++){
+	int auxn;
+
+	for(auxn=cols[ic][0]; auxn<cols[ic][1]; auxn++){
+	  for(j=0; j<2; j++)
+	    for(k=0; k<2; k++){
+	      if(result)
+		ENTRY4D(*A,j,k,auxm,auxn) = 0.0;
+	      else
+		ENTRY4D(*A,j,k,auxm,auxn) /= norm;
+	    }
+	}/* end-for auxn */
+      }/* end-for ic */
+    }/* end-for auxm */
+  }/* end-for ir */
+
+  if(result)
+    for(j=0; j<2; j++)
+      for(k=0; k<2; k++)
+	ENTRY4D(*A,j,k,m,n) = site[j][k];
 
   return result;
 }
 
 
 
-int randMeasure2D(double complex *****A, options2D_t opts){
+int randMeasure2D(complex4D_t *A, options2D_t opts, int iteration, 
+		  rng_t *rng, statistics_t *stat){
 
-  int markX, markY, marked;
-  int m, n, diceA, diceB;
-  float sp;
+  int markX, markY;
+  int m, n, j, k, ir, ic, nrows, ncols;
+  int rows[2][2], cols[2][2];
+  long long s, count;
+  double diceA, sp, scale;
+  double fstMomentX, secMomentX, fstMomentY, secMomentY;
+  double complex site[2][2];
 
-  const int rbound = (opts.lattType == CYCLE_LATT) ? 
-    opts.max-1 : 2*opts.max;
+  const int auxsize = (opts.lattType == CYCLE_LATT) ? opts.max : 2*opts.max+1;
+  const int shift = (opts.lattType == CYCLE_LATT) ? 0 : opts.max;
+  const support2D_t supp = getSupport2D(opts, iteration);
 
-  /* We get a new random number */
-  diceA = rand();
+  if(!A->data)
+    return -1;
+  if(opts.max<1)
+    return -2;
+  if(iteration<0)
+    return -3;
+  if(stat && opts.calcMix)
+    return -4;
+
+  /* Each site is measured with probability dtProb, and the state 
+   * collapses to the first measured site (m,n) such that diceA is 
+   * smaller than the sum sp of the probabilities of the sites measured 
+   * so far. Sites outside the support of the wave function (see 
+   * getSupport2D) have probability zero, so we only number the sites 
+   * of the support, row by row, and jump from one measured site to the
+   * next one with getSkip.
+   */
+  diceA = getRandom(rng);
 
-  /* Now we scan the lattice checking if any point is measured */
   markX = markY = -1;
-  marked=0;
-  sp=0.0;
-  for(m=0; m<=rbound; m++){
-    for(n=0; n<=rbound; n++){
-      int j,k;
-      float prob;
-
-      prob=0.0;
-      for(j=0; j<2; j++)
-	for(k=0; k<2; k++)
-	  prob += (*A)[j][k][m][n]*conj((*A)[j][k][m][n]);
-
-      diceB = rand();
-      if(diceB < opts.dtProb*RAND_MAX){ /* if site should be measured */
-	sp += prob;
-	if(diceA < sp*RAND_MAX && !marked){ /* if state collapsed to this site */
-	  markX = m;
-	  markY = n;
-	  marked = 1;
-	}
-	else{
-	  for(j=0; j<2; j++)
-	    for(k=0; k<2; k++)
-	      (*A)[j][k][m][n] = 0.0;
-	}
-      }
+  sp = 0.0;
+  count = (long long)supp.len[0]*supp.len[1];
+  for(s=getSkip(rng, opts.dtProb, count); s<count; 
+      s+=1+getSkip(rng, opts.dtProb, count)){
+    double prob;
 
-    }/* end-for n */
-  }/* end-for m */
+    m = (supp.lo[0] + (int)(s/supp.len[1]))%auxsize;
+    n = (supp.lo[1] + (int)(s%supp.len[1]))%auxsize;
 
-  for(m=0; m<=rbound; m++){
-    for(n=0; n<=rbound; n++){
-      int j,k;
+    prob = 0.0;
+    for(j=0; j<2; j++)
+      for(k=0; k<2; k++)
+	prob += ENTRY4D(*A,j,k,m,n)*conj(ENTRY4D(*A,j,k,m,n));
 
-      if(markX==-1 && markY==-1){ /* measured the complement */
-	for(j=0; j<2; j++)
-	  for(k=0; k<2; k++)
-	    (*A)[j][k][m][n] *= pow(1.0-sp, -0.5);
+    sp += prob;
+    if(diceA < sp){ /* the state collapsed to this site */
+      markX = m;
+      markY = n;
+      break;
+    }
 
-      }else if(markX==m && markY==n){ /* measured this site */
-	float prob;
+    for(j=0; j<2; j++)
+      for(k=0; k<2; k++)
+	ENTRY4D(*A,j,k,m,n) = 0.0;
+  }/* end-for s */
 
-	prob = 0.0;
-	for(j=0; j<2; j++)
-	  for(k=0; k<2; k++)
-	    prob += (*A)[j][k][m][n]*conj((*A)[j][k][m][n]);
+  if(markX >= 0){
+    double prob;
 
-	for(j=0; j<2; j++)
-	  for(k=0; k<2; k++)
-	    (*A)[j][k][m][n] *= pow(prob, -0.5);
-	
+    /* Only the collapsed site survives. Its first measured site was 
+     * the first one to make sp greater than diceA, so prob > 0.
+     */
+    prob = 0.0;
+    for(j=0; j<2; j++)
+      for(k=0; k<2; k++)
+	prob += ENTRY4D(*A,j,k,markX,markY)*conj(ENTRY4D(*A,j,k,markX,markY));
 
-      }else{ /* measured some other site */
+    scale = 1.0/sqrt(prob);
+    for(j=0; j<2; j++)
+      for(k=0; k<2; k++)
+	site[j][k] = ENTRY4D(*A,j,k,markX,markY)*scale;
+  }
+  else /* measured the complement */
+    scale = 1.0/sqrt(1.0-sp);
 
-	for(j=0; j<2; j++)
-	  for(k=0; k<2; k++)
-	    (*A)[j][k][m][n] = 0.0;
+  /* A single sweep over the support renormalizes the state (or cleans
+   * it, if it collapsed), visiting the sites in the same order as 
+   * getStatisticsFromState2D. If stat is given we also accumulate the 
+   * moments, so they are exactly the ones that function would find.
+   */
+  fstMomentX = secMomentX = fstMomentY = secMomentY = 0.0;
+
+  nrows = getSupportRanges(supp.lo[0], supp.len[0], auxsize, rows);
+  ncols = getSupportRanges(supp.lo[1], supp.len[1], auxsize, cols);
+
+  for(ir=0; ir<nrows; ir++){
+    for(m=rows[ir][0]; m<rows[ir][1]; m++){
+      for(ic=0; ic<ncols; ic++){
+	for(n=cols[ic][0]; n<cols[ic][1]; n++){
+	  double prob;
+
+	  if(markX >= 0){
+	    const int here = (m == markX && n == markY);
+
+	    for(j=0; j<2; j++)
+	      for(k=0; k<2; k++)
+		ENTRY4D(*A,j,k,m,n) = here ? site[j][k] : 0.0;
+	    if(!here || !stat)
+	      continue;
+	  }
+	  else{
+	    for(j=0; j<2; j++)
+	      for(k=0; k<2; k++)
+		ENTRY4D(*A,j,k,m,n) *= scale;
+	    if(!stat)
+	      continue;
+	  }
+
+	  prob = 0.0;
+	  for(j=0; j<2; j++)
+	    for(k=0; k<2; k++)
+	      prob += ENTRY4D(*A,j,k,m,n)*conj(ENTRY4D(*A,j,k,m,n));
 
-      }
+	  fstMomentX += (m-shift)*prob;
+	  secMomentX += (m-shift)*(m-shift)*prob;
+	  fstMomentY += (n-shift)*prob;
+	  secMomentY += (n-shift)*(n-shift)*prob;
+	}/* end-for n */
+      }/* end-for ic */
+    }/* end-for m */
+  }/* end-for ir */
 
-    }/* end-for n */
-  }/* end-for m */
+  if(stat)
+    *stat = getStatisticsFromMoments2D(fstMomentX, secMomentX, 
+				       fstMomentY, secMomentY, iteration);
 
   return 0;
 }
 
 
 
-int measureState1D(double complex ***A, double complex ***Atemp, 
-		   options1D_t opts){
-  int j, m;
-  int det, dice, result, error;
-  double *p, *sp;
-  double complex **aux;
+/* Position m, in the arrays of the state, of detector det. */
+static int detectorSite1D(options1D_t opts, int det){
+  return (opts.lattType == LINE_LATT) ? 
+    opts.max + opts.detector_pts[det] : opts.detector_pts[det];
+}
+
 
-  int MAX = opts.max; 
-  int detectors = opts.detectors;
-  int *detector_pts = opts.detector_pts;
+/* Probability of finding the walker at site m of the arrays. */
+static double siteProb1D(double complex **A, int m){
+  int j;
+  double prob;
 
-  const int lbound   = (opts.lattType == LINE_LATT) ? -MAX : 0;
-  const int rbound   = (opts.lattType == LINE_LATT) ? MAX : MAX-1;
-  const int aux_size = (opts.lattType == LINE_LATT) ? 2*MAX+1 : MAX;
+  prob = 0.0;
+  for(j=0; j<2; j++)
+    prob += A[j][m]*conj(A[j][m]);
 
+  return prob;
+}
 
 
 
+int measureState1D(double complex ***A, options1D_t opts, rng_t *rng){
+  int j, m;
+  int det, result;
+  double dice, p, sp, norm;
+  double complex site[2];
+
+  const int size = (opts.lattType == LINE_LATT) ? 2*opts.max+1 : opts.max;
+
   /* Detectors are described by a collection M_m of measurement 
    * operators which satisfy the completeness equation. The index m
    * indicates the result of the measurement. Before state |Psi> is 
@@ -273,156 +380,145 @@ int measureState1D(double complex ***A, double complex ***Atemp,
    */
 
 
-  if( (!*A) || (!*Atemp))
+  if(!*A)
     return -1;
-  if(MAX<1)
+  if(opts.max<1)
     return -2;
-  if(detectors<0)
+  if(opts.detectors<0)
     return -3;
-  if(!detector_pts)
+  if(!opts.detector_pts)
     return -4;
 
-  p = allocReal1D(detectors+1);
-  if(!p)
-    return -5;
-  error = cleanReal1D(p, detectors+1);
-  if(error)
-    return -6;
+  /* As in measureState2D, the probabilities are computed again when 
+   * they are needed. First the probability of measuring the complement...
+   */
+  p = 1.0;
+  for(det=1; det<=opts.detectors; det++)
+    p -= siteProb1D(*A, detectorSite1D(opts, det));
 
-  sp = allocReal1D(detectors+1);
-  if(!sp)
-    return -5;
-  error = cleanReal1D(sp, detectors+1);
-  if(error)
-    return -6;
+  /* We get a new random number */
+  dice = getRandom(rng);
 
-  /* Here we evaluate the probability of each detection... */
-  for(det=1; det<=detectors; det++ ){  
-    m = (opts.lattType == LINE_LATT) ? 
-      MAX + detector_pts[det] : detector_pts[det];
+  /* ...and based on this number we identify the corresponding result */
+  sp = p;
+  result = 0;
+  if(!(dice < sp)){
+    int last = 0;
 
-    for(j=0; j<2; j++)
-      p[det] += (*A)[j][m]*conj((*A)[j][m]);
+    for(det=1; det<=opts.detectors; det++){
+      const double prob = siteProb1D(*A, detectorSite1D(opts, det));
+
+      if(prob > 0.0)
+	last = det;
+      sp += prob;
+      if(dice < sp)
+	break;
+    }
+    /* See measureState2D */
+    result = (det <= opts.detectors) ? det : last;
   }
 
-  /* ...and the probability of measuring the complement */
-  p[0] = 1.0;
-  for(j=1; j<=detectors; j++)
-    p[0] -= p[j];
+  if(result){
+    /* The detector clicked: only its site survives, renormalized */
+    m = detectorSite1D(opts, result);
+    norm = sqrt(siteProb1D(*A, m));
+    for(j=0; j<2; j++)
+      site[j] = (*A)[j][m]/norm;
 
-  /* ...  */
-  sp[0] = p[0];
-  for(det=1; det<=detectors; det++)
-    sp[det] = sp[det-1] + p[det];
+    for(j=0; j<2; j++){
+      int i;
 
-  /* We get a new random number */
-  dice = rand();
-
-  /* Based on this number we identify the corresponding result */
-  for(result=0; result<=detectors; result++)
-    if(dice < sp[result]*RAND_MAX) break;
-
-  for(m=lbound; m<=rbound; m++){
-    int delta;
-    const int auxm = (opts.lattType == LINE_LATT) ? MAX+m : m;
-    
-    if(result==0){
-      delta = 1;
-      for(det=1; det<=detectors; det++)
-	delta *= (1-DELTA(m, detector_pts[det]));
+      for(i=0; i<size; i++)
+	(*A)[j][i] = 0.0;
+      (*A)[j][m] = site[j];
     }
-    else{
-      delta = DELTA(m, detector_pts[result]);
+  }
+  else{
+    /* No detector clicked: the sites of the detectors are cleaned and
+     * the remaining state is renormalized.
+     */
+    norm = sqrt(p);
+    for(det=1; det<=opts.detectors; det++){
+      m = detectorSite1D(opts, det);
+      for(j=0; j<2; j++)
+	(*A)[j][m] = 0.0;
     }
-      
     for(j=0; j<2; j++)
-      (*Atemp)[j][auxm] = delta*((*A)[j][auxm])/sqrt(p[result]);
+      for(m=0; m<size; m++)
+	(*A)[j][m] /= norm;
   }
 
-  free(p);
-  free(sp);
-
-  /* Now we quicky exchange matrices A and Atemp */
-  aux = *A;
-  *A = *Atemp;
-  *Atemp = aux;
-
-  error = cleanComplex2D(*Atemp, 2, aux_size);
-  if(error)
-    return -6;
-
   return result;
 }
 
 
 
 
-int randMeasure1D(double complex ***A, options1D_t opts){
+int randMeasure1D(double complex ***A, options1D_t opts, rng_t *rng){
 
-  int mark, marked;
-  int m, diceA, diceB;
-  float sp;
+  int mark;
+  int j, m;
+  double diceA, sp, scale;
+  double complex site[2];
 
-  const int rbound = (opts.lattType == LINE_LATT) ? 
-    2*opts.max : opts.max-1;
+  const int size = (opts.lattType == LINE_LATT) ? 
+    2*opts.max+1 : opts.max;
 
+  if(!*A)
+    return -1;
+  if(opts.max<1)
+    return -2;
 
-  /* We get a new random number */
-  diceA = rand();
+  /* As in randMeasure2D, we jump from one measured site to the next 
+   * one with getSkip, and the state collapses to the first measured 
+   * site which makes sp greater than diceA.
+   */
+  diceA = getRandom(rng);
 
-  /* Now we scan the lattice checking if any point is measured */
   mark = -1;
-  marked=0;
-  sp=0.0;
-  for(m=0; m<=rbound; m++){
-    int j;
-    float prob;
+  sp = 0.0;
+  for(m=getSkip(rng, opts.dtProb, size); m<size; 
+      m+=1+getSkip(rng, opts.dtProb, size)){
+    double prob;
 
-    prob=0.0;
+    prob = 0.0;
     for(j=0; j<2; j++)
       prob += (*A)[j][m]*conj((*A)[j][m]);
 
-    diceB = rand();
-    if(diceB < opts.dtProb*RAND_MAX){ /* if site should be measured */
-      sp += prob;
-      if(diceA < sp*RAND_MAX && !marked){ /* if state collapsed to this site */
-	mark = m;
-	marked = 1;
-      }
-      else{
-	for(j=0; j<2; j++)
-	  (*A)[j][m] = 0.0;
-      }
+    sp += prob;
+    if(diceA < sp){ /* the state collapsed to this site */
+      mark = m;
+      break;
     }
-    
-  }/* end-for m */
 
-  for(m=0; m<=rbound; m++){
-      int j;
-
-      if(mark==-1){ /* measured the complement */
-	for(j=0; j<2; j++)
-	  (*A)[j][m] *= pow(1.0-sp, -0.5);
-
-      }else if(mark==m){ /* measured this site */
-	float prob;
-
-	prob = 0.0;
-	for(j=0; j<2; j++)
-	  prob += (*A)[j][m]*conj((*A)[j][m]);
+    for(j=0; j<2; j++)
+      (*A)[j][m] = 0.0;
+  }/* end-for m */
 
-	for(j=0; j<2; j++)
-	  (*A)[j][m] *= pow(prob, -0.5);
-	
+  if(mark >= 0){
+    double prob;
 
-      }else{ /* measured some other site */
-	
-	for(j=0; j<2; j++)
-	  (*A)[j][m] = 0.0;
+    prob = 0.0;
+    for(j=0; j<2; j++)
+      prob += (*A)[j][mark]*conj((*A)[j][mark]);
 
-      }
+    scale = 1.0/sqrt(prob);
+    for(j=0; j<2; j++)
+      site[j] = (*A)[j][mark]*scale;
 
-  }/* end-for m */
+    /* Only the collapsed site survives */
+    for(j=0; j<2; j++){
+      for(m=0; m<size; m++)
+	(*A)[j][m] = 0.0;
+      (*A)[j][mark] = site[j];
+    }
+  }
+  else{ /* measured the complement */
+    scale = 1.0/sqrt(1.0-sp);
+    for(j=0; j<2; j++)
+      for(m=0; m<size; m++)
+	(*A)[j][m] *= scale;
+  }
 
   return 0;
 }
@@ -21,7 +21,10 @@
 #include<stdlib.h>
 #include<complex.h>
 #include<math.h>
+#include<string.h>
+#include<stdint.h>
 #include "qwmem_complex.h"
+#include "qwconsts.h"
 
 
 double complex ****allocComplex4D(int dim1, int dim2, int dim3, int dim4){
@@ -347,3 +350,118 @@ int cleanComplex2D(double complex **vector, int dim1, int dim2){
 
   return 0;
 }
+
+
+
+/* Allocates the contiguous block of memory for a complex4D_t structure 
+ * whose dimensions and strides were already set.
+ */
+static complex4D_t allocBlock4D(complex4D_t tensor){
+  size_t size;
+
+  tensor.data = NULL;
+  tensor.block = NULL;
+
+  /* We allocate MEM_ALIGN extra bytes and move the pointer forward to
+   * the first aligned address inside the block.
+   */
+  size = SIZE4D(tensor)*sizeof(double complex);
+  tensor.block = malloc(size + MEM_ALIGN);
+  if(!tensor.block)
+    return tensor;
+
+  tensor.data = (double complex *)
+    (((uintptr_t)tensor.block + MEM_ALIGN - 1) & ~(uintptr_t)(MEM_ALIGN - 1));
+
+  return tensor;
+}
+
+
+
+complex4D_t allocTensor4D(int dim1, int dim2, int dim3, int dim4){
+  complex4D_t tensor;
+
+  tensor.data = NULL;
+  tensor.block = NULL;
+  tensor.dim[0] = dim1;
+  tensor.dim[1] = dim2;
+  tensor.dim[2] = dim3;
+  tensor.dim[3] = dim4;
+
+  if(dim1<1 || dim2<1 || dim3<1 || dim4<1)
+    return tensor;
+
+  tensor.stride[3] = 1;
+  tensor.stride[2] = (long)dim4;
+  tensor.stride[1] = (long)dim3*dim4;
+  tensor.stride[0] = (long)dim2*dim3*dim4;
+
+  return allocBlock4D(tensor);
+}
+
+
+
+complex4D_t allocSiteTensor4D(int dim1, int dim2, int dim3, int dim4){
+  complex4D_t tensor;
+
+  tensor.data = NULL;
+  tensor.block = NULL;
+  tensor.dim[0] = dim1;
+  tensor.dim[1] = dim2;
+  tensor.dim[2] = dim3;
+  tensor.dim[3] = dim4;
+
+  if(dim1<1 || dim2<1 || dim3<1 || dim4<1)
+    return tensor;
+
+  tensor.stride[1] = 1;
+  tensor.stride[0] = (long)dim2;
+  tensor.stride[3] = (long)dim1*dim2;
+  tensor.stride[2] = (long)dim1*dim2*dim4;
+
+  return allocBlock4D(tensor);
+}
+
+
+
+int freeTensor4D(complex4D_t *tensor){
+
+  if(!tensor || !tensor->block)
+    return 2;
+
+  free(tensor->block);
+  tensor->block = NULL;
+  tensor->data = NULL;
+
+  return 0;
+}
+
+
+
+int cleanTensor4D(complex4D_t tensor){
+
+  if(!tensor.data)
+    return 2;
+
+  /* All bits zero is the representation of 0.0 in IEEE 754 */
+  memset(tensor.data, 0, SIZE4D(tensor)*sizeof(double complex));
+
+  return 0;
+}
+
+
+
+int copyTensor4D(complex4D_t dest, complex4D_t src){
+  int i;
+
+  if(!dest.data || !src.data)
+    return 2;
+
+  for(i=0; i<4; i++)
+    if(dest.dim[i] != src.dim[i] || dest.stride[i] != src.stride[i])
+      return 1;
+
+  memcpy(dest.data, src.data, SIZE4D(src)*sizeof(double complex));
+
+  return 0;
+}
@@ -29,8 +29,8 @@
 #include "qwmem_int.h"
 #include "qwconsts.h"
 
-options2D_t readOptionsFile2D(const char *filename){
-  FILE *in;
+options2D_t readOptions2D(const inputfile_t *input){
+  inputfile_t cursor, *in = &cursor;
   options2D_t options;
   char keyword[100];
 
@@ -39,6 +39,7 @@ options2D_t readOptionsFile2D(const char *filename){
   options.stateType = HADAMARD_STATE;
   options.blType = NO_BROKENLINKS;
   options.lattType = NATURAL_LATT;
+  options.layout = COIN_LAYOUT;
 
   options.blProbA = 0.0;
   options.blProbB = 0.0;
@@ -46,10 +47,16 @@ options2D_t readOptionsFile2D(const char *filename){
 
   options.steps = 100;
   options.stepsMix = 0;
+  options.mixTol = 0.0;
+  options.mixError = 0.0;
   options.numOfExperiments = 1;
   options.stepsAfterMeasure = 0;
   options.lattextra = 1;
   options.max = options.steps + options.lattextra;
+  options.threads = 1;
+  options.expThreads = 0;
+  options.statEvery = 1;
+  options.fusedStats = 0;
 
   options.screen = 0;
   options.screen_pta[0] = 0;
@@ -64,35 +71,47 @@ options2D_t readOptionsFile2D(const char *filename){
   options.checkState = 0;
   options.checkXSymmetry = 0;
   options.checkYSymmetry = 0;
+  options.waveBinary = 0;
+  options.stateFile = NULL;
+  options.checkEvery = 0;
+  options.snapEvery = 0;
+  options.snapType = PROB_SNAPSHOT;
+  options.snapStride = 1;
+  options.resume = 0;
 
   options.seed = time(0);
 
+  /* The support of the initial state is only known after the state
+   * is created. Until then we use the whole lattice.
+   */
+  options.support.lo[0] = options.support.lo[1] = 0;
+  options.support.len[0] = options.support.len[1] = 0;
+
 
-  in = fopen(filename,"rt");
-  if(!in){
+  if(!input){
     options.error = 1;
     return options;
   }
+  cursor = *input;
 
-  /* In the next loop we seach the BEGIN keyword. */
-  do{
-    fscanf(in,"%s",keyword); 
-  }while(STRNEQ(keyword,"BEGIN") && !feof(in));
-
-  if(feof(in)){
+  /* We search the BEGIN keyword... */
+  if(!findKeyword(in,"BEGIN")){
     options.error = 9;
     return options;
   }
 
 
-  while(STRNEQ(keyword,"END")){
-    /* In this loop we read a sequence of keywords and interpret them. 
+  do{
+    /* ...and then we read a sequence of keywords and interpret them.
      * We finish when we find an END keyword.
      */
 
     int error = 0;
 
-    fscanf(in,"%s",keyword);
+    if(!scanString(in, keyword, sizeof(keyword))){
+      options.error = 9;
+      return options;
+    }
 
     if(STREQ(keyword,"COIN"))
       error = readOptions_coin2D(in, &options);
@@ -110,6 +129,8 @@ options2D_t readOptionsFile2D(const char *filename){
     }
     else if(STREQ(keyword,"MIXTIME"))
       error = readOptions_cmix2D(in, &options);
+    else if(STREQ(keyword,"MIXTOL"))
+      error = readOptions_mixtol2D(in, &options);
     else if(STREQ(keyword,"BLPROB"))
       error = readOptions_blprob2D(in, &options);
     else if(STREQ(keyword,"DTPROB"))
@@ -126,6 +147,22 @@ options2D_t readOptionsFile2D(const char *filename){
     }
     else if(STREQ(keyword,"LATTYPE"))
       error = readOptions_ltype2D(in, &options);
+    else if(STREQ(keyword,"THREADS"))
+      error = readOptions_threads2D(in, &options);
+    else if(STREQ(keyword,"EXPTHREADS"))
+      error = readOptions_expthreads2D(in, &options);
+    else if(STREQ(keyword,"FUSEDSTATS"))
+      error = readOptions_fused2D(&options);
+    else if(STREQ(keyword,"STATEVERY"))
+      error = readOptions_statevery2D(in, &options);
+    else if(STREQ(keyword,"WAVEFORMAT"))
+      error = readOptions_wformat2D(in, &options);
+    else if(STREQ(keyword,"CHECKPOINT"))
+      error = readOptions_checkpoint2D(in, &options);
+    else if(STREQ(keyword,"SNAPSHOT"))
+      error = readOptions_snapshot2D(in, &options);
+    else if(STREQ(keyword,"SNAPSTRIDE"))
+      error = readOptions_snapstride2D(in, &options);
     else if(STREQ(keyword,"DETECTORS"))
       error = readOptions_detec2D(in, &options);
     else if(STREQ(keyword,"SEED"))
@@ -134,21 +171,33 @@ options2D_t readOptionsFile2D(const char *filename){
       error = readOptions_screen2D(in, &options);
     else if(STREQ(keyword,"BLPERMANENT"))
       error = readOptions_blperm2D(in, &options);
+    else if(STREQ(keyword,"LAYOUT"))
+      error = readOptions_layout2D(in, &options);
 
     if(error)
       return options;
 
-  }/* end-while */
-
-  fclose(in);
+  }while(STRNEQ(keyword,"END"));
 
   options.error = 0;
   return options;
 }
 
 
-options1D_t readOptionsFile1D(const char *filename){
-  FILE *in;
+options2D_t readOptionsFile2D(const char *filename){
+  inputfile_t *in;
+  options2D_t options;
+
+  in = readInputFile(filename);
+  options = readOptions2D(in);
+  freeInputFile(in);
+
+  return options;
+}
+
+
+options1D_t readOptions1D(const inputfile_t *input){
+  inputfile_t cursor, *in = &cursor;
   options1D_t options;
   char keyword[100];
 
@@ -170,36 +219,46 @@ options1D_t readOptionsFile1D(const char *filename){
 
   options.seed = time(0); 
 
+  options.support.lo = 0;
+  options.support.len = 0;
+
   options.detectors = 0;
   options.detector_pts = NULL;
 
   options.stepsMix = 0;
+  options.mixTol = 0.0;
+  options.mixError = 0.0;
   options.calcMix = 0;
-
-  in = fopen(filename,"rt");
-  if(!in){
+  options.expThreads = 0;
+  options.statEvery = 1;
+  options.waveBinary = 0;
+  options.stateFile = NULL;
+  options.checkEvery = 0;
+  options.resume = 0;
+
+  if(!input){
     options.error = 1;
     return options;
   }
+  cursor = *input;
 
-  /* In the next loop we seach the BEGIN keyword. */
-  do{
-    fscanf(in, "%s", keyword); 
-  }while(STRNEQ(keyword,"BEGIN") && !feof(in));
-
-  if(feof(in)){
+  /* We search the BEGIN keyword... */
+  if(!findKeyword(in,"BEGIN")){
     options.error = 8;
     return options;
   }
 
-  while(STRNEQ(keyword,"END")){
-    /* In this loop we read a sequence of keywords and interpret them. 
+  do{
+    /* ...and then we read a sequence of keywords and interpret them.
      * We finish when we find an END keyword.
      */
 
     int error = 0;
 
-    fscanf(in,"%s",keyword);
+    if(!scanString(in, keyword, sizeof(keyword))){
+      options.error = 8;
+      return options;
+    }
 
     if(STREQ(keyword,"COIN"))
       error = readOptions_coin1D(in, &options);
@@ -233,19 +292,39 @@ options1D_t readOptionsFile1D(const char *filename){
     }
     else if(STREQ(keyword,"MIXTIME"))
       error = readOptions_cmix1D(in, &options);
+    else if(STREQ(keyword,"MIXTOL"))
+      error = readOptions_mixtol1D(in, &options);
     else if(STREQ(keyword,"DETECTORS"))
       error = readOptions_detec1D(in, &options);
     else if(STREQ(keyword,"AFTERMEASURE"))
       error = readOptions_afterm1D(in, &options);
+    else if(STREQ(keyword,"EXPTHREADS"))
+      error = readOptions_expthreads1D(in, &options);
+    else if(STREQ(keyword,"STATEVERY"))
+      error = readOptions_statevery1D(in, &options);
+    else if(STREQ(keyword,"WAVEFORMAT"))
+      error = readOptions_wformat1D(in, &options);
+    else if(STREQ(keyword,"CHECKPOINT"))
+      error = readOptions_checkpoint1D(in, &options);
 
 
     if(error) 
       return options;
 
-  }/* end-while */
-
-  fclose(in);
+  }while(STRNEQ(keyword,"END"));
 
   options.error = 0;
   return options;
 }
+
+
+options1D_t readOptionsFile1D(const char *filename){
+  inputfile_t *in;
+  options1D_t options;
+
+  in = readInputFile(filename);
+  options = readOptions1D(in);
+  freeInputFile(in);
+
+  return options;
+}
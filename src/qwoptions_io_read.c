@@ -28,7 +28,26 @@
 #include "qwmem_int.h"
 #include "qwconsts.h"
 
-int readOptions_coin2D(FILE *in, options2D_t *options){
+/* Reads the name of a file (see STATE FILE) and stores a copy of it in
+ * *name. Returns 1 if there is no name or not enough memory.
+ */
+static int readStateFilename(inputfile_t *in, char **name){
+  const char *token = nextToken(in);
+
+  if(!token)
+    return 1;
+
+  free(*name);
+  *name = (char *)malloc(strlen(token)+1);
+  if(!*name)
+    return 1;
+  strcpy(*name, token);
+
+  return 0;
+}
+
+
+int readOptions_coin2D(inputfile_t *in, options2D_t *options){
   /* If a COIN keyword is found, then we expect one of the keywords:
    * FOURIER, HADAMARD, GROVER or CUSTOM. The last one requires the 
    * definition of the coin in a different file or in a separate part 
@@ -37,7 +56,7 @@ int readOptions_coin2D(FILE *in, options2D_t *options){
 
   char keyword[100];
 
-  fscanf(in,"%s",keyword); 
+  scanString(in, keyword, sizeof(keyword)); 
    
   if(STREQ(keyword,"CUSTOM"))
     options->coinType=CUSTOM_COIN;
@@ -56,20 +75,28 @@ int readOptions_coin2D(FILE *in, options2D_t *options){
 }
 
 
-int readOptions_state2D(FILE *in, options2D_t *options){
+int readOptions_state2D(inputfile_t *in, options2D_t *options){
   /* If a STATE keyword is found, then we expect one of the keywords:
-   * FOURIER, HADAMARD, GROVER or CUSTOM. The last one requires the 
+   * FOURIER, HADAMARD, GROVER, CUSTOM or FILE. CUSTOM requires the 
    * definition of the initial state in a different file of in a
    * separate part of the same input file, using the keywords 
-   * BEGINSTATE and ENDSTATE
+   * BEGINSTATE and ENDSTATE. FILE must be followed by the name of a
+   * binary state file (see writeStateBinary2D).
    */
   
   char keyword[100];
 
-  fscanf(in,"%s",keyword);    
+  scanString(in, keyword, sizeof(keyword));    
 
   if(STREQ(keyword,"CUSTOM"))
     options->stateType=CUSTOM_STATE;
+  else if(STREQ(keyword,"FILE")){
+    options->stateType=FILE_STATE;
+    if(readStateFilename(in, &options->stateFile)){
+      options->error = 3;
+      return 3;
+    }
+  }
   else if(STREQ(keyword,"FOURIER"))
     options->stateType=FOURIER_STATE;
   else if(STREQ(keyword,"GROVER"))
@@ -85,14 +112,14 @@ int readOptions_state2D(FILE *in, options2D_t *options){
 }
 
 
-int readOptions_steps2D(FILE *in, options2D_t *options){
+int readOptions_steps2D(inputfile_t *in, options2D_t *options){
   /* If a STEPS keyword is found then we expect then a positive 
    * integer containing the number of steps that will be simulated.
    * NOTE: If LATTEXTRA and LATTSIZE keywords are used, STEPS must
    * come after LATTEXTRA and before LATTSIZE.
    */
 
-  fscanf(in,"%d",&(options->steps)); 
+  scanInt(in, &(options->steps)); 
   if(options->steps<1){
     options->error = 4;
     return 4;
@@ -109,13 +136,13 @@ int readOptions_steps2D(FILE *in, options2D_t *options){
 }
 
 
-int readOptions_afterm2D(FILE *in, options2D_t *options){
+int readOptions_afterm2D(inputfile_t *in, options2D_t *options){
   /* If a AFTERMEASURE keyword is found then we expect a non-negative
    * integer describing the number of steps that will be simulated
    * after a measurement returns a non-trivial result.
    */
   
-  fscanf(in, "%d", &(options->stepsAfterMeasure));
+  scanInt(in, &(options->stepsAfterMeasure));
 
   if(options->stepsAfterMeasure<0){
     options->error = 4;
@@ -126,7 +153,7 @@ int readOptions_afterm2D(FILE *in, options2D_t *options){
 }
 
 
-int readOptions_check2D(FILE *in, options2D_t *options){
+int readOptions_check2D(inputfile_t *in, options2D_t *options){
   /* If a CHECK keyword is found, then we expect one of the 
    * keywords: STATEPROB, XSYMMETRY, YSYMMETRY or DAGGER. 
    * If STATEPROB is found then the programm will check in each
@@ -140,7 +167,7 @@ int readOptions_check2D(FILE *in, options2D_t *options){
 
   char keyword[100];
 
-  fscanf(in, "%s", keyword);
+  scanString(in, keyword, sizeof(keyword));
 
   if(STREQ(keyword,"STATEPROB"))
     options->checkState = 1;
@@ -157,13 +184,13 @@ int readOptions_check2D(FILE *in, options2D_t *options){
 }
 
 
-int readOptions_cmix2D(FILE *in, options2D_t *options){
+int readOptions_cmix2D(inputfile_t *in, options2D_t *options){
   /* If a CALCMIX keyword is found, then we expect a non-negative integer
    * describing how many steps will be used in the approximation of the
    * stationary distribution.
    */
 
-  fscanf(in,"%d",&(options->stepsMix));
+  scanInt(in, &(options->stepsMix));
   if(options->stepsMix < 0){
     options->error = 12;
     return 12;
@@ -177,18 +204,37 @@ int readOptions_cmix2D(FILE *in, options2D_t *options){
   return 0;
 }
 
-int readOptions_blprob2D(FILE *in, options2D_t *options){
+
+int readOptions_mixtol2D(inputfile_t *in, options2D_t *options){
+  /* If a MIXTOL keyword is found, then we expect a positive real number
+   * giving the tolerance of the approximation of the stationary 
+   * distribution. The average distribution is compared at checkpoints
+   * whose distance doubles each time, and the calculation stops when the
+   * L1 distance between two consecutive checkpoints is smaller than the
+   * tolerance. MIXTIME remains the maximum number of steps.
+   */
+
+  scanFloat(in, &(options->mixTol));
+  if(!(options->mixTol > 0.0)){
+    options->error = 18;
+    return 18;
+  }
+
+  return 0;
+}
+
+int readOptions_blprob2D(inputfile_t *in, options2D_t *options){
   /* If a BLPROB keyword is found, then we expect two non-negative 
    * real (double precision) numbers describing the probability of 
    * broken links in each direction.
    */
   
-  fscanf(in,"%f",&(options->blProbA)); 
+  scanFloat(in, &(options->blProbA)); 
   if((options->blProbA < 0.0) || (options->blProbA > 1.0)){
     options->error = 11;
     return 11;
   }
-  fscanf(in,"%f",&(options->blProbB)); 
+  scanFloat(in, &(options->blProbB)); 
   if((options->blProbB < 0.0) || (options->blProbB > 1.0)){
     options->error = 11;
     return 11;
@@ -199,13 +245,13 @@ int readOptions_blprob2D(FILE *in, options2D_t *options){
 
 
 
-int readOptions_dtprob2D(FILE *in, options2D_t *options){
+int readOptions_dtprob2D(inputfile_t *in, options2D_t *options){
   /* If a DTPROB keyword is found, then we expect a non-negative 
    * real (double precision) number describing the probability of 
    * measurement in each lattice site
    */
   
-  fscanf(in,"%f",&(options->dtProb)); 
+  scanFloat(in, &(options->dtProb)); 
   if((options->dtProb < 0.0) || (options->dtProb > 1.0)){
     options->error = 11;
     return 11;
@@ -216,13 +262,13 @@ int readOptions_dtprob2D(FILE *in, options2D_t *options){
 
 
 
-int readOptions_exp2D(FILE *in, options2D_t *options){
+int readOptions_exp2D(inputfile_t *in, options2D_t *options){
   /* If a EXPERIMENTS keyword is found then we expect a positive
    * integer describing the number of experiments that will be
    * carried out.
    */
 
-  fscanf(in, "%d", &(options->numOfExperiments));
+  scanInt(in, &(options->numOfExperiments));
   if(options->numOfExperiments<1){
     options->error = 6;
     return 6;
@@ -232,7 +278,7 @@ int readOptions_exp2D(FILE *in, options2D_t *options){
 }
 
 
-int readOptions_lsize2D(FILE *in, options2D_t *options){
+int readOptions_lsize2D(inputfile_t *in, options2D_t *options){
   /* If a LATTSIZE keyword is found then we expect a positive
    * integer describing the size of the lattice. We consider
    * that the lattice ranges from -options.max to options.max
@@ -244,7 +290,7 @@ int readOptions_lsize2D(FILE *in, options2D_t *options){
    * must come last.
    */
 
-  fscanf(in, "%d", &(options->max));
+  scanInt(in, &(options->max));
   if(options->max<1){
     options->error=7;
     return 7;
@@ -256,7 +302,7 @@ int readOptions_lsize2D(FILE *in, options2D_t *options){
 }
 
 
-int readOptions_lextra2D(FILE *in, options2D_t *options){
+int readOptions_lextra2D(inputfile_t *in, options2D_t *options){
   /* If a LATTEXTRA keyword is found then we expect a non-negative
    * integer describing the extra space reserved for the lattice.
    * This options is very important, for example, when the initial
@@ -265,7 +311,7 @@ int readOptions_lextra2D(FILE *in, options2D_t *options){
    * come first.
    */
 
-  fscanf(in, "%d", &(options->lattextra));
+  scanInt(in, &(options->lattextra));
   if(options->lattextra<0){
     options->error=10;
     return 10;
@@ -275,7 +321,7 @@ int readOptions_lextra2D(FILE *in, options2D_t *options){
 }
 
 
-int readOptions_ltype2D(FILE *in, options2D_t *options){
+int readOptions_ltype2D(inputfile_t *in, options2D_t *options){
   /* If a LATTTYPE keyword is found, then we expect one of the keywords:
    * NATURAL or DIAGONAL. If DIAGONAL keyword is found, the simulador
    * will use the evolution equation which makes the physical lattice
@@ -286,7 +332,7 @@ int readOptions_ltype2D(FILE *in, options2D_t *options){
 
   char keyword[100];
 
-  fscanf(in, "%s", keyword);
+  scanString(in, keyword, sizeof(keyword));
 
   if(STREQ(keyword,"NATURAL"))
     options->lattType = NATURAL_LATT;
@@ -317,7 +363,7 @@ int readOptions_ltype2D(FILE *in, options2D_t *options){
 
 
 
-int readOptions_detec2D(FILE *in, options2D_t *options){
+int readOptions_detec2D(inputfile_t *in, options2D_t *options){
   /* If a DETECTORS keyword is found then we expect a positive integer,
    * describing the number of detectors used in the simulation. After
    * that, for each detector we expect two integers describing the
@@ -326,7 +372,7 @@ int readOptions_detec2D(FILE *in, options2D_t *options){
   
   int i;
   
-  fscanf(in, "%d", &(options->detectors));
+  scanInt(in, &(options->detectors));
   if(options->detectors<1){
     options->error=8;
     return 8;
@@ -339,27 +385,27 @@ int readOptions_detec2D(FILE *in, options2D_t *options){
   }
 
   for(i=1; i<=options->detectors; i++){
-    fscanf(in, "%d", &(options->detector_pts[i][0]));
-    fscanf(in, "%d", &(options->detector_pts[i][1]));
+    scanInt(in, &(options->detector_pts[i][0]));
+    scanInt(in, &(options->detector_pts[i][1]));
   }
 
   return 0;
 }
 
 
-int readOptions_seed2D(FILE *in, options2D_t *options){
+int readOptions_seed2D(inputfile_t *in, options2D_t *options){
   /* If a SEED keyword is found then we expect an integer describing
    * a seed for the pseudorandom number generator.
    */
     
-  fscanf(in, "%d", &(options->seed));
+  scanInt(in, &(options->seed));
   options->seed = abs(options->seed);
 
   return 0;
 }
 
 
-int readOptions_screen2D(FILE *in, options2D_t *options){
+int readOptions_screen2D(inputfile_t *in, options2D_t *options){
   /* If a SCREEN keyword is found, then we expect four integers
    * describing its position. The first two integers, say xa and
    * ya, describe the first point, (xa,ya). The next two integers,
@@ -369,16 +415,16 @@ int readOptions_screen2D(FILE *in, options2D_t *options){
    */
 
   options->screen = 1;
-  fscanf(in,"%d",&(options->screen_pta[0])); 
-  fscanf(in,"%d",&(options->screen_pta[1])); 
-  fscanf(in,"%d",&(options->screen_ptb[0])); 
-  fscanf(in,"%d",&(options->screen_ptb[1])); 
+  scanInt(in, &(options->screen_pta[0])); 
+  scanInt(in, &(options->screen_pta[1])); 
+  scanInt(in, &(options->screen_ptb[0])); 
+  scanInt(in, &(options->screen_ptb[1])); 
 
   return 0;
 }
 
 
-int readOptions_blperm2D(FILE *in, options2D_t *options){
+int readOptions_blperm2D(inputfile_t *in, options2D_t *options){
   /* If a BLPERMANENT keyword is found we set the field blType 
    * in options2D_t structure as PERMANENT_BROKENLINKS, so that 
    * the program reads the broken links file later.
@@ -389,7 +435,189 @@ int readOptions_blperm2D(FILE *in, options2D_t *options){
 }
 
 
-int readOptions_coin1D(FILE *in, options1D_t *options){
+int readOptions_layout2D(inputfile_t *in, options2D_t *options){
+  /* If a LAYOUT keyword is found, then we expect one of the keywords:
+   * COIN or SITE. If COIN keyword is found, the amplitudes are stored
+   * coin-major, i.e., one whole lattice for each coin state. If SITE
+   * keyword is found, the four amplitudes of each site are stored
+   * next to each other, which is friendlier to the cache during the
+   * evolution. The results do not depend on this option.
+   */
+
+  char keyword[100];
+
+  scanString(in, keyword, sizeof(keyword));
+
+  if(STREQ(keyword,"COIN"))
+    options->layout = COIN_LAYOUT;
+  else if(STREQ(keyword,"SITE"))
+    options->layout = SITE_LAYOUT;
+  else{
+    options->error = 14;
+    return 14;
+  }
+
+  return 0;
+}
+
+
+int readOptions_threads2D(inputfile_t *in, options2D_t *options){
+  /* If a THREADS keyword is found then we expect a positive integer
+   * containing the number of threads used in the evolution. If the
+   * program was compiled without OpenMP the option has no effect.
+   */
+
+  scanInt(in, &(options->threads));
+  if(options->threads<1){
+    options->error = 15;
+    return 15;
+  }
+
+#ifndef _OPENMP
+  if(options->threads>1)
+    printf("Warning: compiled without OpenMP. THREADS will be ignored.\n");
+#endif
+
+  return 0;
+}
+
+
+int readOptions_fused2D(options2D_t *options){
+  /* If a FUSEDSTATS keyword is found the statistics, the mixing time
+   * sums and distances and the screen are computed by iterate2D while
+   * each row of the state is updated, instead of in separate passes 
+   * (see observables2D_t). 
+   */
+
+  options->fusedStats = 1;
+  return 0;
+}
+
+
+int readOptions_statevery2D(inputfile_t *in, options2D_t *options){
+  /* If a STATEVERY keyword is found then we expect a positive integer
+   * n. The statistics are computed and written only in the steps which
+   * are multiples of n, and in the last step.
+   */
+
+  scanInt(in, &(options->statEvery));
+  if(options->statEvery<1){
+    options->error = 17;
+    return 17;
+  }
+
+  return 0;
+}
+
+
+int readOptions_wformat2D(inputfile_t *in, options2D_t *options){
+  /* If a WAVEFORMAT keyword is found then we expect TEXT (the default)
+   * or BINARY. With BINARY the final wave-function is written in a 
+   * binary state file (see writeStateBinary2D), which may be used as
+   * the initial state of another simulation (see STATE FILE).
+   */
+
+  char keyword[100];
+
+  scanString(in, keyword, sizeof(keyword));
+  if(STREQ(keyword,"TEXT"))
+    options->waveBinary = 0;
+  else if(STREQ(keyword,"BINARY"))
+    options->waveBinary = 1;
+  else{
+    options->error = 19;
+    return 19;
+  }
+
+  return 0;
+}
+
+
+int readOptions_checkpoint2D(inputfile_t *in, options2D_t *options){
+  /* If a CHECKPOINT keyword is found then we expect a positive integer
+   * n. The simulation is saved in a checkpoint file every n steps, and
+   * it may be continued from there with the option --resume.
+   */
+
+  scanInt(in, &(options->checkEvery));
+  if(options->checkEvery<1){
+    options->error = 20;
+    return 20;
+  }
+
+  return 0;
+}
+
+
+int readOptions_snapshot2D(inputfile_t *in, options2D_t *options){
+  /* If a SNAPSHOT keyword is found then we expect a positive integer n
+   * followed by PROB or WAVE. The probabilities (PROB) or the amplitudes
+   * (WAVE) of the last experiment are written in the snapshot file
+   * every n steps (see qwsnapshot.h).
+   */
+
+  char keyword[100];
+
+  scanInt(in, &(options->snapEvery));
+  scanString(in, keyword, sizeof(keyword));
+  if(options->snapEvery<1){
+    options->error = 21;
+    return 21;
+  }
+
+  if(STREQ(keyword,"PROB"))
+    options->snapType = PROB_SNAPSHOT;
+  else if(STREQ(keyword,"WAVE"))
+    options->snapType = WAVE_SNAPSHOT;
+  else{
+    options->error = 21;
+    return 21;
+  }
+
+  return 0;
+}
+
+
+int readOptions_snapstride2D(inputfile_t *in, options2D_t *options){
+  /* If a SNAPSTRIDE keyword is found then we expect a positive integer
+   * d. The snapshots keep one site out of d in each direction: with 
+   * PROB each value is the sum of a block of d x d sites, and with WAVE
+   * only the sites whose coordinates are multiples of d are kept.
+   */
+
+  scanInt(in, &(options->snapStride));
+  if(options->snapStride<1){
+    options->error = 21;
+    return 21;
+  }
+
+  return 0;
+}
+
+
+int readOptions_expthreads2D(inputfile_t *in, options2D_t *options){
+  /* If an EXPTHREADS keyword is found then we expect a positive integer
+   * containing the number of experiments that run at the same time. 
+   * Each experiment has its own stream of random numbers, so the results
+   * depend on the seed but not on the number of threads.
+   */
+
+  scanInt(in, &(options->expThreads));
+  if(options->expThreads<1){
+    options->error = 16;
+    return 16;
+  }
+
+#ifndef _OPENMP
+  if(options->expThreads>1)
+    printf("Warning: compiled without OpenMP. Experiments will run one at a time.\n");
+#endif
+
+  return 0;
+}
+
+
+int readOptions_coin1D(inputfile_t *in, options1D_t *options){
   /* If a COIN keyword is found, we expect then one of the keywords:
    * HADAMARD or CUSTOM. The last one requires the definition
    * of the coin in a different file or in a separate part of the 
@@ -398,7 +626,7 @@ int readOptions_coin1D(FILE *in, options1D_t *options){
 
   char keyword[100];
 
-  fscanf(in,"%s",keyword);    
+  scanString(in, keyword, sizeof(keyword));    
   if(STREQ(keyword,"CUSTOM"))
     options->coinType=CUSTOM_COIN;
   else if(STREQ(keyword,"HADAMARD"))
@@ -412,19 +640,23 @@ int readOptions_coin1D(FILE *in, options1D_t *options){
 }
 
 
-int readOptions_state1D(FILE *in, options1D_t *options){
+int readOptions_state1D(inputfile_t *in, options1D_t *options){
   /* If a STATE keyword is found, then we expect one of the 
-   * keywords: HADAMARD or CUSTOM. The last one requires the 
-   * definition of the initial state in a different file or in a
-   * separate part of the same input file, using the keywords 
-   * BEGINSTATE and ENDSTATE
+   * keywords: HADAMARD, CUSTOM or FILE (see readOptions_state2D). 
    */
   
   char keyword[100];
   
-  fscanf(in,"%s",keyword);    
+  scanString(in, keyword, sizeof(keyword));    
   if(STREQ(keyword,"CUSTOM"))
     options->stateType=CUSTOM_STATE;
+  else if(STREQ(keyword,"FILE")){
+    options->stateType=FILE_STATE;
+    if(readStateFilename(in, &options->stateFile)){
+      options->error = 3;
+      return 3;
+    }
+  }
   else if(STREQ(keyword,"HADAMARD"))
     options->stateType=HADAMARD_STATE;
   else{
@@ -436,13 +668,13 @@ int readOptions_state1D(FILE *in, options1D_t *options){
 }
 
 
-int readOptions_steps1D(FILE *in, options1D_t *options){
+int readOptions_steps1D(inputfile_t *in, options1D_t *options){
   /* If a STEPS keyword is found, then we expect a positive 
    * integer containing the number of steps that will be 
    * simulated.
    */
   
-  fscanf(in,"%d",&(options->steps)); 
+  scanInt(in, &(options->steps)); 
   if(options->steps<1){
     options->error = 4;
     return 4;
@@ -459,7 +691,7 @@ int readOptions_steps1D(FILE *in, options1D_t *options){
 }
 
 
-int readOptions_check1D(FILE *in, options1D_t *options){
+int readOptions_check1D(inputfile_t *in, options1D_t *options){
   /* If a CHECK keyword is found, then we expect one of the 
    * keywords: STATEPROB, SYMMETRY or DAGGER. 
    * If STATEPROB is found then the programm will check in each
@@ -472,7 +704,7 @@ int readOptions_check1D(FILE *in, options1D_t *options){
 
   char keyword[100];
 
-  fscanf(in, "%s", keyword);
+  scanString(in, keyword, sizeof(keyword));
   if(STREQ(keyword,"STATEPROB"))
     options->checkState = 1;
   else if(STREQ(keyword,"SYMMETRY"))
@@ -484,14 +716,14 @@ int readOptions_check1D(FILE *in, options1D_t *options){
 }
 
 
-int readOptions_blprob1D(FILE *in, options1D_t *options){
+int readOptions_blprob1D(inputfile_t *in, options1D_t *options){
   /* If a BLPROB keyword is found, then we expect then a positive 
    * float containing the probability of broken links in the simulation,
    * i.e., in each simulation step each link has this probability of 
    * being open.
    */
   
-  fscanf(in,"%f",&(options->blProb)); 
+  scanFloat(in, &(options->blProb)); 
   if((options->blProb < 0.0) || (options->blProb > 1.0)){
     options->error = 6;
     return 6;
@@ -502,13 +734,13 @@ int readOptions_blprob1D(FILE *in, options1D_t *options){
 
 
 
-int readOptions_dtprob1D(FILE *in, options1D_t *options){
+int readOptions_dtprob1D(inputfile_t *in, options1D_t *options){
   /* If a DTPROB keyword is found, then we expect a non-negative 
    * real (double precision) number describing the probability of 
    * measurement in each lattice site
    */
   
-  fscanf(in,"%f",&(options->dtProb)); 
+  scanFloat(in, &(options->dtProb)); 
   if((options->dtProb < 0.0) || (options->dtProb > 1.0)){
     options->error = 13;
     return 13;
@@ -519,13 +751,13 @@ int readOptions_dtprob1D(FILE *in, options1D_t *options){
 
 
 
-int readOptions_exp1D(FILE *in, options1D_t *options){
+int readOptions_exp1D(inputfile_t *in, options1D_t *options){
   /* If EXPERIMENTS keyword is found, then we expect a positive 
    * integer containing the experiments that will be carried out 
    * (useful for simulations involving random broken links).
    */
 
-  fscanf(in,"%d",&(options->numOfExperiments)); 
+  scanInt(in, &(options->numOfExperiments)); 
   if(options->numOfExperiments < 1){
     options->error = 7;
     return 7;
@@ -535,19 +767,19 @@ int readOptions_exp1D(FILE *in, options1D_t *options){
 }
 
 
-int readOptions_seed1D(FILE *in, options1D_t *options){
+int readOptions_seed1D(inputfile_t *in, options1D_t *options){
   /* If a SEED keyword is found then we expect an integer describing
    * a seed for the pseudorandom number generator.
    */
     
-  fscanf(in, "%d", &(options->seed));
+  scanInt(in, &(options->seed));
   options->seed = abs(options->seed);
 
   return 0;
 }
 
 
-int readOptions_lsize1D(FILE *in, options1D_t *options){
+int readOptions_lsize1D(inputfile_t *in, options1D_t *options){
   /* If a LATTSIZE keyword is found then we expect a positive
    * integer describing the size of the lattice. We consider
    * that the lattice ranges from -options.max to options.max
@@ -558,7 +790,7 @@ int readOptions_lsize1D(FILE *in, options1D_t *options){
    * must come last.
    */
 
-  fscanf(in, "%d", &(options->max));
+  scanInt(in, &(options->max));
   if(options->max < 1){
     options->error = 9;
     return 9;
@@ -570,7 +802,7 @@ int readOptions_lsize1D(FILE *in, options1D_t *options){
 }
 
 
-int readOptions_lextra1D(FILE *in, options1D_t *options){
+int readOptions_lextra1D(inputfile_t *in, options1D_t *options){
   /* If a LATTEXTRA keyword is found then we expect a non-negative
    * integer describing the extra space reserved for the lattice.
    * This options is very important, for example, when the initial
@@ -579,7 +811,7 @@ int readOptions_lextra1D(FILE *in, options1D_t *options){
    * come first.
    */
 
-  fscanf(in, "%d", &(options->lattextra));
+  scanInt(in, &(options->lattextra));
   if(options->lattextra < 0){
     options->error=10;
     return 10;
@@ -588,7 +820,7 @@ int readOptions_lextra1D(FILE *in, options1D_t *options){
   return 0;
 }
 
-int readOptions_ltype1D(FILE *in, options1D_t *options){
+int readOptions_ltype1D(inputfile_t *in, options1D_t *options){
   /* If a LATTTYPE keyword is found, then we expect one of the keywords:
    * LINE, CYCLE or SEGMENT. If LINE keyword is found, the simulador
    * will use the evolution equation for an infinite one-dimensional
@@ -601,7 +833,7 @@ int readOptions_ltype1D(FILE *in, options1D_t *options){
 
   char keyword[100];
 
-  fscanf(in, "%s", keyword);
+  scanString(in, keyword, sizeof(keyword));
 
   if(STREQ(keyword,"LINE"))
     options->lattType = LINE_LATT;
@@ -638,13 +870,13 @@ int readOptions_ltype1D(FILE *in, options1D_t *options){
 }
 
 
-int readOptions_cmix1D(FILE *in, options1D_t *options){
+int readOptions_cmix1D(inputfile_t *in, options1D_t *options){
   /* If a CALCMIX keyword is found, then we expect a non-negative integer
    * describing how many steps will be used in the approximation of the
    * stationary distribution.
    */
 
-  fscanf(in,"%d",&(options->stepsMix));
+  scanInt(in, &(options->stepsMix));
   if(options->stepsMix < 0){
     options->error = 12;
     return 12;
@@ -658,7 +890,22 @@ int readOptions_cmix1D(FILE *in, options1D_t *options){
 }
 
 
-int readOptions_detec1D(FILE *in, options1D_t *options){
+int readOptions_mixtol1D(inputfile_t *in, options1D_t *options){
+  /* If a MIXTOL keyword is found, then we expect a positive real number
+   * (see readOptions_mixtol2D).
+   */
+
+  scanFloat(in, &(options->mixTol));
+  if(!(options->mixTol > 0.0)){
+    options->error = 17;
+    return 17;
+  }
+
+  return 0;
+}
+
+
+int readOptions_detec1D(inputfile_t *in, options1D_t *options){
   /* If a DETECTORS keyword is found then we expect a positive integer,
    * describing the number of detectors used in the simulation. After
    * that, for each detector we expect one integers describing the
@@ -667,7 +914,7 @@ int readOptions_detec1D(FILE *in, options1D_t *options){
   
   int i;
   
-  fscanf(in, "%d", &(options->detectors));
+  scanInt(in, &(options->detectors));
   if(options->detectors<1){
     options->error=8;
     return 14;
@@ -680,18 +927,18 @@ int readOptions_detec1D(FILE *in, options1D_t *options){
   }
 
   for(i=1; i<=options->detectors; i++)
-    fscanf(in, "%d", &(options->detector_pts[i]));
+    scanInt(in, &(options->detector_pts[i]));
 
   return 0;
 }
 
-int readOptions_afterm1D(FILE *in, options1D_t *options){
+int readOptions_afterm1D(inputfile_t *in, options1D_t *options){
   /* If a AFTERMEASURE keyword is found then we expect a non-negative
    * integer describing the number of steps that will be simulated
    * after a measurement returns a non-trivial result.
    */
   
-  fscanf(in, "%d", &(options->stepsAfterMeasure));
+  scanInt(in, &(options->stepsAfterMeasure));
 
   if(options->stepsAfterMeasure<0){
     options->error = 4;
@@ -702,3 +949,71 @@ int readOptions_afterm1D(FILE *in, options1D_t *options){
 }
 
 
+int readOptions_expthreads1D(inputfile_t *in, options1D_t *options){
+  /* If an EXPTHREADS keyword is found then we expect a positive integer
+   * containing the number of experiments that run at the same time
+   * (see readOptions_expthreads2D).
+   */
+
+  scanInt(in, &(options->expThreads));
+  if(options->expThreads<1){
+    options->error = 15;
+    return 15;
+  }
+
+#ifndef _OPENMP
+  if(options->expThreads>1)
+    printf("Warning: compiled without OpenMP. Experiments will run one at a time.\n");
+#endif
+
+  return 0;
+}
+
+
+int readOptions_statevery1D(inputfile_t *in, options1D_t *options){
+  /* If a STATEVERY keyword is found then we expect a positive integer
+   * (see readOptions_statevery2D).
+   */
+
+  scanInt(in, &(options->statEvery));
+  if(options->statEvery<1){
+    options->error = 16;
+    return 16;
+  }
+
+  return 0;
+}
+
+
+int readOptions_wformat1D(inputfile_t *in, options1D_t *options){
+  /* If a WAVEFORMAT keyword is found then we expect TEXT or BINARY
+   * (see readOptions_wformat2D).
+   */
+
+  char keyword[100];
+
+  scanString(in, keyword, sizeof(keyword));
+  if(STREQ(keyword,"TEXT"))
+    options->waveBinary = 0;
+  else if(STREQ(keyword,"BINARY"))
+    options->waveBinary = 1;
+  else{
+    options->error = 18;
+    return 18;
+  }
+
+  return 0;
+}
+
+
+int readOptions_checkpoint1D(inputfile_t *in, options1D_t *options){
+  /* See readOptions_checkpoint2D */
+
+  scanInt(in, &(options->checkEvery));
+  if(options->checkEvery<1){
+    options->error = 19;
+    return 19;
+  }
+
+  return 0;
+}
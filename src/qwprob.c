@@ -23,38 +23,50 @@
 #include<math.h>
 #include "qwoptions_io.h"
 #include "qwmem_real.h"
+#include "qwmem_complex.h"
+#include "qwstate.h"
 #include "qwprob.h"
 #include "qwconsts.h"
 
-double **getProbArray2D(double complex ****matrix, options2D_t opts){
-  int m,n,j,k;
+double **getProbArray2D(complex4D_t matrix, options2D_t opts, int steps){
+  int m,n,j,k,ir,ic,nrows,ncols;
+  int rows[2][2], cols[2][2];
   double **probMatrix, totalprob;
   const int rbound = (opts.lattType == CYCLE_LATT) ?
     opts.max : 2*opts.max+1;
+  const support2D_t supp = getSupport2D(opts, steps);
 
 
   probMatrix = allocReal2D(rbound, rbound);
   if(!probMatrix)
     return NULL;
+  cleanReal2D(probMatrix, rbound, rbound);
 
-  totalprob = 0.0;
-  for(m=0; m<rbound; m++){
-    for(n=0; n<rbound; n++){
-      double aux;
-
-      aux = 0.0;
-      for(j=0; j<2; j++){
-	for(k=0; k<2; k++){
-
-	  aux += matrix[j][k][m][n]*conj(matrix[j][k][m][n]);
-
-	}/* end-for k */
-      }/* end-for j */
-      probMatrix[m][n] = aux;
-      totalprob += probMatrix[m][n];
+  nrows = getSupportRanges(supp.lo[0], supp.len[0], rbound, rows);
+  ncols = getSupportRanges(supp.lo[1], supp.len[1], rbound, cols);
 
-    }/* end-for n */
-  }/* end-for m */
+  totalprob = 0.0;
+  for(ir=0; ir<nrows; ir++){
+    for(m=rows[ir][0]; m<rows[ir][1]; m++){
+      for(ic=0; ic<ncols; ic++){
+	for(n=cols[ic][0]; n<cols[ic][1]; n++){
+	  double aux;
+
+	  aux = 0.0;
+	  for(j=0; j<2; j++){
+	    for(k=0; k<2; k++){
+
+	      aux += ENTRY4D(matrix,j,k,m,n)*conj(ENTRY4D(matrix,j,k,m,n));
+
+	    }/* end-for k */
+	  }/* end-for j */
+	  probMatrix[m][n] = aux;
+	  totalprob += probMatrix[m][n];
+
+	}/* end-for n */
+      }
+    }/* end-for m */
+  }
 
   if( fabs(totalprob-1.0) > WALK_TOL ){
     printf("Warning: probability of finding the particle in the lattice is %e\n",
@@ -133,31 +145,27 @@ int averageProbFromState1D(double **aveMatrix, double complex **state,
 			   options1D_t options){
 
   int m;
-  static int flag=0;
   const int rbound = (options.lattType == LINE_LATT) ?
     2*options.max+1 : options.max;
 
-  if(options.numOfExperiments<1 || flag>options.numOfExperiments )
+  if(options.numOfExperiments<1)
     return 1;
+  if(!aveMatrix)
+    return 2;
 
-  /* If the function is called for the first time */
-  if(!flag){
+  /* If the vector was not allocated yet, this is the first experiment */
+  if(!*aveMatrix){
 
-    if(!aveMatrix)
-      return 2;
     *aveMatrix = getProbArray1D(state, options);
     if(!*aveMatrix)
       return 3;
     for(m=0; m<rbound; m++)
       (*aveMatrix)[m] /= options.numOfExperiments;
 
-    flag++;
     return 0;
   }
 
   /* Now, subsequent calls are treated */
-  if(!*aveMatrix)
-    return 4;
 
   for(m=0; m<rbound; m++){
     int j;
@@ -170,56 +178,59 @@ int averageProbFromState1D(double **aveMatrix, double complex **state,
     (*aveMatrix)[m] += (prob/options.numOfExperiments);
   }
 
-  flag++;
   return 0;
 }
 
-int averageProbFromState2D(double ***aveMatrix, double complex ****state, 
-			   options2D_t opts){
+int averageProbFromState2D(double ***aveMatrix, complex4D_t state, 
+			   options2D_t opts, int steps){
 
-  int m,n;
-  static int flag=0;
+  int m,n,ir,ic,nrows,ncols;
+  int rows[2][2], cols[2][2];
   const int rbound = (opts.lattType == CYCLE_LATT) ?
     opts.max : 2*opts.max+1;
+  const support2D_t supp = getSupport2D(opts, steps);
 
 
-  if(opts.numOfExperiments<1 || flag>opts.numOfExperiments)
+  if(opts.numOfExperiments<1)
     return 1;
+  if(!aveMatrix)
+    return 2;
 
-  /* If the function is called for the first time */
-  if(!flag){
+  /* If the matrix was not allocated yet, this is the first experiment */
+  if(!*aveMatrix){
 
-    if(!aveMatrix)
-      return 2;
-    *aveMatrix = getProbArray2D(state, opts);
+    *aveMatrix = getProbArray2D(state, opts, steps);
     if(!*aveMatrix)
       return 3;
     for(m=0; m<rbound; m++)
       for(n=0; n<rbound; n++)
 	(*aveMatrix)[m][n] /= opts.numOfExperiments;
     
-    flag++;
     return 0;
   }
 
   /* Now, subsequent calls are treated */
-  if(!*aveMatrix)
-    return 4;
 
-  for(m=0; m<rbound; m++){
-    for(n=0; n<rbound; n++){
-      int j,k;
-      double prob;
+  nrows = getSupportRanges(supp.lo[0], supp.len[0], rbound, rows);
+  ncols = getSupportRanges(supp.lo[1], supp.len[1], rbound, cols);
+
+  for(ir=0; ir<nrows; ir++){
+    for(m=rows[ir][0]; m<rows[ir][1]; m++){
+      for(ic=0; ic<ncols; ic++){
+	for(n=cols[ic][0]; n<cols[ic][1]; n++){
+	  int j,k;
+	  double prob;
       
-      prob = 0.0;
-      for(j=0; j<2; j++)
-	for(k=0; k<2; k++)
-	  prob += state[j][k][m][n]*conj(state[j][k][m][n]);
+	  prob = 0.0;
+	  for(j=0; j<2; j++)
+	    for(k=0; k<2; k++)
+	      prob += ENTRY4D(state,j,k,m,n)*conj(ENTRY4D(state,j,k,m,n));
       
-      (*aveMatrix)[m][n] += (prob/opts.numOfExperiments);
+	  (*aveMatrix)[m][n] += (prob/opts.numOfExperiments);
+	}
+      }
     }
   }
 
-  flag++;
   return 0;
 }
@@ -62,6 +62,9 @@ int writeData1D(const char *filename, double *probs, options1D_t options){
     break;
   case CUSTOM_STATE:
     fprintf(out,"#  Customized state (given by input file).\n");
+    break;
+  case FILE_STATE:
+    fprintf(out,"#  State read from binary state file %s.\n", options.stateFile);
   }
 
   fprintf(out,"#  Lattice type: ");
@@ -84,6 +87,12 @@ int writeData1D(const char *filename, double *probs, options1D_t options){
   if(options.calcMix)
     fprintf(out,"#  Steps to approximate stationary distribution: %d\n", 
 	    options.stepsMix);
+  if(options.calcMix && options.mixTol > 0.0){
+    fprintf(out,"#  Tolerance of stationary distribution: %e\n", options.mixTol);
+    if(options.mixError >= 0.0)
+      fprintf(out,"#  L1 change of stationary distribution in the last checkpoint: %e\n",
+	      options.mixError);
+  }
 
   if(options.lattType == LINE_LATT)
     fprintf(out,"#  Lattice size: -%d..%d in X axis.\n",MAX,MAX);
@@ -161,6 +170,9 @@ int writeData2D(const char *filename, double **probs, options2D_t options){
     break;
   case CUSTOM_STATE:
     fprintf(out,"#  Customized state (given by input file).\n");
+    break;
+  case FILE_STATE:
+    fprintf(out,"#  State read from binary state file %s.\n", options.stateFile);
   }
 
   fprintf(out,"#  Lattice type: ");
@@ -193,6 +205,12 @@ int writeData2D(const char *filename, double **probs, options2D_t options){
   if(options.calcMix)
     fprintf(out,"#  Steps to approximate stationary distribution: %d\n", 
 	    options.stepsMix);
+  if(options.calcMix && options.mixTol > 0.0){
+    fprintf(out,"#  Tolerance of stationary distribution: %e\n", options.mixTol);
+    if(options.mixError >= 0.0)
+      fprintf(out,"#  L1 change of stationary distribution in the last checkpoint: %e\n",
+	      options.mixError);
+  }
 
   if(options.lattType == CYCLE_LATT)
     fprintf(out,"#  Lattice size: 0..%d in X axis and 0..%d in Y axis.\n",MAX,MAX);
@@ -0,0 +1,141 @@
+/* QWalk (qwrandom.c)
+ * Copyright (C) 2008  Franklin Marquezino
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<math.h>
+#include "qwrandom.h"
+
+
+/* The generator below is Philox4x32-10 (J. K. Salmon, M. A. Moraes,
+ * R. O. Dror and D. E. Shaw, "Parallel random numbers: as easy as 
+ * 1, 2, 3", SC 2011). Each block of four 32-bit numbers is obtained by
+ * ten rounds of a bijection applied to a 128-bit counter under a 64-bit
+ * key. The key is given by the seed and by the stream, and the counter
+ * is the position in the stream, so any position can be reached at 
+ * once and different streams never overlap.
+ */
+#define PHILOX_M0 0xD2511F53U
+#define PHILOX_M1 0xCD9E8D57U
+#define PHILOX_W0 0x9E3779B9U
+#define PHILOX_W1 0xBB67AE85U
+
+static void philox4x32(const unsigned int counter[4], const unsigned int key[2],
+		       unsigned int out[4]){
+  int r;
+  unsigned int c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+  unsigned int k0 = key[0], k1 = key[1];
+
+  for(r=0; r<10; r++){
+    const unsigned long long p0 = (unsigned long long)PHILOX_M0*c0;
+    const unsigned long long p1 = (unsigned long long)PHILOX_M1*c2;
+    const unsigned int hi0 = (unsigned int)(p0 >> 32), lo0 = (unsigned int)p0;
+    const unsigned int hi1 = (unsigned int)(p1 >> 32), lo1 = (unsigned int)p1;
+
+    c0 = hi1 ^ c1 ^ k0;
+    c1 = lo1;
+    c2 = hi0 ^ c3 ^ k1;
+    c3 = lo0;
+
+    k0 += PHILOX_W0;
+    k1 += PHILOX_W1;
+  }/* end-for r */
+
+  out[0] = c0;
+  out[1] = c1;
+  out[2] = c2;
+  out[3] = c3;
+
+  return;
+}
+
+
+
+/* Fills the buffer of the stream with the block of the current counter */
+static void nextBlock(rng_t *rng){
+  const unsigned int counter[4] = {(unsigned int)rng->counter, 
+				   (unsigned int)(rng->counter >> 32), 0U, 0U};
+
+  philox4x32(counter, rng->key, rng->block);
+  rng->counter++;
+  rng->used = 0;
+
+  return;
+}
+
+
+
+void initRandom(rng_t *rng, int seed, int stream){
+
+  rng->key[0] = (unsigned int)seed;
+  rng->key[1] = (unsigned int)stream;
+  rng->counter = 0;
+  rng->used = 4;
+
+  return;
+}
+
+
+
+void seekRandom(rng_t *rng, unsigned long long position){
+
+  /* Each block gives two numbers */
+  rng->counter = position/2;
+  rng->used = 4;
+  if(position%2){
+    nextBlock(rng);
+    rng->used = 2;
+  }
+
+  return;
+}
+
+
+
+double getRandom(rng_t *rng){
+  unsigned long long hi, lo;
+
+  if(rng->used > 2)
+    nextBlock(rng);
+
+  hi = rng->block[rng->used];
+  lo = rng->block[rng->used+1];
+  rng->used += 2;
+
+  /* The 53 most significant bits give a number in [0,1) */
+  return (double)(((hi << 32) | lo) >> 11) * (1.0/9007199254740992.0);
+}
+
+
+
+long long getSkip(rng_t *rng, double p, long long max){
+  double skip;
+
+  if(p <= 0.0)
+    return max;
+  if(p >= 1.0)
+    return 0;
+
+  /* Inversion of the geometric distribution. Since the number given by
+   * getRandom is smaller than 1, the logarithm is always finite.
+   */
+  skip = floor(log1p(-getRandom(rng))/log1p(-p));
+
+  return (skip < (double)max) ? (long long)skip : max;
+}
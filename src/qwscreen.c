@@ -21,6 +21,7 @@
 #include<stdlib.h>
 #include<complex.h>
 #include<math.h>
+#include "qwmem_complex.h"
 #include "qwscreen.h"
 #include "qwconsts.h" 
 
@@ -66,12 +67,12 @@ int initScreen(screen_t *screen, int xa, int ya, int xb, int yb){
   return 0;
 }
 
-int updateScreen(screen_t *screen, double complex ****state, int max){
+int updateScreen(screen_t *screen, complex4D_t state, int max){
   int t;
 
   if(!screen)
     return 1;
-  if(!state)
+  if(!state.data)
     return 2;
   if(max<1)
     return 3;
@@ -84,7 +85,7 @@ int updateScreen(screen_t *screen, double complex ****state, int max){
     
     for(j=0; j<2; j++)
       for(k=0; k<2; k++)
-	screen->values[t] += state[j][k][m][n]*conj(state[j][k][m][n]);
+	screen->values[t] += ENTRY4D(state,j,k,m,n)*conj(ENTRY4D(state,j,k,m,n));
   }
   return 0;
 }
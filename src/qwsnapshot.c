@@ -0,0 +1,160 @@
+/* QWalk (qwsnapshot.c)
+ * Copyright (C) 2008  Franklin Marquezino
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<complex.h>
+#include "qwsnapshot.h"
+#include "qwstate.h"
+#include "qwconsts.h"
+
+/* Number of frames kept in the queue of the writer */
+#define SNAP_QUEUE_FRAMES 2
+
+
+/* Fills the header of the snapshot file of a simulation */
+static void setSnapHeader2D(snapheader_t *header, options2D_t options){
+  const int size = (options.lattType == CYCLE_LATT) ?
+    options.max : 2*options.max+1;
+  const int values = (options.snapType == WAVE_SNAPSHOT) ? 4 : 1;
+  const size_t bytes = (options.snapType == WAVE_SNAPSHOT) ?
+    sizeof(double complex) : sizeof(double);
+
+  memset(header, 0, sizeof(snapheader_t));
+  memcpy(header->magic, SNAP_MAGIC, sizeof(SNAP_MAGIC));
+  header->version = SNAP_VERSION;
+  header->dimension = 2;
+  header->type = options.snapType;
+  header->every = options.snapEvery;
+  header->stride = options.snapStride;
+  header->rows = header->cols = (size + options.snapStride - 1)/options.snapStride;
+  header->frameBytes = (long long)sizeof(long long) +
+    (long long)header->rows*header->cols*values*bytes;
+  header->lattType = options.lattType;
+  header->max = options.max;
+  header->steps = options.steps;
+  header->seed = options.seed;
+
+  return;
+}
+
+
+
+asyncwriter_t *openSnapshots2D(const char *filename, options2D_t options,
+			       int resumeStep){
+  FILE *out;
+  snapheader_t header, old;
+  long frames;
+
+  setSnapHeader2D(&header, options);
+
+  if(resumeStep < 0){
+    out = fopen(filename, "wb");
+    if(!out)
+      return NULL;
+    if(fwrite(&header, sizeof(snapheader_t), 1, out) != 1){
+      fclose(out);
+      return NULL;
+    }
+  }
+  else{
+    /* The frames written after the last checkpoint are written again */
+    out = fopen(filename, "r+b");
+    if(!out)
+      return NULL;
+    frames = resumeStep/options.snapEvery + 1;
+    if(fread(&old, sizeof(snapheader_t), 1, out) != 1 ||
+       memcmp(&old, &header, sizeof(snapheader_t)) ||
+       fseek(out, 0, SEEK_END) ||
+       ftell(out) < (long)sizeof(snapheader_t) + frames*header.frameBytes ||
+       fseek(out, (long)sizeof(snapheader_t) + frames*header.frameBytes, SEEK_SET)){
+      fclose(out);
+      return NULL;
+    }
+  }
+
+  return startWriter(out, SNAP_QUEUE_FRAMES*(size_t)header.frameBytes);
+}
+
+
+
+int sendSnapshot2D(asyncwriter_t *writer, complex4D_t state,
+		   options2D_t options, int step){
+  int m, n, ir, ic, nrows, ncols, rows[2][2], cols[2][2];
+  const int size = (options.lattType == CYCLE_LATT) ?
+    options.max : 2*options.max+1;
+  const int d = options.snapStride;
+  const support2D_t supp = getSupport2D(options, step);
+  snapheader_t header;
+  long long *frame;
+
+  setSnapHeader2D(&header, options);
+  frame = (long long *)newRecord((size_t)header.frameBytes);
+  if(!frame)
+    return 1;
+  memset(frame, 0, (size_t)header.frameBytes);
+  frame[0] = step;
+
+  nrows = getSupportRanges(supp.lo[0], supp.len[0], size, rows);
+  ncols = getSupportRanges(supp.lo[1], supp.len[1], size, cols);
+
+  if(options.snapType == WAVE_SNAPSHOT){
+    double complex *values = (double complex *)(frame + 1);
+
+    for(ir=0; ir<nrows; ir++)
+      for(m=rows[ir][0]; m<rows[ir][1]; m++){
+	if(m % d)
+	  continue;
+	for(ic=0; ic<ncols; ic++)
+	  for(n=cols[ic][0]; n<cols[ic][1]; n++){
+	    double complex *site;
+
+	    if(n % d)
+	      continue;
+	    site = values + 4*((size_t)(m/d)*header.cols + n/d);
+	    site[0] = ENTRY4D(state,0,0,m,n);
+	    site[1] = ENTRY4D(state,0,1,m,n);
+	    site[2] = ENTRY4D(state,1,0,m,n);
+	    site[3] = ENTRY4D(state,1,1,m,n);
+	  }/* end-for n */
+      }/* end-for m */
+  }
+  else{
+    double *values = (double *)(frame + 1);
+
+    for(ir=0; ir<nrows; ir++)
+      for(m=rows[ir][0]; m<rows[ir][1]; m++){
+	double *row = values + (size_t)(m/d)*header.cols;
+
+	for(ic=0; ic<ncols; ic++)
+	  for(n=cols[ic][0]; n<cols[ic][1]; n++){
+	    int j, k;
+	    double prob = 0.0;
+
+	    for(j=0; j<2; j++)
+	      for(k=0; k<2; k++)
+		prob += creal(ENTRY4D(state,j,k,m,n)*conj(ENTRY4D(state,j,k,m,n)));
+	    row[n/d] += prob;
+	  }/* end-for n */
+      }/* end-for m */
+  }
+
+  return queueRecord(writer, writeRawRecord, frame);
+}
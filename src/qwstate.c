@@ -26,17 +26,34 @@
 #include "qwconsts.h"
 
 
-double complex ****createGroverState2D(int max, unsigned int lattType){
-  double complex ****matrix;
+complex4D_t allocState2D(int max, unsigned int lattType, unsigned int layout){
+  complex4D_t matrix;
   const int size = (lattType == CYCLE_LATT) ? max : 2*max+1;
 
+  matrix.data = NULL;
   if(max<1)
-    return NULL;
+    return matrix;
 
-  matrix = allocComplex4D(2, 2, size, size);
-  if(!matrix)
-    return NULL;
-  cleanComplex4D(matrix, 2, 2, size, size);
+  if(layout == SITE_LAYOUT)
+    matrix = allocSiteTensor4D(2, 2, size, size);
+  else
+    matrix = allocTensor4D(2, 2, size, size);
+
+  if(!matrix.data)
+    return matrix;
+  cleanTensor4D(matrix);
+
+  return matrix;
+}
+
+
+complex4D_t createGroverState2D(int max, unsigned int lattType, 
+				  unsigned int layout){
+  complex4D_t matrix;
+
+  matrix = allocState2D(max, lattType, layout);
+  if(!matrix.data)
+    return matrix;
 
   /* Note that the mathematical lattice ranges from -max to max, while the
    * computational representation of this lattice ranges from 0 to 2*max in C.
@@ -45,16 +62,16 @@ double complex ****createGroverState2D(int max, unsigned int lattType){
    * conversion.
    */
   if(lattType == CYCLE_LATT){
-    matrix[0][0][max/2][max/2] = 0.5;
-    matrix[0][1][max/2][max/2] =-0.5; 
-    matrix[1][0][max/2][max/2] =-0.5;
-    matrix[1][1][max/2][max/2] = 0.5;
+    ENTRY4D(matrix,0,0,max/2,max/2) = 0.5;
+    ENTRY4D(matrix,0,1,max/2,max/2) =-0.5; 
+    ENTRY4D(matrix,1,0,max/2,max/2) =-0.5;
+    ENTRY4D(matrix,1,1,max/2,max/2) = 0.5;
   }
   else{
-    matrix[0][0][max][max] = 0.5;
-    matrix[0][1][max][max] =-0.5; 
-    matrix[1][0][max][max] =-0.5;
-    matrix[1][1][max][max] = 0.5;
+    ENTRY4D(matrix,0,0,max,max) = 0.5;
+    ENTRY4D(matrix,0,1,max,max) =-0.5; 
+    ENTRY4D(matrix,1,0,max,max) =-0.5;
+    ENTRY4D(matrix,1,1,max,max) = 0.5;
   }
 
   return matrix;
@@ -62,17 +79,13 @@ double complex ****createGroverState2D(int max, unsigned int lattType){
 
 
 
-double complex ****createFourierState2D(int max, unsigned int lattType){
-  double complex ****matrix;
-  const int size = (lattType == CYCLE_LATT) ? max : 2*max+1;
+complex4D_t createFourierState2D(int max, unsigned int lattType, 
+				  unsigned int layout){
+  complex4D_t matrix;
 
-  if(max<1)
-    return NULL;
-
-  matrix = allocComplex4D(2, 2, size, size);
-  if(!matrix)
-    return NULL;
-  cleanComplex4D(matrix, 2, 2, size, size);
+  matrix = allocState2D(max, lattType, layout);
+  if(!matrix.data)
+    return matrix;
 
   /* Note that the mathematical lattice ranges from -max to max, while the
    * computational representation of this lattice ranges from 0 to 2*max in C.
@@ -81,16 +94,16 @@ double complex ****createFourierState2D(int max, unsigned int lattType){
    * conversion.
    */
   if(lattType == CYCLE_LATT){
-    matrix[0][0][max/2][max/2] = 0.5;
-    matrix[0][1][max/2][max/2] = (1.0-I)/(2.0*sqrt(2.0)); 
-    matrix[1][0][max/2][max/2] = 0.5;
-    matrix[1][1][max/2][max/2] =-(1.0-I)/(2.0*sqrt(2.0));
+    ENTRY4D(matrix,0,0,max/2,max/2) = 0.5;
+    ENTRY4D(matrix,0,1,max/2,max/2) = (1.0-I)/(2.0*sqrt(2.0)); 
+    ENTRY4D(matrix,1,0,max/2,max/2) = 0.5;
+    ENTRY4D(matrix,1,1,max/2,max/2) =-(1.0-I)/(2.0*sqrt(2.0));
   }
   else{
-    matrix[0][0][max][max] = 0.5;
-    matrix[0][1][max][max] = (1.0-I)/(2.0*sqrt(2.0)); 
-    matrix[1][0][max][max] = 0.5;
-    matrix[1][1][max][max] =-(1.0-I)/(2.0*sqrt(2.0));
+    ENTRY4D(matrix,0,0,max,max) = 0.5;
+    ENTRY4D(matrix,0,1,max,max) = (1.0-I)/(2.0*sqrt(2.0)); 
+    ENTRY4D(matrix,1,0,max,max) = 0.5;
+    ENTRY4D(matrix,1,1,max,max) =-(1.0-I)/(2.0*sqrt(2.0));
   }
 
 
@@ -99,17 +112,13 @@ double complex ****createFourierState2D(int max, unsigned int lattType){
 
 
 
-double complex ****createHadamardState2D(int max, unsigned int lattType){
-  double complex ****matrix;
-  const int size = (lattType == CYCLE_LATT) ? max : 2*max+1;
-
-  if(max<1)
-    return NULL;
+complex4D_t createHadamardState2D(int max, unsigned int lattType, 
+				  unsigned int layout){
+  complex4D_t matrix;
 
-  matrix = allocComplex4D(2, 2, size, size);
-  if(!matrix)
-    return NULL;
-  cleanComplex4D(matrix, 2, 2, size, size);
+  matrix = allocState2D(max, lattType, layout);
+  if(!matrix.data)
+    return matrix;
 
   /* Note that the mathematical lattice ranges from -max to max, while the
    * computational representation of this lattice ranges from 0 to 2*max in C.
@@ -118,16 +127,16 @@ double complex ****createHadamardState2D(int max, unsigned int lattType){
    * conversion.
    */
   if(lattType == CYCLE_LATT){
-    matrix[0][0][max/2][max/2] = 0.5;
-    matrix[0][1][max/2][max/2] = 0.5*I; 
-    matrix[1][0][max/2][max/2] = 0.5*I;
-    matrix[1][1][max/2][max/2] =-0.5 ;
+    ENTRY4D(matrix,0,0,max/2,max/2) = 0.5;
+    ENTRY4D(matrix,0,1,max/2,max/2) = 0.5*I; 
+    ENTRY4D(matrix,1,0,max/2,max/2) = 0.5*I;
+    ENTRY4D(matrix,1,1,max/2,max/2) =-0.5 ;
   }
   else{
-    matrix[0][0][max][max] = 0.5;
-    matrix[0][1][max][max] = 0.5*I; 
-    matrix[1][0][max][max] = 0.5*I;
-    matrix[1][1][max][max] =-0.5 ;
+    ENTRY4D(matrix,0,0,max,max) = 0.5;
+    ENTRY4D(matrix,0,1,max,max) = 0.5*I; 
+    ENTRY4D(matrix,1,0,max,max) = 0.5*I;
+    ENTRY4D(matrix,1,1,max,max) =-0.5 ;
   }
 
   return matrix;
@@ -171,7 +180,7 @@ double complex **createHadamardState1D(int max, unsigned int lattType){
 
 
 
-int checkState2D(double complex ****matrix, options2D_t options){
+int checkState2D(complex4D_t matrix, options2D_t options){
   int m,n,j,k;
   double totalprob;
 
@@ -182,14 +191,14 @@ int checkState2D(double complex ****matrix, options2D_t options){
       for(k=0; k<2; k++)
 	for(m=0; m<options.max; m++)
 	  for(n=0; n<options.max; n++)
-	    totalprob += matrix[j][k][m][n]*conj(matrix[j][k][m][n]);
+	    totalprob += ENTRY4D(matrix,j,k,m,n)*conj(ENTRY4D(matrix,j,k,m,n));
   }
   else{
     for(j=0; j<2; j++)
       for(k=0; k<2; k++)
 	for(m=0; m<=2*options.max; m++)
 	  for(n=0; n<=2*options.max; n++)
-	    totalprob += matrix[j][k][m][n]*conj(matrix[j][k][m][n]);
+	    totalprob += ENTRY4D(matrix,j,k,m,n)*conj(ENTRY4D(matrix,j,k,m,n));
   }
 
   if( fabs(totalprob-1.0) > WALK_TOL )
@@ -248,7 +257,7 @@ int checkSymmetry1D(double complex **matrix, int max){
 
 
 
-int checkXSymmetry2D(double complex ****matrix, int max){
+int checkXSymmetry2D(complex4D_t matrix, int max){
   int m, n;
 
   for(m=-max; m<=max; m++){
@@ -261,8 +270,8 @@ int checkXSymmetry2D(double complex ****matrix, int max){
 
       for(j=0; j<2; j++){
 	for(k=0; k<2; k++){
-	  probA += matrix[j][k][max-m][max+n]*conj(matrix[j][k][max-m][max+n]);
-	  probB += matrix[j][k][max+m][max+n]*conj(matrix[j][k][max+m][max+n]);
+	  probA += ENTRY4D(matrix,j,k,max-m,max+n)*conj(ENTRY4D(matrix,j,k,max-m,max+n));
+	  probB += ENTRY4D(matrix,j,k,max+m,max+n)*conj(ENTRY4D(matrix,j,k,max+m,max+n));
 	}
       }
       if(fabs(probA - probB) > WALK_TOL)
@@ -275,7 +284,7 @@ int checkXSymmetry2D(double complex ****matrix, int max){
 
 
 
-int checkYSymmetry2D(double complex ****matrix, int max){
+int checkYSymmetry2D(complex4D_t matrix, int max){
   int m, n;
 
   for(m=-max; m<=max; m++){
@@ -288,8 +297,8 @@ int checkYSymmetry2D(double complex ****matrix, int max){
 
       for(j=0; j<2; j++){
 	for(k=0; k<2; k++){
-	  probA += matrix[j][k][max+m][max-n]*conj(matrix[j][k][max+m][max-n]);
-	  probB += matrix[j][k][max+m][max+n]*conj(matrix[j][k][max+m][max+n]);
+	  probA += ENTRY4D(matrix,j,k,max+m,max-n)*conj(ENTRY4D(matrix,j,k,max+m,max-n));
+	  probB += ENTRY4D(matrix,j,k,max+m,max+n)*conj(ENTRY4D(matrix,j,k,max+m,max+n));
 	}
       }
       if(fabs(probA - probB) > WALK_TOL)
@@ -300,3 +309,307 @@ int checkYSymmetry2D(double complex ****matrix, int max){
   return 1;
 }
 
+
+
+
+int getSupportRanges(int lo, int len, int size, int range[2][2]){
+
+  if(len<=0 || len>=size){
+    range[0][0] = 0;
+    range[0][1] = size;
+    return 1;
+  }
+
+  if(lo+len <= size){
+    range[0][0] = lo;
+    range[0][1] = lo+len;
+    return 1;
+  }
+
+  /* The region wraps around the end of the lattice. The first range is
+   * the one closer to the origin, so the sites are visited in increasing
+   * order.
+   */
+  range[0][0] = 0;
+  range[0][1] = lo+len-size;
+  range[1][0] = lo;
+  range[1][1] = size;
+  return 2;
+}
+
+
+
+/* Receives an array used[0..size-1] telling which sites of one axis are
+ * occupied and finds the smallest interval containing all of them. In 
+ * the cyclic lattices the interval may wrap around, and it is the 
+ * complement of the largest gap of empty sites.
+ */
+static void smallestInterval(const char *used, int size, int cyclic, 
+			     int *lo, int *len){
+  int i, first, last, gap, bestGap, bestEnd;
+
+  first = -1;
+  last = -1;
+  for(i=0; i<size; i++)
+    if(used[i]){
+      if(first<0)
+	first = i;
+      last = i;
+    }
+
+  if(first<0){ /* null state: we use the whole lattice */
+    *lo = 0;
+    *len = 0;
+    return;
+  }
+
+  *lo = first;
+  *len = last-first+1;
+  if(!cyclic)
+    return;
+
+  /* The gap that wraps around the end of the lattice is the first 
+   * candidate. Then we look for larger gaps inside [first,last].
+   */
+  bestGap = size - *len;
+  bestEnd = first;
+  gap = 0;
+  for(i=first; i<=last; i++){
+    if(used[i]){
+      if(gap>bestGap){
+	bestGap = gap;
+	bestEnd = i;
+      }
+      gap = 0;
+    }
+    else
+      gap++;
+  }
+
+  *lo = bestEnd;
+  *len = size - bestGap;
+  return;
+}
+
+
+
+support2D_t getStateSupport2D(complex4D_t state, options2D_t opts){
+  support2D_t support;
+  int m, n, axis;
+  char *used[2];
+  const int size = (opts.lattType == CYCLE_LATT) ? opts.max : 2*opts.max+1;
+
+  support.lo[0] = support.lo[1] = 0;
+  support.len[0] = support.len[1] = 0;
+
+  used[0] = calloc(size, sizeof(char));
+  used[1] = calloc(size, sizeof(char));
+  if(!used[0] || !used[1] || !state.data){
+    free(used[0]);
+    free(used[1]);
+    return support;
+  }
+
+  for(m=0; m<size; m++){
+    for(n=0; n<size; n++){
+      int j,k;
+
+      for(j=0; j<2; j++)
+	for(k=0; k<2; k++)
+	  if(ENTRY4D(state,j,k,m,n) != 0.0)
+	    used[0][m] = used[1][n] = 1;
+    }
+  }
+
+  for(axis=0; axis<2; axis++){
+    smallestInterval(used[axis], size, opts.lattType == CYCLE_LATT,
+		     &support.lo[axis], &support.len[axis]);
+    free(used[axis]);
+  }
+
+  return support;
+}
+
+
+
+support2D_t getSupport2D(options2D_t opts, int steps){
+  support2D_t support;
+  int axis;
+  const int MAX = opts.max;
+
+  for(axis=0; axis<2; axis++){
+
+    if(opts.lattType != CYCLE_LATT){
+      /* The same square used by iterate2D, with one extra site in 
+       * each direction.
+       */
+      support.lo[axis] = MAXIMUM(MAX - opts.lattextra - steps, 0);
+      support.len[axis] = 
+	MINIMUM(MAX + opts.lattextra + steps, 2*MAX) - support.lo[axis] + 1;
+    }
+    else if(opts.support.len[axis] <= 0 || 
+	    opts.support.len[axis] + 2*steps >= MAX){
+      support.lo[axis] = 0;
+      support.len[axis] = MAX;
+    }
+    else{
+      /* In each step the walker moves at most one site in each axis */
+      support.lo[axis] = ((opts.support.lo[axis] - steps)%MAX + MAX)%MAX;
+      support.len[axis] = opts.support.len[axis] + 2*steps;
+    }
+
+  }/* end-for axis */
+
+  return support;
+}
+
+
+
+support1D_t getStateSupport1D(double complex **state, options1D_t opts){
+  support1D_t support;
+  int m;
+  char *used;
+  const int size = (opts.lattType == LINE_LATT) ? 2*opts.max+1 : opts.max;
+
+  support.lo = 0;
+  support.len = 0;
+
+  used = calloc(size, sizeof(char));
+  if(!used || !state){
+    free(used);
+    return support;
+  }
+
+  for(m=0; m<size; m++)
+    if(state[0][m] != 0.0 || state[1][m] != 0.0)
+      used[m] = 1;
+
+  smallestInterval(used, size, opts.lattType == CYCLE_LATT, 
+		   &support.lo, &support.len);
+  free(used);
+
+  return support;
+}
+
+
+
+support1D_t getSupport1D(options1D_t opts, int steps){
+  support1D_t support;
+  const int MAX = opts.max;
+
+  switch(opts.lattType){
+  case LINE_LATT:
+    support.lo = MAXIMUM(MAX - opts.lattextra - steps, 0);
+    support.len = MINIMUM(MAX + opts.lattextra + steps, 2*MAX) - support.lo + 1;
+    break;
+
+  case SEGMENT_LATT:
+    if(opts.support.len <= 0){
+      support.lo = 0;
+      support.len = MAX;
+    }
+    else{
+      support.lo = MAXIMUM(opts.support.lo - steps, 0);
+      support.len = MINIMUM(opts.support.lo + opts.support.len - 1 + steps,
+			    MAX-1) - support.lo + 1;
+    }
+    break;
+
+  default: /* CYCLE_LATT */
+    if(opts.support.len <= 0 || opts.support.len + 2*steps >= MAX){
+      support.lo = 0;
+      support.len = MAX;
+    }
+    else{
+      support.lo = ((opts.support.lo - steps)%MAX + MAX)%MAX;
+      support.len = opts.support.len + 2*steps;
+    }
+  }
+
+  return support;
+}
+
+
+
+int newStateTemplate2D(statetemplate2D_t *tmpl, complex4D_t state, 
+		       options2D_t opts){
+  size_t i, e;
+  const size_t size = SIZE4D(state);
+
+  tmpl->numEntries = 0;
+  tmpl->offset = NULL;
+  tmpl->value = NULL;
+  tmpl->support = getStateSupport2D(state, opts);
+
+  for(i=0; i<size; i++)
+    if(state.data[i] != 0.0)
+      tmpl->numEntries++;
+
+  /* At least one entry is allocated, so that a NULL pointer always
+   * means that there was not enough memory.
+   */
+  tmpl->offset = (size_t *)malloc((tmpl->numEntries+1)*sizeof(size_t));
+  tmpl->value = (double complex *)malloc((tmpl->numEntries+1)*sizeof(double complex));
+  if(!tmpl->offset || !tmpl->value){
+    freeStateTemplate2D(tmpl);
+    return 1;
+  }
+
+  for(i=0, e=0; i<size; i++)
+    if(state.data[i] != 0.0){
+      tmpl->offset[e] = i;
+      tmpl->value[e] = state.data[i];
+      e++;
+    }
+
+  return 0;
+}
+
+
+
+void copyStateTemplate2D(complex4D_t state, const statetemplate2D_t *tmpl,
+			 options2D_t opts, int steps){
+  size_t e;
+
+  if(steps < 0)
+    cleanTensor4D(state);
+  else{
+    /* The region reached by the walker grows from the support of the
+     * template, as in the experiments.
+     */
+    const int size = (opts.lattType == CYCLE_LATT) ? opts.max : 2*opts.max+1;
+    int rows[2][2], cols[2][2], nrows, ncols, ir, ic, m, n, j, k;
+    support2D_t supp;
+
+    opts.support = tmpl->support;
+    supp = getSupport2D(opts, steps);
+    nrows = getSupportRanges(supp.lo[0], supp.len[0], size, rows);
+    ncols = getSupportRanges(supp.lo[1], supp.len[1], size, cols);
+
+    for(ir=0; ir<nrows; ir++)
+      for(m=rows[ir][0]; m<rows[ir][1]; m++)
+	for(ic=0; ic<ncols; ic++)
+	  for(n=cols[ic][0]; n<cols[ic][1]; n++)
+	    for(j=0; j<2; j++)
+	      for(k=0; k<2; k++)
+		ENTRY4D(state,j,k,m,n) = 0.0;
+  }
+
+  for(e=0; e<tmpl->numEntries; e++)
+    state.data[tmpl->offset[e]] = tmpl->value[e];
+
+  return;
+}
+
+
+
+void freeStateTemplate2D(statetemplate2D_t *tmpl){
+
+  free(tmpl->offset);
+  free(tmpl->value);
+  tmpl->offset = NULL;
+  tmpl->value = NULL;
+  tmpl->numEntries = 0;
+
+  return;
+}
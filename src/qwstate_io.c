@@ -17,6 +17,8 @@
  * 02110-1301, USA
  */
 
+#define _POSIX_C_SOURCE 200112L
+
 #include<stdio.h>
 #include<stdlib.h>
 #include<complex.h>
@@ -25,27 +27,34 @@
 #include<limits.h>
 #include<time.h>
 #include "qwmem_complex.h"
+#include "qwstate.h"
 #include "qwstate_io.h"
+#include "qwinput.h"
 #include "qwconsts.h"
 
-
-double complex **readStateFile1D(const char *filename, int max, unsigned int lattType){
-  FILE *in;
+/* Binary state files are mapped in memory where mmap is available, and
+ * read into memory otherwise.
+ */
+#if defined(__unix__) || defined(__APPLE__)
+#define QW_MMAP
+#include<sys/types.h>
+#include<sys/mman.h>
+#include<sys/stat.h>
+#include<fcntl.h>
+#include<unistd.h>
+#endif
+
+
+double complex **readState1D(const inputfile_t *input, int max,
+			     unsigned int lattType){
+  inputfile_t cursor = *input, *in = &cursor;
   double complex **state;
   int j,m;
   double real, imag;
-  char keyword[100];
-
-  in = fopen(filename,"rt");
-  if(!in)
-    return NULL;
+  const char *token;
 
   /* First we search the BEGINSTATE keyword,...*/ 
-  do{
-    fscanf(in,"%s",keyword);
-  }while(STRNEQ(keyword,"BEGINSTATE") && !feof(in));
-
-  if(feof(in))
+  if(!findKeyword(in,"BEGINSTATE"))
     return NULL;
 
   state = (lattType == LINE_LATT) ?
@@ -66,59 +75,62 @@ double complex **readStateFile1D(const char *filename, int max, unsigned int lat
    * separated by a space. The amplitudes of those "kets" not 
    * described in the input file are all zero by default.
    */  
-  fscanf(in,"%s",keyword);
-  while(STRNEQ(keyword,"ENDSTATE") && !feof(in)){
-    sscanf(keyword,"%d", &j);
-    fscanf(in,"%d", &m);
-    fscanf(in,"%lf", &real);
-    fscanf(in,"%lf", &imag);
+  while((token = nextToken(in)) && STRNEQ(token,"ENDSTATE")){
+    j = (int)strtol(token, NULL, 10);
+    scanInt(in, &m);
+    scanReal(in, &real);
+    scanReal(in, &imag);
     if(j!=-1){
       if(lattType == LINE_LATT)
 	state[j][max+m] = real+ I*imag;
       else
 	state[j][m] = real+ I*imag;      
-
-      fscanf(in,"%s",keyword);
     }
     else{
       printf("Warning: Closing BEGINSTATE with -1 is deprecated.");
       printf(" Use ENDSTATE instead.\n");
-      strcpy(keyword,"ENDSTATE");
+      break;
     }
 
   }
   
-  fclose(in);
   return state;
 }
 
 
 
-double complex ****readStateFile2D(const char *filename, int max, unsigned int lattType){
-  FILE *in;
-  double complex ****state;
-  int j,k,m,n;
-  double real, imag;
-  char keyword[100];
-  const int auxsize = (lattType == CYCLE_LATT) ? max : 2*max+1;
+double complex **readStateFile1D(const char *filename, int max, unsigned int lattType){
+  inputfile_t *in;
+  double complex **state;
 
-  in = fopen(filename,"rt");
+  in = readInputFile(filename);
   if(!in)
     return NULL;
+  state = readState1D(in, max, lattType);
+  freeInputFile(in);
 
-  /* First we search the BEGINSTATE keyword,...*/
-  do{
-    fscanf(in,"%s",keyword);
-  }while(STRNEQ(keyword,"BEGINSTATE") && !feof(in));
+  return state;
+}
 
-  if(feof(in))
-    return NULL;
 
-  state = allocComplex4D(2, 2, auxsize, auxsize);
-  if(!state)
-    return NULL;
 
-  cleanComplex4D(state, 2, 2, auxsize, auxsize);
+complex4D_t readState2D(const inputfile_t *input, int max, 
+			unsigned int lattType, unsigned int layout){
+  inputfile_t cursor = *input, *in = &cursor;
+  complex4D_t state;
+  int j,k,m,n;
+  double real, imag;
+  const char *token;
+
+  state.data = NULL;
+
+  /* First we search the BEGINSTATE keyword,...*/
+  if(!findKeyword(in,"BEGINSTATE"))
+    return state;
+
+  state = allocState2D(max, lattType, layout);
+  if(!state.data)
+    return state;
 
 
   /* ...when we find it we start reading integer numbers, describing 
@@ -129,31 +141,46 @@ double complex ****readStateFile2D(const char *filename, int max, unsigned int l
    * separated by a space. The amplitudes of those "kets" not 
    * described in the input file are all zero by default.
    */  
-  fscanf(in,"%s",keyword);
-  while(STRNEQ(keyword,"ENDSTATE") && !feof(in)){
-    sscanf(keyword,"%d", &j);
-    fscanf(in,"%d", &k);
-    fscanf(in,"%d", &m);
-    fscanf(in,"%d", &n);
-    fscanf(in,"%lf", &real);
-    fscanf(in,"%lf", &imag);
+  while((token = nextToken(in)) && STRNEQ(token,"ENDSTATE")){
+    j = (int)strtol(token, NULL, 10);
+    scanInt(in, &k);
+    scanInt(in, &m);
+    scanInt(in, &n);
+    scanReal(in, &real);
+    scanReal(in, &imag);
 
     if(j!=-1 && k!=-1){
       int auxm = (lattType == CYCLE_LATT) ? m : max+m;
       int auxn = (lattType == CYCLE_LATT) ? n : max+n;
 
-      state[j][k][auxm][auxn] = real+ I*imag;
-      fscanf(in,"%s",keyword);
+      ENTRY4D(state,j,k,auxm,auxn) = real+ I*imag;
     }
     else{
       printf("Warning: Closing BEGINSTATE with -1 is deprecated.");
       printf(" Use ENDSTATE instead.\n");
-      strcpy(keyword,"ENDSTATE");
+      break;
     }
 
   }
 
-  fclose(in);
+  return state;
+}
+
+
+
+complex4D_t readStateFile2D(const char *filename, int max, 
+			    unsigned int lattType, unsigned int layout){
+  inputfile_t *in;
+  complex4D_t state;
+
+  state.data = NULL;
+
+  in = readInputFile(filename);
+  if(!in)
+    return state;
+  state = readState2D(in, max, lattType, layout);
+  freeInputFile(in);
+
   return state;
 }
 
@@ -188,6 +215,9 @@ int writeState1D(const char *filename, double complex **wave, options1D_t option
     break;
   case CUSTOM_STATE:
     fprintf(out,"#  Customized state (given by input file).\n");
+    break;
+  case FILE_STATE:
+    fprintf(out,"#  State read from binary state file %s.\n", options.stateFile);
   }
 
   fprintf(out,"#  Lattice type: ");
@@ -248,12 +278,15 @@ int writeState1D(const char *filename, double complex **wave, options1D_t option
 
 
 
-int writeState2D(const char *filename, double complex ****wave, options2D_t options){
+int writeState2D(const char *filename, complex4D_t wave, options2D_t options,
+		 int steps){
   FILE *out;
-  int m, n, j, k;
+  int m, n, j, k, ir, ic, nrows, ncols;
+  int rows[2][2], cols[2][2];
   time_t lt;
   const int MAX = options.max;
   const int auxsize = (options.lattType == CYCLE_LATT) ? MAX : 2*MAX+1;
+  const support2D_t supp = getSupport2D(options, steps);
 
   out=fopen(filename,"wt");
   if(!out)
@@ -292,6 +325,9 @@ int writeState2D(const char *filename, double complex ****wave, options2D_t opti
     break;
   case CUSTOM_STATE:
     fprintf(out,"#  Customized state (given by input file).\n");
+    break;
+  case FILE_STATE:
+    fprintf(out,"#  State read from binary state file %s.\n", options.stateFile);
   }
 
   fprintf(out,"#  Lattice type: ");
@@ -337,16 +373,25 @@ int writeState2D(const char *filename, double complex ****wave, options2D_t opti
 
   fprintf(out,"# m\t n\t j\t k\t Re(amplitude)\t Im(amplitude)\n\n");
 
-  for(m=0; m<auxsize; m++){
-    for(n=0; n<auxsize; n++){
-      int auxm = (options.lattType == CYCLE_LATT) ? m : m-MAX;
-      int auxn = (options.lattType == CYCLE_LATT) ? n : n-MAX;
-
-      for(j=0; j<2; j++){
-	for(k=0; k<2; k++){
-	  if(cabs(wave[j][k][m][n])>0.0)
-	    fprintf(out,"%d\t %d\t %d\t %d\t %e\t %e\n", auxm,auxn,j,k, 
-		    creal(wave[j][k][m][n]), cimag(wave[j][k][m][n]));
+  nrows = getSupportRanges(supp.lo[0], supp.len[0], auxsize, rows);
+  ncols = getSupportRanges(supp.lo[1], supp.len[1], auxsize, cols);
+
+  for(ir=0; ir<nrows; ir++){
+    for(m=rows[ir][0]; m<rows[ir][1]; m++){
+      for(ic=0; ic<ncols; ic++){
+	for(n=cols[ic][0]; n<cols[ic][1]; n++){
+	  int auxm = (options.lattType == CYCLE_LATT) ? m : m-MAX;
+	  int auxn = (options.lattType == CYCLE_LATT) ? n : n-MAX;
+
+	  for(j=0; j<2; j++){
+	    for(k=0; k<2; k++){
+	      const double complex amp = ENTRY4D(wave,j,k,m,n);
+
+	      if(cabs(amp)>0.0)
+		fprintf(out,"%d\t %d\t %d\t %d\t %e\t %e\n", auxm,auxn,j,k, 
+			creal(amp), cimag(amp));
+	    }
+	  }
 	}
       }
     }
@@ -356,3 +401,381 @@ int writeState2D(const char *filename, double complex ****wave, options2D_t opti
 
   return 0;
 }
+
+
+
+/* Maps the whole file in memory (or reads it, if mmap is not available)
+ * and stores its size, in bytes, in *bytes. Returns NULL if the file 
+ * cannot be opened or is empty. The memory is released by unmapFile.
+ */
+static void *mapFile(const char *filename, size_t *bytes){
+  void *map;
+#ifdef QW_MMAP
+  int fd;
+  struct stat st;
+
+  fd = open(filename, O_RDONLY);
+  if(fd < 0)
+    return NULL;
+  if(fstat(fd, &st) || st.st_size <= 0){
+    close(fd);
+    return NULL;
+  }
+
+  map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if(map == MAP_FAILED)
+    return NULL;
+  *bytes = (size_t)st.st_size;
+#else
+  FILE *in;
+  long len;
+
+  in = fopen(filename, "rb");
+  if(!in)
+    return NULL;
+  if(fseek(in, 0, SEEK_END) || (len = ftell(in)) <= 0){
+    fclose(in);
+    return NULL;
+  }
+  rewind(in);
+
+  map = malloc((size_t)len);
+  if(map && fread(map, 1, (size_t)len, in) != (size_t)len){
+    free(map);
+    map = NULL;
+  }
+  fclose(in);
+  *bytes = (size_t)len;
+#endif
+
+  return map;
+}
+
+
+
+static void unmapFile(void *map, size_t bytes){
+#ifdef QW_MMAP
+  munmap(map, bytes);
+#else
+  free(map);
+#endif
+
+  return;
+}
+
+
+
+/* Checks the header of a mapped binary state file with the given number
+ * of bytes, and whether it contains a state of the given dimension and
+ * lattice type, with size amplitudes per coin state (4 of them in 2D
+ * and 2 in 1D). Returns the error numbers of checkStateBinary2D.
+ */
+static int checkStateHeader(const void *map, size_t bytes, int dimension,
+			    int lattType){
+  const stateheader_t *header = (const stateheader_t *)map;
+  long long size;
+
+  if(bytes < sizeof(stateheader_t) || 
+     memcmp(header->magic, STATE_MAGIC, sizeof(STATE_MAGIC)) ||
+     header->version != STATE_VERSION)
+    return 2;
+
+  if(header->dimension != dimension || header->lattType != lattType ||
+     header->max < 1)
+    return 4;
+
+  if(dimension == 2){
+    size = (lattType == CYCLE_LATT) ? header->max : 2*header->max+1;
+    size = 4*size*size;
+  }
+  else
+    size = 2*((lattType == LINE_LATT) ? 2*header->max+1 : header->max);
+
+  if(header->size != size || 
+     (bytes - sizeof(stateheader_t))/sizeof(double complex) < (size_t)size)
+    return 3;
+
+  return 0;
+}
+
+
+
+/* Fills the header of a binary state file, except the fields which 
+ * depend on the dimension.
+ */
+static void setStateHeader(stateheader_t *header, int lattType, int max,
+			   int lattextra, int steps, int seed, int coinType,
+			   int stateType, float dtProb){
+
+  memset(header, 0, sizeof(stateheader_t));
+  memcpy(header->magic, STATE_MAGIC, sizeof(STATE_MAGIC));
+  header->version = STATE_VERSION;
+  header->lattType = lattType;
+  header->max = max;
+  header->lattextra = lattextra;
+  header->steps = steps;
+  header->seed = seed;
+  header->coinType = coinType;
+  header->stateType = stateType;
+  header->dtProb = dtProb;
+
+  return;
+}
+
+
+
+int writeStateBinary1D(const char *filename, double complex **wave, 
+		       options1D_t options, int steps){
+  FILE *out;
+  stateheader_t header;
+  int j;
+  const int rbound = (options.lattType == LINE_LATT) ? 
+    2*options.max+1 : options.max;
+
+  out = fopen(filename, "wb");
+  if(!out)
+    return 1;
+
+  setStateHeader(&header, options.lattType, options.max, options.lattextra,
+		 steps, options.seed, options.coinType, options.stateType,
+		 options.dtProb);
+  header.size = 2*rbound;
+  header.dimension = 1;
+  header.blProb[0] = options.blProb;
+
+  if(fwrite(&header, sizeof(stateheader_t), 1, out) != 1){
+    fclose(out);
+    return 2;
+  }
+  for(j=0; j<2; j++)
+    if(fwrite(wave[j], sizeof(double complex), rbound, out) != (size_t)rbound){
+      fclose(out);
+      return 2;
+    }
+
+  if(fclose(out))
+    return 2;
+
+  return 0;
+}
+
+
+
+int writeStateBinary2D(const char *filename, complex4D_t wave, 
+		       options2D_t options, int steps){
+  FILE *out;
+  stateheader_t header;
+
+  out = fopen(filename, "wb");
+  if(!out)
+    return 1;
+
+  setStateHeader(&header, options.lattType, options.max, options.lattextra,
+		 steps, options.seed, options.coinType, options.stateType,
+		 options.dtProb);
+  header.size = (long long)SIZE4D(wave);
+  header.dimension = 2;
+  header.layout = options.layout;
+  header.blProb[0] = options.blProbA;
+  header.blProb[1] = options.blProbB;
+
+  if(fwrite(&header, sizeof(stateheader_t), 1, out) != 1 ||
+     fwrite(wave.data, sizeof(double complex), SIZE4D(wave), out) != SIZE4D(wave)){
+    fclose(out);
+    return 2;
+  }
+
+  if(fclose(out))
+    return 2;
+
+  return 0;
+}
+
+
+
+/* Checks whether the state of a mapped file fits in the lattice of the
+ * simulation (see checkStateBinary1D).
+ */
+static int checkStateMap1D(const void *map, size_t bytes, options1D_t options){
+  const stateheader_t *header = (const stateheader_t *)map;
+  int error;
+
+  error = checkStateHeader(map, bytes, 1, options.lattType);
+  if(error)
+    return error;
+
+  if(options.lattType != LINE_LATT)
+    return (header->max == options.max) ? 0 : 5;
+  if(MINIMUM(header->max, header->lattextra + header->steps) > 
+     MINIMUM(options.max, options.lattextra))
+    return 5;
+
+  return 0;
+}
+
+
+
+static int checkStateMap2D(const void *map, size_t bytes, options2D_t options){
+  const stateheader_t *header = (const stateheader_t *)map;
+  int error;
+
+  error = checkStateHeader(map, bytes, 2, options.lattType);
+  if(error)
+    return error;
+
+  if(header->layout != COIN_LAYOUT && header->layout != SITE_LAYOUT)
+    return 2;
+  if(options.lattType == CYCLE_LATT)
+    return (header->max == options.max) ? 0 : 5;
+  if(MINIMUM(header->max, header->lattextra + header->steps) > 
+     MINIMUM(options.max, options.lattextra))
+    return 5;
+
+  return 0;
+}
+
+
+
+int checkStateBinary1D(const char *filename, options1D_t options){
+  void *map;
+  size_t bytes;
+  int error;
+
+  map = mapFile(filename, &bytes);
+  if(!map)
+    return 1;
+  error = checkStateMap1D(map, bytes, options);
+  unmapFile(map, bytes);
+
+  return error;
+}
+
+
+
+int checkStateBinary2D(const char *filename, options2D_t options){
+  void *map;
+  size_t bytes;
+  int error;
+
+  map = mapFile(filename, &bytes);
+  if(!map)
+    return 1;
+  error = checkStateMap2D(map, bytes, options);
+  unmapFile(map, bytes);
+
+  return error;
+}
+
+
+
+double complex **readStateBinary1D(const char *filename, options1D_t options){
+  void *map;
+  size_t bytes;
+  double complex **state = NULL;
+  const stateheader_t *header;
+  const double complex *amps;
+  int j, m, hsize, shift;
+  const int rbound = (options.lattType == LINE_LATT) ? 
+    2*options.max+1 : options.max;
+
+  map = mapFile(filename, &bytes);
+  if(!map)
+    return NULL;
+  if(checkStateMap1D(map, bytes, options)){
+    unmapFile(map, bytes);
+    return NULL;
+  }
+
+  header = (const stateheader_t *)map;
+  amps = (const double complex *)((const char *)map + sizeof(stateheader_t));
+  hsize = (int)(header->size/2);
+
+  /* In the LINE lattice the origin is moved to the center of the new 
+   * lattice. The sites left out are zero (see checkStateBinary1D).
+   */
+  shift = (options.lattType == LINE_LATT) ? options.max - header->max : 0;
+
+  state = allocComplex2D(2, rbound);
+  if(state){
+    cleanComplex2D(state, 2, rbound);
+    for(j=0; j<2; j++)
+      for(m=MAXIMUM(0,-shift); m<MINIMUM(hsize, rbound-shift); m++)
+	state[j][m+shift] = amps[(long)j*hsize + m];
+  }
+
+  unmapFile(map, bytes);
+  return state;
+}
+
+
+
+complex4D_t readStateBinary2D(const char *filename, options2D_t options){
+  void *map;
+  size_t bytes;
+  complex4D_t state, src;
+  const stateheader_t *header;
+  int j, k, m, n, hsize, shift, lo, hi;
+
+  state.data = NULL;
+  state.block = NULL;
+
+  map = mapFile(filename, &bytes);
+  if(!map)
+    return state;
+  if(checkStateMap2D(map, bytes, options)){
+    unmapFile(map, bytes);
+    return state;
+  }
+
+  header = (const stateheader_t *)map;
+  hsize = (options.lattType == CYCLE_LATT) ? header->max : 2*header->max+1;
+
+  /* The amplitudes of the file, with the strides of allocTensor4D or
+   * allocSiteTensor4D.
+   */
+  src.data = (double complex *)((char *)map + sizeof(stateheader_t));
+  src.block = NULL;
+  src.dim[0] = src.dim[1] = 2;
+  src.dim[2] = src.dim[3] = hsize;
+  if(header->layout == SITE_LAYOUT){
+    src.stride[1] = 1;
+    src.stride[0] = 2;
+    src.stride[3] = 4;
+    src.stride[2] = 4L*hsize;
+  }
+  else{
+    src.stride[3] = 1;
+    src.stride[2] = hsize;
+    src.stride[1] = (long)hsize*hsize;
+    src.stride[0] = 2L*hsize*hsize;
+  }
+
+  state = allocState2D(options.max, options.lattType, options.layout);
+  if(!state.data){
+    unmapFile(map, bytes);
+    return state;
+  }
+
+  if(header->max == options.max && header->layout == options.layout)
+    memcpy(state.data, src.data, SIZE4D(state)*sizeof(double complex));
+  else{
+    /* The origin is moved to the center of the new lattice. The sites
+     * left out are zero (see checkStateBinary2D).
+     */
+    const int size = (options.lattType == CYCLE_LATT) ? 
+      options.max : 2*options.max+1;
+
+    shift = (options.lattType == CYCLE_LATT) ? 0 : options.max - header->max;
+    lo = MAXIMUM(0, -shift);
+    hi = MINIMUM(hsize, size-shift);
+    for(m=lo; m<hi; m++)
+      for(n=lo; n<hi; n++)
+	for(j=0; j<2; j++)
+	  for(k=0; k<2; k++)
+	    ENTRY4D(state,j,k,m+shift,n+shift) = ENTRY4D(src,j,k,m,n);
+  }
+
+  unmapFile(map, bytes);
+  return state;
+}
@@ -25,14 +25,16 @@
 #include "qwconsts.h"
 #include "qwoptions_io.h"
 #include "qwmem_real.h"
+#include "qwmem_complex.h"
+#include "qwstate.h"
 
 
-statistics_t getStatisticsFromState1D(double complex **matrix,  double *StatProb,
-				      options1D_t opts, int iteration){
+statistics_t getStatisticsFromState1D(double complex **matrix, double *StatProb,
+				      double *SumProb, options1D_t opts, 
+				      int iteration){
   statistics_t stat;
   double fstMoment, secMoment;
   int m;
-  static double *SumProb=NULL;
 
   if(opts.max<1){
     stat.iteration=-1;
@@ -47,14 +49,6 @@ statistics_t getStatisticsFromState1D(double complex **matrix,  double *StatProb
     return stat;
   }
 
-  if((iteration==1) && (opts.calcMix)){
-    SumProb = (opts.lattType == LINE_LATT) ?
-      allocReal1D(2*opts.max+1) : allocReal1D(opts.max);
-    cleanReal1D(SumProb, (opts.lattType == LINE_LATT) ?
-		2*opts.max+1: opts.max);
-  }
-
-
   fstMoment = 0.0;
   secMoment = 0.0;
 
@@ -96,49 +90,95 @@ statistics_t getStatisticsFromState1D(double complex **matrix,  double *StatProb
   stat.tvd = stat.tvdu = 0.0;
 
   if(opts.calcMix){
-      const int rbound = (opts.lattType == LINE_LATT) ? 
-	2*opts.max+1 : opts.max;
-      const int auxSize = (opts.lattType == LINE_LATT) ? 
-	2*(opts.max-opts.lattextra)+1 : opts.max;
-      const double UnifProb = 1.0/auxSize;
-
-      for(m=0; m<rbound; m++){
-	int j;
-	double prob = 0.0;
+    addProbFromState1D(SumProb, matrix, opts);
+    getDistancesFromSumProb1D(&stat, StatProb, SumProb, opts, iteration);
+  }
+
+  return stat;
+}
+
+
+
+void getDistancesFromSumProb1D(statistics_t *stat, double *StatProb,
+			       double *SumProb, options1D_t opts, 
+			       int iteration){
+  int m;
+  const int rbound = (opts.lattType == LINE_LATT) ? 2*opts.max+1 : opts.max;
+  const int auxSize = (opts.lattType == LINE_LATT) ? 
+    2*(opts.max-opts.lattextra)+1 : opts.max;
+  const double UnifProb = 1.0/auxSize;
+
+  stat->tvd = stat->tvdu = 0.0;
+  for(m=0; m<rbound; m++){
+    stat->tvd += fabs( StatProb[m] - SumProb[m]/(double)iteration );
+    stat->tvdu += fabs( UnifProb - SumProb[m]/(double)iteration );
+  }
+
+  return;
+}
+
+
+
+void addProbFromState1D(double *SumProb, double complex **matrix, 
+			options1D_t opts){
+  int m;
+  const int rbound = (opts.lattType == LINE_LATT) ? 2*opts.max+1 : opts.max;
+
+  for(m=0; m<rbound; m++){
+    int j;
+    double prob = 0.0;
 	
-	for(j=0; j<2; j++)
-	  prob += matrix[j][m]*conj(matrix[j][m]);
+    for(j=0; j<2; j++)
+      prob += matrix[j][m]*conj(matrix[j][m]);
       
-	SumProb[m] += prob;
-	stat.tvd += fabs( StatProb[m] - SumProb[m]/(double)iteration );
-	stat.tvdu += fabs( UnifProb - SumProb[m]/(double)iteration );
-      }
+    SumProb[m] += prob;
   }
 
-  if(iteration == opts.steps && opts.calcMix)
-    free(SumProb);
+  return;
+}
 
 
+statistics_t getStatisticsFromMoments2D(double fstMomentX, double secMomentX,
+					double fstMomentY, double secMomentY,
+					int iteration){
+  statistics_t stat;
+  const double varianceX = secMomentX - fstMomentX*fstMomentX;
+  const double varianceY = secMomentY - fstMomentY*fstMomentY;  
+
+  stat.iteration = iteration;
+  stat.meanX = fstMomentX;
+  stat.meanY = fstMomentY;
+
+  /* To calculate the variance in the 2D simulation we calculate the 
+   * variances of both X and Y position and add them. It simplifies
+   * the calculation and gives a good approximation of the expected
+   * behaviour.
+   */
+  stat.variance = varianceX + varianceY;
+  stat.tvd = stat.tvdu = 0.0;
+
   return stat;
 }
 
 
-statistics_t getStatisticsFromState2D(double complex ****matrix, double **StatProb,
-				      options2D_t opts, int iteration){
+
+statistics_t getStatisticsFromState2D(complex4D_t matrix, double **StatProb,
+				      double **SumProb, options2D_t opts, 
+				      int iteration){
   statistics_t stat;
-  double fstMomentX, secMomentX, varianceX;
-  double fstMomentY, secMomentY, varianceY;
-  int m,n;
-  static double **SumProb = NULL;
+  double fstMomentX, secMomentX;
+  double fstMomentY, secMomentY;
+  int m,n,ir,ic,nrows,ncols;
+  int rows[2][2], cols[2][2];
   const int auxsize = (opts.lattType == CYCLE_LATT) ? opts.max : 2*opts.max+1;
-  const int lbound = (opts.lattType == CYCLE_LATT) ? 0 : -opts.max;
-  const int rbound = (opts.lattType == CYCLE_LATT) ? opts.max-1 : opts.max;
+  const int shift = (opts.lattType == CYCLE_LATT) ? 0 : opts.max;
+  const support2D_t supp = getSupport2D(opts, iteration);
   
   if(opts.max<1){
     stat.iteration=-1;
     return stat;
   }
-  if(!matrix){
+  if(!matrix.data){
     stat.iteration=-2;
     return stat;
   }
@@ -147,95 +187,133 @@ statistics_t getStatisticsFromState2D(double complex ****matrix, double **StatPr
     return stat;
   }
 
-  if((iteration==1) && (opts.calcMix)){
-    SumProb = allocReal2D(auxsize, auxsize);
-    cleanReal2D(SumProb, auxsize, auxsize);
-  }
-
   fstMomentX = 0.0;
   secMomentX = 0.0;
   fstMomentY = 0.0;
   secMomentY = 0.0;
 
-  for(m=lbound; m<=rbound; m++){
-    for(n=lbound; n<=rbound; n++){
-
-      double prob;
-      int j,k;
-      int auxm = (opts.lattType == CYCLE_LATT) ? m : opts.max+m;
-      int auxn = (opts.lattType == CYCLE_LATT) ? n : opts.max+n;
-
-      prob = 0.0;
-      for(j=0; j<2; j++){
-	for(k=0; k<2; k++){
-	  prob += matrix[j][k][auxm][auxn]*
-	    conj(matrix[j][k][auxm][auxn]);
+  /* We only visit the support of the wave function (see getSupport2D),
+   * in increasing order of the coordinates.
+   */
+  nrows = getSupportRanges(supp.lo[0], supp.len[0], auxsize, rows);
+  ncols = getSupportRanges(supp.lo[1], supp.len[1], auxsize, cols);
+
+  for(ir=0; ir<nrows; ir++){
+    for(m=rows[ir][0]-shift; m<rows[ir][1]-shift; m++){
+      for(ic=0; ic<ncols; ic++){
+	for(n=cols[ic][0]-shift; n<cols[ic][1]-shift; n++){
+
+	  double prob;
+	  int j,k;
+	  int auxm = m+shift;
+	  int auxn = n+shift;
+
+	  prob = 0.0;
+	  for(j=0; j<2; j++){
+	    for(k=0; k<2; k++){
+	      prob += ENTRY4D(matrix,j,k,auxm,auxn)*
+		conj(ENTRY4D(matrix,j,k,auxm,auxn));
+	    }
+	  }
+
+	  fstMomentX += m*prob;
+	  secMomentX += m*m*prob;
+	  fstMomentY += n*prob;
+	  secMomentY += n*n*prob;     
 	}
       }
-
-      fstMomentX += m*prob;
-      secMomentX += m*m*prob;
-      fstMomentY += n*prob;
-      secMomentY += n*n*prob;     
     }
   }
   
-  varianceX = secMomentX - fstMomentX*fstMomentX;
-  varianceY = secMomentY - fstMomentY*fstMomentY;  
-
-  stat.iteration = iteration;
-  stat.meanX = fstMomentX;
-  stat.meanY = fstMomentY;
-
-  /* To calculate the variance in the 2D simulation we calculate the 
-   * variances of both X and Y position and add them. It simplifies
-   * the calculation and gives a good approximation of the expected
-   * behaviour.
-   */
-  stat.variance = varianceX + varianceY;
+  stat = getStatisticsFromMoments2D(fstMomentX, secMomentX, 
+				    fstMomentY, secMomentY, iteration);
 
   /*
    *
    */
   stat.tvd = stat.tvdu = 0.0;
   if(opts.calcMix){
-    double UnifProb;
-    const double diagArea = 2.0*pow((double)opts.max,2.0) - 2*opts.max + 1;
-    const double natArea  = (2.0*opts.max-1.0)*(2.0*opts.max-1.0);
-    const double cycArea  = opts.max*opts.max;
-    if(opts.lattType == DIAG_LATT)
-      UnifProb = pow(diagArea, -1.0);
-    else if(opts.lattType == NATURAL_LATT)
-      UnifProb = pow(natArea, -1.0);
-    else
-      UnifProb = pow(cycArea, -1.0);
-    
-    for(m=0; m<auxsize; m++){
-      for(n=0; n<auxsize; n++){
-	int j,k;
-	double prob = 0.0;
+    addProbFromState2D(SumProb, matrix, opts, iteration);
+    getDistancesFromSumProb2D(&stat, StatProb, SumProb, opts, iteration);
+  }
+
+  return stat;
+}
+
+
+
+void addProbFromState2D(double **SumProb, complex4D_t matrix, 
+			options2D_t opts, int steps){
+  int m, n, ir, ic, nrows, ncols;
+  int rows[2][2], cols[2][2];
+  const int auxsize = (opts.lattType == CYCLE_LATT) ? opts.max : 2*opts.max+1;
+  const support2D_t supp = getSupport2D(opts, steps);
+
+  /* Outside the support of the wave function (see getSupport2D) the 
+   * probabilities are zero, so only the support is visited.
+   */
+  nrows = getSupportRanges(supp.lo[0], supp.len[0], auxsize, rows);
+  ncols = getSupportRanges(supp.lo[1], supp.len[1], auxsize, cols);
+
+  for(ir=0; ir<nrows; ir++){
+    for(m=rows[ir][0]; m<rows[ir][1]; m++){
+      for(ic=0; ic<ncols; ic++){
+	for(n=cols[ic][0]; n<cols[ic][1]; n++){
+	  int j,k;
+	  double prob = 0.0;
 	
-	for(j=0; j<2; j++)
-	  for(k=0; k<2; k++)
-	    prob += matrix[j][k][m][n]*conj(matrix[j][k][m][n]);
+	  for(j=0; j<2; j++)
+	    for(k=0; k<2; k++)
+	      prob += ENTRY4D(matrix,j,k,m,n)*conj(ENTRY4D(matrix,j,k,m,n));
       
-	SumProb[m][n] += prob;
-	stat.tvd += fabs( StatProb[m][n] - SumProb[m][n]/(double)iteration );
-	if(opts.lattType != DIAG_LATT) 
-	  stat.tvdu += fabs( UnifProb - SumProb[m][n]/(double)iteration );
-	else if((m+n+1)%2)
-	  stat.tvdu += fabs( UnifProb - SumProb[m][n]/(double)iteration );
-	/* in the diagonal lattice, we only have sites (m,n) such
-	 * that m+n is even.
-	 */
+	  SumProb[m][n] += prob;
+	}
       }
     }
   }
 
-  if(iteration == opts.steps && opts.calcMix)
-    freeReal2D(SumProb, auxsize);
+  return;
+}
 
-  return stat;
+
+
+double getUniformProb2D(options2D_t opts){
+  const double diagArea = 2.0*pow((double)opts.max,2.0) - 2*opts.max + 1;
+  const double natArea  = (2.0*opts.max-1.0)*(2.0*opts.max-1.0);
+  const double cycArea  = opts.max*opts.max;
+
+  if(opts.lattType == DIAG_LATT)
+    return pow(diagArea, -1.0);
+  else if(opts.lattType == NATURAL_LATT)
+    return pow(natArea, -1.0);
+  else
+    return pow(cycArea, -1.0);
+}
+
+
+
+void getDistancesFromSumProb2D(statistics_t *stat, double **StatProb,
+			       double **SumProb, options2D_t opts, 
+			       int iteration){
+  int m, n;
+  const double UnifProb = getUniformProb2D(opts);
+  const int auxsize = (opts.lattType == CYCLE_LATT) ? opts.max : 2*opts.max+1;
+
+  stat->tvd = stat->tvdu = 0.0;
+  for(m=0; m<auxsize; m++){
+    for(n=0; n<auxsize; n++){
+      stat->tvd += fabs( StatProb[m][n] - SumProb[m][n]/(double)iteration );
+      if(opts.lattType != DIAG_LATT) 
+	stat->tvdu += fabs( UnifProb - SumProb[m][n]/(double)iteration );
+      else if((m+n+1)%2)
+	stat->tvdu += fabs( UnifProb - SumProb[m][n]/(double)iteration );
+      /* in the diagonal lattice, we only have sites (m,n) such
+       * that m+n is even.
+       */
+    }
+  }
+
+  return;
 }
 
 
@@ -29,21 +29,44 @@
 #include "qwconsts.h"
 
 
-int writeStatistics(const char *filename, statistics_t stat){
+/* Size of the queue of the statistics writer, in bytes */
+#define STATISTICS_QUEUE (1<<20)
+
+
+static int printStatisticsHeader(FILE *out){
+
+  if(fprintf(out,"#Iter\tMean X\t\tMean Y\t\tVariance\tStd deviation\tTVD\tTVD (unif)\n\n") < 0)
+    return 1;
+
+  return 0;
+}
+
+
+
+static int printStatistics(FILE *out, statistics_t stat){
+
+  if(fprintf(out,"%d\t%e\t%e\t%e\t%e\t%e\t%e\n",
+	     stat.iteration, stat.meanX, stat.meanY,
+	     stat.variance, sqrt(stat.variance),
+	     stat.tvd, stat.tvdu) < 0)
+    return 1;
+
+  return 0;
+}
+
+
+
+int writeStatistics(const char *filename, statistics_t stat, int create){
   FILE *out;
-  static char firstCall = 1;
 
-  if(STREQ(filename,"")){
-    firstCall=1;
+  if(STREQ(filename,""))
     return 0;
-  }
 
-  if(firstCall){
+  if(create){
     out = fopen(filename,"wt");
     if(!out)
       return 1;
-    fprintf(out,"#Iter\tMean X\t\tMean Y\t\tVariance\tStd deviation\tTVD\tTVD (unif)\n\n");
-    firstCall = 0;
+    printStatisticsHeader(out);
   }
   else{
     out = fopen(filename,"at");
@@ -51,11 +74,7 @@ int writeStatistics(const char *filename, statistics_t stat){
       return 1;
   }
 
-
-  fprintf(out,"%d\t%e\t%e\t%e\t%e\t%e\t%e\n",
-	  stat.iteration, stat.meanX, stat.meanY,
-	  stat.variance, sqrt(stat.variance),
-	  stat.tvd, stat.tvdu);
+  printStatistics(out, stat);
 
   fclose(out);
 
@@ -63,3 +82,41 @@ int writeStatistics(const char *filename, statistics_t stat){
 }
 
 
+
+/* Record writers of the statistics file (see recordwriter_t) */
+static int writeHeaderRecord(FILE *out, const void *record, size_t bytes){
+  (void)record;
+  (void)bytes;
+  return printStatisticsHeader(out);
+}
+
+
+static int writeStatisticsRecord(FILE *out, const void *record, size_t bytes){
+  (void)bytes;
+  return printStatistics(out, *(const statistics_t *)record);
+}
+
+
+
+asyncwriter_t *openStatistics(const char *filename){
+  asyncwriter_t *writer;
+
+  writer = openWriter(filename, 0, STATISTICS_QUEUE);
+  if(!writer)
+    return NULL;
+
+  if(sendRecord(writer, writeHeaderRecord, NULL, 0)){
+    closeWriter(writer);
+    return NULL;
+  }
+
+  return writer;
+}
+
+
+
+int sendStatistics(asyncwriter_t *writer, statistics_t stat){
+  return sendRecord(writer, writeStatisticsRecord, &stat, sizeof(statistics_t));
+}
+
+
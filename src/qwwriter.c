@@ -0,0 +1,276 @@
+/* QWalk (qwwriter.c)
+ * Copyright (C) 2008  Franklin Marquezino
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<stddef.h>
+#include "qwwriter.h"
+#include "qwconsts.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define QW_PTHREAD
+#include<pthread.h>
+#endif
+
+/* Size of the buffer of the output file */
+#define WRITER_BUFFER 65536
+
+
+typedef struct record_s{
+  struct record_s *next;
+  recordwriter_t write;
+  size_t bytes;
+  double data[];        /* the copy of the record, suitably aligned */
+}record_t;
+
+
+struct asyncwriter_s{
+  FILE *out;
+  record_t *first;      /* queue of records not written yet */
+  record_t *last;
+  size_t pending;       /* bytes in the queue */
+  size_t capacity;
+  int error;
+  int closing;
+  int writing;          /* whether the thread is writing a record */
+#ifdef QW_PTHREAD
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t notEmpty;
+  pthread_cond_t notFull;
+#endif
+};
+
+
+
+#ifdef QW_PTHREAD
+/* The thread of the writer: it takes the records from the queue, one at
+ * a time, and writes them without holding the lock, until the writer is
+ * closed and the queue is empty.
+ */
+static void *writerThread(void *arg){
+  asyncwriter_t *writer = (asyncwriter_t *)arg;
+  record_t *record;
+  int error;
+
+  pthread_mutex_lock(&writer->lock);
+  while(1){
+    while(!writer->first && !writer->closing)
+      pthread_cond_wait(&writer->notEmpty, &writer->lock);
+    record = writer->first;
+    if(!record)
+      break;
+    writer->first = record->next;
+    if(!writer->first)
+      writer->last = NULL;
+    writer->writing = 1;
+    pthread_mutex_unlock(&writer->lock);
+
+    error = record->write(writer->out, record->data, record->bytes);
+
+    pthread_mutex_lock(&writer->lock);
+    if(error)
+      writer->error = 1;
+    writer->pending -= record->bytes;
+    writer->writing = 0;
+    pthread_cond_broadcast(&writer->notFull);
+    free(record);
+  }/* end-while */
+  pthread_mutex_unlock(&writer->lock);
+
+  return NULL;
+}
+#endif
+
+
+
+asyncwriter_t *openWriter(const char *filename, int binary, size_t capacity){
+  FILE *out;
+
+  out = fopen(filename, binary ? "wb" : "wt");
+  if(!out)
+    return NULL;
+
+  return startWriter(out, capacity);
+}
+
+
+
+asyncwriter_t *startWriter(FILE *out, size_t capacity){
+  asyncwriter_t *writer;
+
+  writer = (asyncwriter_t *)calloc(1, sizeof(asyncwriter_t));
+  if(!writer){
+    fclose(out);
+    return NULL;
+  }
+
+  writer->out = out;
+  setvbuf(writer->out, NULL, _IOFBF, WRITER_BUFFER);
+  writer->capacity = capacity;
+
+#ifdef QW_PTHREAD
+  if(pthread_mutex_init(&writer->lock, NULL)){
+    fclose(writer->out);
+    free(writer);
+    return NULL;
+  }
+  if(pthread_cond_init(&writer->notEmpty, NULL) ||
+     pthread_cond_init(&writer->notFull, NULL) ||
+     pthread_create(&writer->thread, NULL, writerThread, writer)){
+    pthread_mutex_destroy(&writer->lock);
+    fclose(writer->out);
+    free(writer);
+    return NULL;
+  }
+#endif
+
+  return writer;
+}
+
+
+
+/* The record that keeps the memory returned by newRecord */
+#define RECORD_OF(p) ((record_t *)((char *)(p) - offsetof(record_t, data)))
+
+
+void *newRecord(size_t bytes){
+  record_t *node;
+
+  node = (record_t *)malloc(sizeof(record_t) + bytes);
+  if(!node)
+    return NULL;
+  node->next = NULL;
+  node->write = NULL;
+  node->bytes = bytes;
+
+  return node->data;
+}
+
+
+
+int queueRecord(asyncwriter_t *writer, recordwriter_t write, void *record){
+  record_t *node = RECORD_OF(record);
+  const size_t bytes = node->bytes;
+  int error;
+
+  node->write = write;
+
+#ifdef QW_PTHREAD
+  pthread_mutex_lock(&writer->lock);
+  /* A record larger than the capacity waits for an empty queue */
+  while(writer->pending > 0 && writer->pending + bytes > writer->capacity)
+    pthread_cond_wait(&writer->notFull, &writer->lock);
+
+  if(writer->last)
+    writer->last->next = node;
+  else
+    writer->first = node;
+  writer->last = node;
+  writer->pending += bytes;
+  error = writer->error;
+
+  pthread_cond_signal(&writer->notEmpty);
+  pthread_mutex_unlock(&writer->lock);
+#else
+  if(write(writer->out, node->data, bytes))
+    writer->error = 1;
+  error = writer->error;
+  free(node);
+#endif
+
+  return error;
+}
+
+
+
+int sendRecord(asyncwriter_t *writer, recordwriter_t write,
+	       const void *record, size_t bytes){
+  void *copy;
+
+  copy = newRecord(bytes);
+  if(!copy)
+    return 1;
+  if(bytes)
+    memcpy(copy, record, bytes);
+
+  return queueRecord(writer, write, copy);
+}
+
+
+
+int flushWriter(asyncwriter_t *writer){
+  int error;
+
+#ifdef QW_PTHREAD
+  pthread_mutex_lock(&writer->lock);
+  while(writer->first || writer->writing)
+    pthread_cond_wait(&writer->notFull, &writer->lock);
+  if(fflush(writer->out))
+    writer->error = 1;
+  error = writer->error;
+  pthread_mutex_unlock(&writer->lock);
+#else
+  if(fflush(writer->out))
+    writer->error = 1;
+  error = writer->error;
+#endif
+
+  return error;
+}
+
+
+
+int writeRawRecord(FILE *out, const void *record, size_t bytes){
+
+  if(bytes && fwrite(record, 1, bytes, out) != bytes)
+    return 1;
+
+  return 0;
+}
+
+
+
+int closeWriter(asyncwriter_t *writer){
+  int error;
+
+#ifdef QW_PTHREAD
+  pthread_mutex_lock(&writer->lock);
+  writer->closing = 1;
+  pthread_cond_signal(&writer->notEmpty);
+  pthread_mutex_unlock(&writer->lock);
+
+  pthread_join(writer->thread, NULL);
+  pthread_cond_destroy(&writer->notEmpty);
+  pthread_cond_destroy(&writer->notFull);
+  pthread_mutex_destroy(&writer->lock);
+#endif
+
+  error = writer->error;
+  if(ferror(writer->out))
+    error = 1;
+  if(fclose(writer->out))
+    error = 1;
+  free(writer);
+
+  return error;
+}